@@ -0,0 +1,666 @@
+/*
+@file - analysis.c
+@developer - ColorProgrammy
+@brief - Signal statistics and waveform overviews.
+@date - 16/10/2026
+@description - One pass decodes the file to float in buckets of 256 frames
+and reduces each bucket with a SIMD kernel to per-channel min, max, sum,
+sum of squares and clip count. The totals give peak, RMS and DC offset; the
+per-bucket min/max is the finest level of the waveform pyramid, and each
+coarser level halves the one below it.
+*/
+
+#include "internal.h"
+#include <math.h>
+
+#define ANALYSIS_BUCKET_FRAMES 256
+#define ANALYSIS_MAX_PERIOD 64          // Interleaving periods wider than this use the scalar kernel
+#define ANALYSIS_DEFAULT_SILENCE 0.001f // -60 dBFS
+#define WAVEFORM_MAX_LEVELS 48
+#define WAVEFORM_VERSION 1
+
+// Per-position results for one bucket. Position p of an interleaved block
+// belongs to channel p % channels.
+typedef struct {
+    float* minimum;
+    float* maximum;
+    float* sum;
+    float* sumSq;
+    uint32_t* clips;
+} BucketStats;
+
+// Reduces groups runs of period floats; period is a multiple of the vector width
+typedef void (*BucketKernel)(const float* x, size_t groups, uint32_t period, const BucketStats* stats, float clipLevel);
+
+struct CoralWaveform {
+    CoralWaveformInfo info;
+    uint64_t levelBuckets[WAVEFORM_MAX_LEVELS];
+    size_t levelOffset[WAVEFORM_MAX_LEVELS];     // In int16 values from data
+    size_t valueCount;
+    int16_t* data;                              // Per bucket, a min/max pair for each channel
+};
+
+#pragma pack(push, 1)
+typedef struct {
+    char magic[4];                  // "CWAV"
+    uint32_t version;
+    uint32_t sampleRate;
+    uint16_t channels;
+    uint16_t reserved;
+    uint32_t baseFrames;
+    uint64_t frames;
+} WaveformFileHeader;
+#pragma pack(pop)
+
+static void bucketScalar(const float* x, size_t groups, uint32_t period, const BucketStats* stats, float clipLevel) {
+    uint32_t p;
+    size_t g;
+    float v;
+
+    for (p = 0; p < period; ++p) {
+        stats->minimum[p] = x[p];
+        stats->maximum[p] = x[p];
+        stats->sum[p] = 0.0f;
+        stats->sumSq[p] = 0.0f;
+        stats->clips[p] = 0;
+    }
+    for (g = 0; g < groups; ++g) {
+        for (p = 0; p < period; ++p) {
+            v = x[g * period + p];
+            if (v < stats->minimum[p]) stats->minimum[p] = v;
+            if (v > stats->maximum[p]) stats->maximum[p] = v;
+            stats->sum[p] += v;
+            stats->sumSq[p] += v * v;
+            if (fabsf(v) >= clipLevel) stats->clips[p]++;
+        }
+    }
+}
+
+#ifdef CORAL_ARCH_X86
+static CORAL_TARGET_SSE2 void bucketSse2(const float* x, size_t groups, uint32_t period, const BucketStats* stats, float clipLevel) {
+    __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 clip = _mm_set1_ps(clipLevel);
+    __m128 mn, mx, sum, sumSq, v;
+    __m128i clips;
+    uint32_t p;
+    size_t g;
+
+    // Each lane keeps to one position, walking the bucket with stride period
+    for (p = 0; p < period; p += 4) {
+        mn = mx = _mm_loadu_ps(x + p);
+        sum = sumSq = _mm_setzero_ps();
+        clips = _mm_setzero_si128();
+        for (g = 0; g < groups; ++g) {
+            v = _mm_loadu_ps(x + g * period + p);
+            mn = _mm_min_ps(mn, v);
+            mx = _mm_max_ps(mx, v);
+            sum = _mm_add_ps(sum, v);
+            sumSq = _mm_add_ps(sumSq, _mm_mul_ps(v, v));
+            clips = _mm_sub_epi32(clips, _mm_castps_si128(_mm_cmpge_ps(_mm_and_ps(v, absMask), clip)));
+        }
+        _mm_storeu_ps(stats->minimum + p, mn);
+        _mm_storeu_ps(stats->maximum + p, mx);
+        _mm_storeu_ps(stats->sum + p, sum);
+        _mm_storeu_ps(stats->sumSq + p, sumSq);
+        _mm_storeu_si128((__m128i*)(stats->clips + p), clips);
+    }
+}
+
+#ifdef CORAL_HAVE_AVX2
+static CORAL_TARGET_AVX2 void bucketAvx2(const float* x, size_t groups, uint32_t period, const BucketStats* stats, float clipLevel) {
+    __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 clip = _mm256_set1_ps(clipLevel);
+    __m256 mn, mx, sum, sumSq, v;
+    __m256i clips;
+    uint32_t p;
+    size_t g;
+
+    for (p = 0; p < period; p += 8) {
+        mn = mx = _mm256_loadu_ps(x + p);
+        sum = sumSq = _mm256_setzero_ps();
+        clips = _mm256_setzero_si256();
+        for (g = 0; g < groups; ++g) {
+            v = _mm256_loadu_ps(x + g * period + p);
+            mn = _mm256_min_ps(mn, v);
+            mx = _mm256_max_ps(mx, v);
+            sum = _mm256_add_ps(sum, v);
+            sumSq = _mm256_add_ps(sumSq, _mm256_mul_ps(v, v));
+            clips = _mm256_sub_epi32(clips, _mm256_castps_si256(_mm256_cmp_ps(_mm256_and_ps(v, absMask), clip, _CMP_GE_OQ)));
+        }
+        _mm256_storeu_ps(stats->minimum + p, mn);
+        _mm256_storeu_ps(stats->maximum + p, mx);
+        _mm256_storeu_ps(stats->sum + p, sum);
+        _mm256_storeu_ps(stats->sumSq + p, sumSq);
+        _mm256_storeu_si256((__m256i*)(stats->clips + p), clips);
+    }
+}
+#endif
+#endif
+
+#ifdef CORAL_ARCH_NEON
+static void bucketNeon(const float* x, size_t groups, uint32_t period, const BucketStats* stats, float clipLevel) {
+    float32x4_t clip = vdupq_n_f32(clipLevel);
+    float32x4_t mn, mx, sum, sumSq, v;
+    uint32x4_t clips;
+    uint32_t p;
+    size_t g;
+
+    for (p = 0; p < period; p += 4) {
+        mn = mx = vld1q_f32(x + p);
+        sum = sumSq = vdupq_n_f32(0.0f);
+        clips = vdupq_n_u32(0);
+        for (g = 0; g < groups; ++g) {
+            v = vld1q_f32(x + g * period + p);
+            mn = vminq_f32(mn, v);
+            mx = vmaxq_f32(mx, v);
+            sum = vaddq_f32(sum, v);
+            sumSq = vmlaq_f32(sumSq, v, v);
+            clips = vsubq_u32(clips, vcgeq_f32(vabsq_f32(v), clip));
+        }
+        vst1q_f32(stats->minimum + p, mn);
+        vst1q_f32(stats->maximum + p, mx);
+        vst1q_f32(stats->sum + p, sum);
+        vst1q_f32(stats->sumSq + p, sumSq);
+        vst1q_u32(stats->clips + p, clips);
+    }
+}
+#endif
+
+static uint32_t greatestCommonDivisor(uint32_t a, uint32_t b) {
+    uint32_t t;
+    while (b != 0) {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Picks the kernel and the smallest period that is a whole number of both
+// frames and vectors
+static BucketKernel selectKernel(uint16_t channels, uint32_t* period) {
+    BucketKernel kernel = bucketScalar;
+    uint32_t width = 1;
+
+    switch (coralGetSimdLevel()) {
+#ifdef CORAL_ARCH_X86
+#ifdef CORAL_HAVE_AVX2
+    case CORAL_SIMD_AVX2:
+        kernel = bucketAvx2;
+        width = 8;
+        break;
+#endif
+    case CORAL_SIMD_SSE2:
+        kernel = bucketSse2;
+        width = 4;
+        break;
+#endif
+#ifdef CORAL_ARCH_NEON
+    case CORAL_SIMD_NEON:
+        kernel = bucketNeon;
+        width = 4;
+        break;
+#endif
+    default:
+        break;
+    }
+
+    *period = channels / greatestCommonDivisor(channels, width) * width;
+    if (*period > ANALYSIS_MAX_PERIOD && *period > channels) {
+        *period = channels;
+        return bucketScalar;
+    }
+    return kernel;
+}
+
+// Largest decoded value of the format; samples at or past it count as clipped
+static float clipLevelOf(CoralSampleFormat format) {
+    switch (format) {
+    case CORAL_SAMPLE_U8:
+        return 127.0f / 128.0f;
+    case CORAL_SAMPLE_S16:
+        return 32767.0f / 32768.0f;
+    case CORAL_SAMPLE_S24:
+    case CORAL_SAMPLE_S24_32:
+        return 8388607.0f / 8388608.0f;
+    default:
+        return 1.0f;
+    }
+}
+
+static int16_t quantizeDown(float value) {
+    float scaled = floorf(value * 32767.0f);
+    if (scaled < -32768.0f) return -32768;
+    if (scaled > 32767.0f) return 32767;
+    return (int16_t)scaled;
+}
+
+static int16_t quantizeUp(float value) {
+    float scaled = ceilf(value * 32767.0f);
+    if (scaled < -32768.0f) return -32768;
+    if (scaled > 32767.0f) return 32767;
+    return (int16_t)scaled;
+}
+
+// Lays out the levels, each halving the one below down to one bucket; false when they would not fit in memory
+static bool planLevels(CoralWaveform* waveform) {
+    uint64_t buckets = waveform->info.frames / waveform->info.baseFrames +
+        (waveform->info.frames % waveform->info.baseFrames != 0);
+    uint64_t stride = (uint64_t)waveform->info.channels * 2;
+    uint64_t limit = (size_t)-1 / sizeof(int16_t);
+    size_t offset = 0;
+    uint32_t level = 0;
+
+    if (buckets == 0) {
+        buckets = 1;
+    }
+    while (level < WAVEFORM_MAX_LEVELS) {
+        if (buckets > (limit - offset) / stride) {
+            return false;
+        }
+        waveform->levelBuckets[level] = buckets;
+        waveform->levelOffset[level] = offset;
+        offset += (size_t)(buckets * stride);
+        level++;
+        if (buckets == 1) {
+            break;
+        }
+        buckets = (buckets + 1) / 2;
+    }
+    waveform->info.levels = level;
+    waveform->valueCount = offset;
+    return true;
+}
+
+static CoralWaveform* createWaveform(uint32_t sampleRate, uint16_t channels, uint32_t baseFrames, uint64_t frames) {
+    CoralWaveform* waveform = (CoralWaveform*)malloc(sizeof(CoralWaveform));
+
+    if (!waveform) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+    memset(waveform, 0, sizeof(CoralWaveform));
+    waveform->info.sampleRate = sampleRate;
+    waveform->info.channels = channels;
+    waveform->info.baseFrames = baseFrames;
+    waveform->info.frames = frames;
+    waveform->data = planLevels(waveform) ? (int16_t*)malloc(waveform->valueCount * sizeof(int16_t)) : NULL;
+    if (!waveform->data) {
+        free(waveform);
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+    memset(waveform->data, 0, waveform->valueCount * sizeof(int16_t));
+    return waveform;
+}
+
+// Fills every level above the first from the level below
+static void buildLevels(CoralWaveform* waveform) {
+    uint32_t stride = (uint32_t)waveform->info.channels * 2;
+    const int16_t* below;
+    const int16_t* pair;
+    int16_t* out;
+    uint64_t b;
+    uint32_t level;
+    uint32_t i;
+
+    for (level = 1; level < waveform->info.levels; ++level) {
+        below = waveform->data + waveform->levelOffset[level - 1];
+        out = waveform->data + waveform->levelOffset[level];
+        for (b = 0; b < waveform->levelBuckets[level]; ++b) {
+            pair = below + (size_t)b * 2 * stride;
+            if (2 * b + 1 >= waveform->levelBuckets[level - 1]) {
+                memcpy(out, pair, stride * sizeof(int16_t));
+            }
+            else {
+                for (i = 0; i < stride; i += 2) {
+                    out[i] = pair[i] < pair[stride + i] ? pair[i] : pair[stride + i];
+                    out[i + 1] = pair[i + 1] > pair[stride + i + 1] ? pair[i + 1] : pair[stride + i + 1];
+                }
+            }
+            out += stride;
+        }
+    }
+}
+
+// Index of the first frame in frames[0, count) with a sample above threshold
+static size_t firstLoudFrame(const float* x, size_t count, uint16_t channels, float threshold) {
+    size_t i;
+    for (i = 0; i < count * channels; ++i) {
+        if (fabsf(x[i]) > threshold) return i / channels;
+    }
+    return count;
+}
+
+static size_t lastLoudFrame(const float* x, size_t count, uint16_t channels, float threshold) {
+    size_t i;
+    for (i = count * channels; i-- > 0;) {
+        if (fabsf(x[i]) > threshold) return i / channels;
+    }
+    return 0;
+}
+
+bool coralAnalyze(const WavFile* wavFile, float silenceThreshold, CoralAnalysis* analysis, CoralWaveform** waveform) {
+    CoralSampleFormat format;
+    WavFormat playback;
+    CoralDecoder decoder;
+    CoralWaveform* overview = NULL;
+    BucketKernel kernel;
+    BucketStats stats;
+    float* block = NULL;
+    double* totals = NULL;          // Sum, then sum of squares, per channel
+    uint64_t* clips = NULL;
+    uint64_t frames;
+    uint64_t start;
+    uint64_t bucket = 0;
+    uint32_t period;
+    uint32_t positions;
+    uint32_t p;
+    uint16_t channels;
+    uint16_t c;
+    size_t count;
+    float clipLevel;
+    float bucketPeak;
+    float channelMin;
+    float channelMax;
+    double sumAll = 0.0;
+    double sumSqAll = 0.0;
+    int16_t* level0;
+    bool foundSound = false;
+
+    if (!wavFile || !wavFile->data || !analysis) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null WAV file or analysis pointer");
+        return false;
+    }
+    // Compressed files are measured as the 16-bit PCM they play as
+    if (!coralPlaybackFormat(&wavFile->wavFormat, &playback, &format)) {
+        return false;
+    }
+    if (!coralCheckFormat(&wavFile->wavFormat, NULL, 0)) {
+        return false;
+    }
+    if (silenceThreshold <= 0.0f) {
+        silenceThreshold = ANALYSIS_DEFAULT_SILENCE;
+    }
+
+    channels = wavFile->wavFormat.numChannels;
+    frames = coralFrameCount(&wavFile->wavFormat, coralWavDataSize(wavFile));
+    kernel = selectKernel(channels, &period);
+    clipLevel = clipLevelOf(format);
+
+    if (!coralDecoderInit(&decoder, wavFile)) {
+        return false;
+    }
+    if (waveform) {
+        overview = createWaveform(wavFile->wavFormat.sampleRate, channels, ANALYSIS_BUCKET_FRAMES, frames);
+        if (!overview) {
+            coralDecoderFree(&decoder);
+            return false;
+        }
+    }
+    block = (float*)malloc((size_t)ANALYSIS_BUCKET_FRAMES * channels * sizeof(float));
+    stats.minimum = (float*)malloc(4 * (size_t)period * sizeof(float));
+    stats.clips = (uint32_t*)malloc((size_t)period * sizeof(uint32_t));
+    totals = (double*)malloc(2 * (size_t)channels * sizeof(double));
+    clips = (uint64_t*)malloc((size_t)channels * sizeof(uint64_t));
+    if (!block || !stats.minimum || !stats.clips || !totals || !clips) {
+        free(block);
+        free(stats.minimum);
+        free(stats.clips);
+        free(totals);
+        free(clips);
+        coralWaveformDestroy(overview);
+        coralDecoderFree(&decoder);
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return false;
+    }
+    stats.maximum = stats.minimum + period;
+    stats.sum = stats.maximum + period;
+    stats.sumSq = stats.sum + period;
+    memset(totals, 0, 2 * (size_t)channels * sizeof(double));
+    memset(clips, 0, (size_t)channels * sizeof(uint64_t));
+
+    memset(analysis, 0, sizeof(CoralAnalysis));
+    analysis->frames = frames;
+    analysis->channelCount = channels < CORAL_ANALYSIS_CHANNELS ? channels : CORAL_ANALYSIS_CHANNELS;
+    level0 = overview ? overview->data : NULL;
+
+    for (start = 0; start < frames; start += count, ++bucket) {
+        count = frames - start < ANALYSIS_BUCKET_FRAMES ? (size_t)(frames - start) : ANALYSIS_BUCKET_FRAMES;
+        if (decoder.codec != CORAL_CODEC_NONE) {
+            coralDecoderRead(&decoder, start, block, count);
+        }
+        else {
+            coralDecodeToFloat(wavFile->data + start * wavFile->wavFormat.blockAlign, format, block, count * channels);
+        }
+
+        // Full buckets are a whole number of periods; the short last one is not
+        if (count == ANALYSIS_BUCKET_FRAMES) {
+            kernel(block, count * channels / period, period, &stats, clipLevel);
+            positions = period;
+        }
+        else {
+            bucketScalar(block, count, channels, &stats, clipLevel);
+            positions = channels;
+        }
+
+        // Fold the positions of each channel together
+        bucketPeak = 0.0f;
+        for (c = 0; c < channels; ++c) {
+            channelMin = stats.minimum[c];
+            channelMax = stats.maximum[c];
+            for (p = c; p < positions; p += channels) {
+                if (stats.minimum[p] < channelMin) channelMin = stats.minimum[p];
+                if (stats.maximum[p] > channelMax) channelMax = stats.maximum[p];
+                totals[c] += stats.sum[p];
+                totals[channels + c] += stats.sumSq[p];
+                clips[c] += stats.clips[p];
+            }
+            if (-channelMin > bucketPeak) bucketPeak = -channelMin;
+            if (channelMax > bucketPeak) bucketPeak = channelMax;
+            if (c < CORAL_ANALYSIS_CHANNELS) {
+                if (-channelMin > analysis->channels[c].peak) analysis->channels[c].peak = -channelMin;
+                if (channelMax > analysis->channels[c].peak) analysis->channels[c].peak = channelMax;
+            }
+            if (level0) {
+                level0[((size_t)bucket * channels + c) * 2] = quantizeDown(channelMin);
+                level0[((size_t)bucket * channels + c) * 2 + 1] = quantizeUp(channelMax);
+            }
+        }
+
+        if (bucketPeak > analysis->peak) {
+            analysis->peak = bucketPeak;
+        }
+        // Only buckets that are not silent need a look at individual frames
+        if (bucketPeak > silenceThreshold) {
+            if (!foundSound) {
+                analysis->soundStart = start + firstLoudFrame(block, count, channels, silenceThreshold);
+                foundSound = true;
+            }
+            analysis->soundEnd = start + lastLoudFrame(block, count, channels, silenceThreshold) + 1;
+        }
+    }
+
+    for (c = 0; c < channels; ++c) {
+        sumAll += totals[c];
+        sumSqAll += totals[channels + c];
+        analysis->clippedSamples += clips[c];
+        if (c < CORAL_ANALYSIS_CHANNELS && frames > 0) {
+            analysis->channels[c].dcOffset = (float)(totals[c] / (double)frames);
+            analysis->channels[c].rms = (float)sqrt(totals[channels + c] / (double)frames);
+            analysis->channels[c].clippedSamples = clips[c];
+        }
+    }
+    if (frames > 0) {
+        analysis->dcOffset = (float)(sumAll / ((double)frames * channels));
+        analysis->rms = (float)sqrt(sumSqAll / ((double)frames * channels));
+    }
+
+    free(block);
+    free(stats.minimum);
+    free(stats.clips);
+    free(totals);
+    free(clips);
+    coralDecoderFree(&decoder);
+
+    if (overview) {
+        buildLevels(overview);
+        *waveform = overview;
+    }
+    return true;
+}
+
+void coralWaveformDestroy(CoralWaveform* waveform) {
+    if (waveform) {
+        free(waveform->data);
+        free(waveform);
+    }
+}
+
+void coralWaveformGetInfo(const CoralWaveform* waveform, CoralWaveformInfo* info) {
+    if (waveform && info) {
+        *info = waveform->info;
+    }
+}
+
+bool coralWaveformRead(const CoralWaveform* waveform, uint16_t channel, uint64_t firstFrame, uint64_t frameCount,
+    uint32_t pixels, int16_t* minMax) {
+    const int16_t* values;
+    double framesPerPixel;
+    uint64_t bucketFrames;
+    uint64_t first;
+    uint64_t last;
+    uint64_t b;
+    uint32_t level = 0;
+    uint32_t i;
+    int16_t lo;
+    int16_t hi;
+
+    if (!waveform || !minMax || pixels == 0) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null waveform or output pointer");
+        return false;
+    }
+    if (channel >= waveform->info.channels) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Channel %u out of range", (unsigned)channel);
+        return false;
+    }
+
+    // The coarsest level whose buckets still fit in a pixel; each pixel then
+    // spans at most a few buckets
+    framesPerPixel = (double)frameCount / pixels;
+    bucketFrames = waveform->info.baseFrames;
+    while (level + 1 < waveform->info.levels && (double)(bucketFrames * 2) <= framesPerPixel) {
+        bucketFrames *= 2;
+        level++;
+    }
+    values = waveform->data + waveform->levelOffset[level];
+
+    for (i = 0; i < pixels; ++i) {
+        first = firstFrame + (uint64_t)(i * framesPerPixel);
+        last = firstFrame + (uint64_t)((i + 1) * framesPerPixel);
+        if (last <= first) {
+            last = first + 1;
+        }
+        lo = 0;
+        hi = 0;
+        if (first < waveform->info.frames) {
+            if (last > waveform->info.frames) {
+                last = waveform->info.frames;
+            }
+            lo = 32767;
+            hi = -32768;
+            for (b = first / bucketFrames; b <= (last - 1) / bucketFrames; ++b) {
+                if (values[(b * waveform->info.channels + channel) * 2] < lo) lo = values[(b * waveform->info.channels + channel) * 2];
+                if (values[(b * waveform->info.channels + channel) * 2 + 1] > hi) hi = values[(b * waveform->info.channels + channel) * 2 + 1];
+            }
+        }
+        minMax[2 * i] = lo;
+        minMax[2 * i + 1] = hi;
+    }
+    return true;
+}
+
+bool coralWaveformSave(const CoralWaveform* waveform, const char* path) {
+    WaveformFileHeader header;
+    FILE* file;
+    bool ok;
+
+    if (!waveform || !path) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null waveform or path");
+        return false;
+    }
+    file = fopen(path, "wb");
+    if (!file) {
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to open file: %s", path);
+        return false;
+    }
+
+    memcpy(header.magic, "CWAV", 4);
+    header.version = WAVEFORM_VERSION;
+    header.sampleRate = waveform->info.sampleRate;
+    header.channels = waveform->info.channels;
+    header.reserved = 0;
+    header.baseFrames = waveform->info.baseFrames;
+    header.frames = waveform->info.frames;
+
+    ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(waveform->data, sizeof(int16_t), waveform->valueCount, file) == waveform->valueCount;
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        coralSetError(CORAL_ERROR_FILE_WRITE, "Failed to write waveform: %s", path);
+    }
+    return ok;
+}
+
+CoralWaveform* coralWaveformLoad(const char* path) {
+    WaveformFileHeader header;
+    CoralWaveform plan;
+    CoralWaveform* waveform;
+    FILE* file;
+    int64_t fileSize;
+
+    if (!path) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null path");
+        return NULL;
+    }
+    file = fopen(path, "rb");
+    if (!file) {
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to open file: %s", path);
+        return NULL;
+    }
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "CWAV", 4) != 0 ||
+        header.version != WAVEFORM_VERSION || header.channels == 0 || header.baseFrames == 0) {
+        fclose(file);
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Not a waveform file: %s", path);
+        return NULL;
+    }
+
+    // The header decides how much is read; it has to describe this file exactly
+    memset(&plan, 0, sizeof(plan));
+    plan.info.channels = header.channels;
+    plan.info.baseFrames = header.baseFrames;
+    plan.info.frames = header.frames;
+    if (coralSeek(file, 0, SEEK_END) != 0 || (fileSize = (int64_t)coralTell(file)) < 0 ||
+        coralSeek(file, (int64_t)sizeof(header), SEEK_SET) != 0 || !planLevels(&plan) ||
+        (uint64_t)fileSize - sizeof(header) != (uint64_t)plan.valueCount * sizeof(int16_t)) {
+        fclose(file);
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Waveform file does not match its header: %s", path);
+        return NULL;
+    }
+
+    waveform = createWaveform(header.sampleRate, header.channels, header.baseFrames, header.frames);
+    if (!waveform) {
+        fclose(file);
+        return NULL;
+    }
+    if (fread(waveform->data, sizeof(int16_t), waveform->valueCount, file) != waveform->valueCount) {
+        fclose(file);
+        coralWaveformDestroy(waveform);
+        coralSetError(CORAL_ERROR_FILE_READ, "Truncated waveform file: %s", path);
+        return NULL;
+    }
+    fclose(file);
+    return waveform;
+}
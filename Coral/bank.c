@@ -0,0 +1,270 @@
+/*
+@file - bank.c
+@developer - ColorProgrammy
+@brief - Shared sound bank.
+@date - 16/10/2026
+@description - Caches loaded WAV files so repeated loads of the same file
+share one read-only copy. Entries are reference counted; unreferenced ones
+stay cached until the byte budget forces the least recently used out.
+*/
+
+#include "internal.h"
+
+#ifndef PLATFORM_WINDOWS
+#include <sys/stat.h>
+#endif
+
+#define BANK_DEFAULT_BUDGET (64u * 1024u * 1024u)
+
+// Identifies the file contents; a rewritten file gets a new identity
+typedef struct {
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    uint64_t modified;
+} BankIdentity;
+
+typedef struct BankEntry {
+    BankIdentity identity;
+    WavFile* wavFile;
+    size_t bytes;
+    uint32_t refCount;
+    uint64_t lastUsed;
+    struct BankEntry* next;
+} BankEntry;
+
+static struct {
+    CoralMutex mutex;
+    BankEntry* entries;
+    uint64_t clock;             // Bumped on every acquire and release for LRU order
+    size_t budget;
+    CoralBankStats stats;
+} bank;
+
+static CoralOnce bankOnce = CORAL_ONCE_INIT;
+
+static void bankInit(void) {
+    coralMutexInit(&bank.mutex);
+    bank.budget = BANK_DEFAULT_BUDGET;
+    bank.stats.budgetBytes = BANK_DEFAULT_BUDGET;
+}
+
+static bool fileIdentity(const char* path, BankIdentity* identity) {
+#ifdef PLATFORM_WINDOWS
+    BY_HANDLE_FILE_INFORMATION info;
+    HANDLE file;
+    BOOL ok;
+
+    file = CreateFileA(path, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to open file: %s", path);
+        return false;
+    }
+    ok = GetFileInformationByHandle(file, &info);
+    CloseHandle(file);
+    if (!ok) {
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to query file: %s", path);
+        return false;
+    }
+
+    identity->device = info.dwVolumeSerialNumber;
+    identity->inode = (uint64_t)info.nFileIndexHigh << 32 | info.nFileIndexLow;
+    identity->size = (uint64_t)info.nFileSizeHigh << 32 | info.nFileSizeLow;
+    identity->modified = (uint64_t)info.ftLastWriteTime.dwHighDateTime << 32 | info.ftLastWriteTime.dwLowDateTime;
+    return true;
+#else
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to open file: %s", path);
+        return false;
+    }
+
+    identity->device = (uint64_t)st.st_dev;
+    identity->inode = (uint64_t)st.st_ino;
+    identity->size = (uint64_t)st.st_size;
+    // Nanoseconds, so a rewrite within the same second is still noticed
+#ifdef PLATFORM_MACOS
+    identity->modified = (uint64_t)st.st_mtimespec.tv_sec * 1000000000u + (uint64_t)st.st_mtimespec.tv_nsec;
+#else
+    identity->modified = (uint64_t)st.st_mtim.tv_sec * 1000000000u + (uint64_t)st.st_mtim.tv_nsec;
+#endif
+    return true;
+#endif
+}
+
+static bool sameIdentity(const BankIdentity* a, const BankIdentity* b) {
+    return a->device == b->device && a->inode == b->inode &&
+        a->size == b->size && a->modified == b->modified;
+}
+
+static BankEntry* findEntry(const BankIdentity* identity) {
+    BankEntry* entry;
+
+    for (entry = bank.entries; entry; entry = entry->next) {
+        if (sameIdentity(&entry->identity, identity)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Unlinks least recently used unreferenced entries until the bank fits its
+// budget and returns them as a list. Called with the mutex held.
+static BankEntry* takeEvicted(void) {
+    BankEntry* evicted = NULL;
+    BankEntry* entry;
+    BankEntry** link;
+    BankEntry** oldest;
+
+    while (bank.stats.residentBytes > bank.budget) {
+        oldest = NULL;
+        for (link = &bank.entries; *link; link = &(*link)->next) {
+            if ((*link)->refCount == 0 && (!oldest || (*link)->lastUsed < (*oldest)->lastUsed)) {
+                oldest = link;
+            }
+        }
+        if (!oldest) {
+            break;
+        }
+
+        entry = *oldest;
+        *oldest = entry->next;
+        entry->next = evicted;
+        evicted = entry;
+        bank.stats.residentBytes -= entry->bytes;
+        bank.stats.entries--;
+        bank.stats.evictions++;
+    }
+    return evicted;
+}
+
+static void freeEntries(BankEntry* entries) {
+    BankEntry* entry;
+
+    while (entries) {
+        entry = entries;
+        entries = entry->next;
+        freeWavFile(entry->wavFile);
+        free(entry);
+    }
+}
+
+const WavFile* coralBankAcquire(const char* path) {
+    BankIdentity identity;
+    BankEntry* entry;
+    BankEntry* added;
+    BankEntry* evicted;
+    WavFile* wavFile;
+
+    if (!path) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null file path");
+        return NULL;
+    }
+    if (!fileIdentity(path, &identity)) {
+        return NULL;
+    }
+
+    coralCallOnce(&bankOnce, bankInit);
+    coralMutexLock(&bank.mutex);
+    entry = findEntry(&identity);
+    if (entry) {
+        entry->refCount++;
+        entry->lastUsed = ++bank.clock;
+        bank.stats.hits++;
+        coralMutexUnlock(&bank.mutex);
+        return entry->wavFile;
+    }
+    bank.stats.misses++;
+    coralMutexUnlock(&bank.mutex);
+
+    // Parse outside the lock so other sounds can still be served
+    wavFile = loadWavFile(path);
+    added = wavFile ? (BankEntry*)malloc(sizeof(BankEntry)) : NULL;
+    if (!added) {
+        if (wavFile) {
+            freeWavFile(wavFile);
+            coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        }
+        return NULL;
+    }
+
+    coralMutexLock(&bank.mutex);
+    entry = findEntry(&identity);
+    if (entry) {
+        // Another thread loaded it first; share that copy
+        entry->refCount++;
+        entry->lastUsed = ++bank.clock;
+        coralMutexUnlock(&bank.mutex);
+        freeWavFile(wavFile);
+        free(added);
+        return entry->wavFile;
+    }
+
+    added->identity = identity;
+    added->wavFile = wavFile;
+    added->bytes = sizeof(WavFile) + (size_t)coralWavDataSize(wavFile);
+    added->refCount = 1;
+    added->lastUsed = ++bank.clock;
+    added->next = bank.entries;
+    bank.entries = added;
+    bank.stats.residentBytes += added->bytes;
+    bank.stats.entries++;
+    evicted = takeEvicted();
+    coralMutexUnlock(&bank.mutex);
+
+    freeEntries(evicted);
+    return wavFile;
+}
+
+void coralBankRelease(const WavFile* wavFile) {
+    BankEntry* entry;
+    BankEntry* evicted = NULL;
+
+    if (!wavFile) {
+        return;
+    }
+
+    coralCallOnce(&bankOnce, bankInit);
+    coralMutexLock(&bank.mutex);
+    for (entry = bank.entries; entry; entry = entry->next) {
+        if (entry->wavFile == wavFile) {
+            break;
+        }
+    }
+    if (entry && entry->refCount > 0) {
+        entry->refCount--;
+        entry->lastUsed = ++bank.clock;
+        evicted = takeEvicted();
+    }
+    coralMutexUnlock(&bank.mutex);
+
+    freeEntries(evicted);
+    if (!entry) {
+        coralSetError(CORAL_ERROR_INVALID_HANDLE, "WAV file does not belong to the sound bank");
+    }
+}
+
+void coralBankSetBudget(size_t bytes) {
+    BankEntry* evicted;
+
+    coralCallOnce(&bankOnce, bankInit);
+    coralMutexLock(&bank.mutex);
+    bank.budget = bytes;
+    bank.stats.budgetBytes = bytes;
+    evicted = takeEvicted();
+    coralMutexUnlock(&bank.mutex);
+
+    freeEntries(evicted);
+}
+
+void coralBankGetStats(CoralBankStats* stats) {
+    if (!stats) {
+        return;
+    }
+    coralCallOnce(&bankOnce, bankInit);
+    coralMutexLock(&bank.mutex);
+    *stats = bank.stats;
+    coralMutexUnlock(&bank.mutex);
+}
@@ -0,0 +1,94 @@
+/*
+@file - batch.c
+@developer - ColorProgrammy
+@brief - Parallel loading.
+@date - 16/10/2026
+@description - Loads a list of WAV files on a pool of worker threads.
+Workers take the next unclaimed path until the list is exhausted, so one
+slow file does not hold up the rest.
+*/
+
+#include "internal.h"
+
+#define BATCH_MAX_THREADS 64
+
+typedef struct {
+    CoralMutex mutex;
+    const char* const* paths;
+    size_t count;
+    size_t next;
+    size_t loaded;
+    WavFile** results;
+    CoralError* errors;
+} BatchJob;
+
+static void batchWorker(void* arg) {
+    BatchJob* job = (BatchJob*)arg;
+    WavFile* wavFile;
+    size_t index;
+    size_t loaded = 0;
+
+    for (;;) {
+        coralMutexLock(&job->mutex);
+        index = job->next++;
+        coralMutexUnlock(&job->mutex);
+        if (index >= job->count) {
+            break;
+        }
+
+        wavFile = loadWavFile(job->paths[index]);
+        job->results[index] = wavFile;
+        if (job->errors) {
+            job->errors[index] = wavFile ? CORAL_OK : coralGetLastError();
+        }
+        if (wavFile) {
+            loaded++;
+        }
+    }
+
+    coralMutexLock(&job->mutex);
+    job->loaded += loaded;
+    coralMutexUnlock(&job->mutex);
+}
+
+size_t loadWavFiles(const char* const* paths, size_t count, WavFile** results, CoralError* errors, uint32_t threads) {
+    CoralThread workers[BATCH_MAX_THREADS];
+    uint32_t started = 0;
+    uint32_t i;
+    BatchJob job;
+
+    if (!paths || !results) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null path or result array");
+        return 0;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    if (threads == 0) {
+        threads = coralCpuCount();
+    }
+    if (threads > BATCH_MAX_THREADS) threads = BATCH_MAX_THREADS;
+    if (threads > count) threads = (uint32_t)count;
+
+    memset(&job, 0, sizeof(job));
+    coralMutexInit(&job.mutex);
+    job.paths = paths;
+    job.count = count;
+    job.results = results;
+    job.errors = errors;
+
+    // The calling thread is one of the workers
+    for (i = 1; i < threads; ++i) {
+        if (coralThreadStart(&workers[started], batchWorker, &job)) {
+            started++;
+        }
+    }
+    batchWorker(&job);
+    for (i = 0; i < started; ++i) {
+        coralThreadJoin(workers[i]);
+    }
+
+    coralMutexDestroy(&job.mutex);
+    return job.loaded;
+}
@@ -0,0 +1,330 @@
+/*
+@file - codec.c
+@developer - ColorProgrammy
+@brief - Compressed WAV payloads.
+@date - 16/10/2026
+@description - Decodes G.711 A-law and mu-law and IMA ADPCM to float while
+the data stays compressed in memory. G.711 bytes map to samples through a
+256-entry table. IMA ADPCM is decoded a block at a time into a small cache,
+so any frame is reachable by decoding from the start of its block.
+*/
+
+#include "internal.h"
+
+#define IMA_MAX_INDEX 88
+
+typedef struct {
+    float alaw[256];
+    float mulaw[256];
+    int32_t imaDelta[IMA_MAX_INDEX + 1][16];    // Predictor change for each step index and nibble
+    uint8_t imaNext[IMA_MAX_INDEX + 1][16];     // Step index after each nibble
+} CodecTables;
+
+static CodecTables tables;
+static CoralOnce tablesOnce = CORAL_ONCE_INIT;
+
+static const int32_t imaSteps[IMA_MAX_INDEX + 1] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t imaIndexSteps[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+// G.711 expansions to 16-bit linear, as in the ITU reference code
+static int32_t expandAlaw(uint8_t value) {
+    int32_t segment;
+    int32_t sample;
+
+    value ^= 0x55;
+    sample = (value & 0x0F) << 4;
+    segment = (value & 0x70) >> 4;
+    if (segment == 0) {
+        sample += 8;
+    }
+    else {
+        sample = (sample + 0x108) << (segment - 1);
+    }
+    return (value & 0x80) ? sample : -sample;
+}
+
+static int32_t expandMulaw(uint8_t value) {
+    int32_t sample;
+
+    value = (uint8_t)~value;
+    sample = (((value & 0x0F) << 3) + 0x84) << ((value & 0x70) >> 4);
+    return (value & 0x80) ? 0x84 - sample : sample - 0x84;
+}
+
+static void tablesInit(void) {
+    int32_t step;
+    int32_t delta;
+    int32_t next;
+    int index;
+    int nibble;
+
+    for (index = 0; index < 256; ++index) {
+        tables.alaw[index] = (float)expandAlaw((uint8_t)index) * (1.0f / 32768.0f);
+        tables.mulaw[index] = (float)expandMulaw((uint8_t)index) * (1.0f / 32768.0f);
+    }
+
+    // The reference decoder builds each delta from shifted steps; folding
+    // that into a table leaves one add and one lookup per nibble
+    for (index = 0; index <= IMA_MAX_INDEX; ++index) {
+        step = imaSteps[index];
+        for (nibble = 0; nibble < 16; ++nibble) {
+            delta = step >> 3;
+            if (nibble & 1) delta += step >> 2;
+            if (nibble & 2) delta += step >> 1;
+            if (nibble & 4) delta += step;
+            tables.imaDelta[index][nibble] = (nibble & 8) ? -delta : delta;
+            next = index + imaIndexSteps[nibble & 7];
+            tables.imaNext[index][nibble] = (uint8_t)(next < 0 ? 0 : (next > IMA_MAX_INDEX ? IMA_MAX_INDEX : next));
+        }
+    }
+}
+
+CoralCodec coralCodecOf(const WavFormat* format) {
+    switch (format->audioFormat) {
+    case WAV_FORMAT_ALAW: return format->bitsPerSample == 8 ? CORAL_CODEC_ALAW : CORAL_CODEC_NONE;
+    case WAV_FORMAT_MULAW: return format->bitsPerSample == 8 ? CORAL_CODEC_MULAW : CORAL_CODEC_NONE;
+    case WAV_FORMAT_IMA_ADPCM: return format->bitsPerSample == 4 ? CORAL_CODEC_IMA_ADPCM : CORAL_CODEC_NONE;
+    default: return CORAL_CODEC_NONE;
+    }
+}
+
+// Each channel opens a block with a 4-byte header holding its first sample,
+// then 4-byte groups of eight nibbles follow, channels taking turns
+static uint32_t imaBlockFrames(uint16_t channels, uint64_t bytes) {
+    uint32_t header = 4u * channels;
+    return bytes < header ? 0 : (uint32_t)((bytes - header) / header * 8 + 1);
+}
+
+uint64_t coralFrameCount(const WavFormat* format, uint64_t dataSize) {
+    uint64_t blocks;
+
+    if (format->blockAlign == 0) {
+        return 0;
+    }
+    if (coralCodecOf(format) == CORAL_CODEC_IMA_ADPCM) {
+        blocks = dataSize / format->blockAlign;
+        return blocks * imaBlockFrames(format->numChannels, format->blockAlign) +
+            imaBlockFrames(format->numChannels, dataSize % format->blockAlign);
+    }
+    return dataSize / format->blockAlign;
+}
+
+bool coralCheckFormat(const WavFormat* format, const uint8_t* extra, size_t extraSize) {
+    uint16_t channels = format->numChannels;
+
+    switch (coralCodecOf(format)) {
+    case CORAL_CODEC_ALAW:
+    case CORAL_CODEC_MULAW:
+        if (channels == 0 || format->blockAlign != channels) {
+            coralSetError(CORAL_ERROR_INVALID_FORMAT, "Invalid block alignment");
+            return false;
+        }
+        return true;
+    case CORAL_CODEC_IMA_ADPCM:
+        if (channels == 0 || format->blockAlign % (4u * channels) != 0 || format->blockAlign <= 4u * channels) {
+            coralSetError(CORAL_ERROR_INVALID_FORMAT, "Invalid IMA ADPCM block size %u for %u channels",
+                (unsigned)format->blockAlign, (unsigned)channels);
+            return false;
+        }
+        // wSamplesPerBlock is implied by the block size; a file claiming otherwise is not one Coral can seek in
+        if (extraSize >= 4 && (extra[0] | extra[1] << 8) >= 2 &&
+            (uint32_t)(extra[2] | extra[3] << 8) != imaBlockFrames(channels, format->blockAlign)) {
+            coralSetError(CORAL_ERROR_UNSUPPORTED, "IMA ADPCM blocks of %u frames do not fill %u bytes",
+                (unsigned)(extra[2] | extra[3] << 8), (unsigned)format->blockAlign);
+            return false;
+        }
+        return true;
+    default:
+        // Everything else steps through the data a frame at a time
+        if (format->blockAlign == 0 || ((format->audioFormat == WAV_FORMAT_PCM || format->audioFormat == WAV_FORMAT_IEEE_FLOAT) &&
+            (channels == 0 || format->bitsPerSample % 8 != 0 || format->blockAlign != channels * (format->bitsPerSample / 8)))) {
+            coralSetError(CORAL_ERROR_INVALID_FORMAT, "Invalid block alignment %u for %u channels of %u bits",
+                (unsigned)format->blockAlign, (unsigned)channels, (unsigned)format->bitsPerSample);
+            return false;
+        }
+        return true;
+    }
+}
+
+bool coralPlaybackFormat(const WavFormat* format, WavFormat* playback, CoralSampleFormat* sampleFormat) {
+    if (coralCodecOf(format) == CORAL_CODEC_NONE) {
+        if (!coralSampleFormatOf(format, sampleFormat)) {
+            coralSetError(CORAL_ERROR_UNSUPPORTED, "Unsupported sample format: %d-bit, format tag %d",
+                format->bitsPerSample, format->audioFormat);
+            return false;
+        }
+        *playback = *format;
+        return true;
+    }
+
+    *sampleFormat = CORAL_SAMPLE_S16;
+    *playback = *format;
+    playback->subChunk1Size = 16;
+    playback->audioFormat = WAV_FORMAT_PCM;
+    playback->bitsPerSample = 16;
+    playback->blockAlign = (uint16_t)(format->numChannels * 2);
+    playback->byteRate = format->sampleRate * playback->blockAlign;
+    return true;
+}
+
+bool coralDecoderInit(CoralDecoder* decoder, const WavFile* wavFile) {
+    const WavFormat* format = &wavFile->wavFormat;
+
+    memset(decoder, 0, sizeof(CoralDecoder));
+    decoder->codec = coralCodecOf(format);
+    if (decoder->codec == CORAL_CODEC_NONE) {
+        return true;
+    }
+    if (!coralCheckFormat(format, NULL, 0)) {
+        return false;
+    }
+    coralCallOnce(&tablesOnce, tablesInit);
+
+    decoder->data = wavFile->data;
+    decoder->dataSize = coralWavDataSize(wavFile);
+    decoder->channels = format->numChannels;
+    decoder->blockAlign = format->blockAlign;
+    decoder->frames = coralFrameCount(format, decoder->dataSize);
+    if (decoder->codec == CORAL_CODEC_IMA_ADPCM) {
+        decoder->blockFrames = imaBlockFrames(format->numChannels, format->blockAlign);
+        decoder->blockIndex = (uint64_t)-1;
+        decoder->block = (int16_t*)malloc((size_t)decoder->blockFrames * decoder->channels * sizeof(int16_t));
+        if (!decoder->block) {
+            coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+            return false;
+        }
+    }
+    return true;
+}
+
+void coralDecoderSetData(CoralDecoder* decoder, const uint8_t* data, uint64_t dataSize) {
+    decoder->data = data;
+    decoder->dataSize = dataSize;
+    decoder->blockIndex = (uint64_t)-1;
+    if (decoder->codec == CORAL_CODEC_IMA_ADPCM) {
+        decoder->frames = dataSize / decoder->blockAlign * decoder->blockFrames +
+            imaBlockFrames(decoder->channels, dataSize % decoder->blockAlign);
+    }
+    else if (decoder->codec != CORAL_CODEC_NONE) {
+        decoder->frames = dataSize / decoder->channels;
+    }
+}
+
+void coralDecoderFree(CoralDecoder* decoder) {
+    free(decoder->block);
+    decoder->block = NULL;
+    decoder->codec = CORAL_CODEC_NONE;
+}
+
+static void expandG711Scalar(const float* table, const uint8_t* src, float* dst, size_t count) {
+    size_t i;
+
+    for (i = 0; i + 4 <= count; i += 4) {
+        dst[i] = table[src[i]];
+        dst[i + 1] = table[src[i + 1]];
+        dst[i + 2] = table[src[i + 2]];
+        dst[i + 3] = table[src[i + 3]];
+    }
+    for (; i < count; ++i) {
+        dst[i] = table[src[i]];
+    }
+}
+
+#if defined(CORAL_ARCH_X86) && defined(CORAL_HAVE_AVX2)
+// A gather looks up eight table entries at once
+static CORAL_TARGET_AVX2 void expandG711Avx2(const float* table, const uint8_t* src, float* dst, size_t count) {
+    __m256i index;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_i32gather_ps(table, index, 4));
+    }
+    expandG711Scalar(table, src + i, dst + i, count - i);
+}
+#endif
+
+static void expandG711(const float* table, const uint8_t* src, float* dst, size_t count) {
+    switch (coralGetSimdLevel()) {
+#if defined(CORAL_ARCH_X86) && defined(CORAL_HAVE_AVX2)
+    case CORAL_SIMD_AVX2: expandG711Avx2(table, src, dst, count); return;
+#endif
+    default: expandG711Scalar(table, src, dst, count); return;
+    }
+}
+
+// Decodes one block of bytes into interleaved 16-bit frames. The channels
+// are independent, so each runs its own predictor through the block.
+static void decodeImaBlock(const uint8_t* src, size_t bytes, uint16_t channels, int16_t* dst) {
+    uint32_t frames = imaBlockFrames(channels, bytes);
+    const uint8_t* group;
+    int32_t predictor;
+    uint32_t index;
+    uint32_t frame;
+    uint32_t nibble;
+    uint16_t c;
+    int k;
+
+    for (c = 0; c < channels; ++c) {
+        predictor = (int16_t)(src[4 * c] | src[4 * c + 1] << 8);
+        index = src[4 * c + 2] > IMA_MAX_INDEX ? IMA_MAX_INDEX : src[4 * c + 2];
+        dst[c] = (int16_t)predictor;
+
+        group = src + 4u * channels + 4u * c;
+        for (frame = 1; frame < frames; frame += 8, group += 4u * channels) {
+            for (k = 0; k < 8; ++k) {
+                nibble = (group[k >> 1] >> ((k & 1) * 4)) & 0x0F;
+                predictor += tables.imaDelta[index][nibble];
+                if (predictor > 32767) predictor = 32767;
+                else if (predictor < -32768) predictor = -32768;
+                index = tables.imaNext[index][nibble];
+                dst[(size_t)(frame + k) * channels + c] = (int16_t)predictor;
+            }
+        }
+    }
+}
+
+void coralDecoderRead(CoralDecoder* decoder, uint64_t frame, float* dst, size_t frames) {
+    uint16_t channels = decoder->channels;
+    uint64_t block;
+    uint64_t offset;
+    size_t bytes;
+    size_t take;
+
+    switch (decoder->codec) {
+    case CORAL_CODEC_ALAW:
+        expandG711(tables.alaw, decoder->data + frame * channels, dst, frames * channels);
+        return;
+    case CORAL_CODEC_MULAW:
+        expandG711(tables.mulaw, decoder->data + frame * channels, dst, frames * channels);
+        return;
+    case CORAL_CODEC_IMA_ADPCM:
+        while (frames > 0) {
+            block = frame / decoder->blockFrames;
+            if (block != decoder->blockIndex) {
+                offset = block * decoder->blockAlign;
+                bytes = decoder->dataSize - offset < decoder->blockAlign ?
+                    (size_t)(decoder->dataSize - offset) : decoder->blockAlign;
+                decodeImaBlock(decoder->data + offset, bytes, channels, decoder->block);
+                decoder->blockIndex = block;
+            }
+            offset = frame - block * decoder->blockFrames;
+            take = decoder->blockFrames - (size_t)offset;
+            if (take > frames) take = frames;
+            coralDecodeToFloat((const uint8_t*)(decoder->block + offset * channels), CORAL_SAMPLE_S16, dst, take * channels);
+            dst += take * channels;
+            frame += take;
+            frames -= take;
+        }
+        return;
+    default:
+        return;
+    }
+}
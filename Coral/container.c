@@ -0,0 +1,215 @@
+/*
+@file - container.c
+@developer - ColorProgrammy
+@brief - RIFF, RF64 and Wave64 header parsing.
+@date - 16/10/2026
+@description - One chunk walker serves the file, mapped and probe loaders.
+It reads through a callback, so each loader decides whether headers come
+from stdio, a mapping or a read-ahead window. RF64 takes sizes past 4 GiB
+from its ds64 chunk; Wave64 names chunks with GUIDs and sizes them with
+64-bit fields throughout.
+*/
+
+#include "internal.h"
+
+#define RIFF_SIZE_UNKNOWN 0xFFFFFFFFu
+#define DS64_BYTES 24               // RIFF size, data size and sample count
+#define W64_HEADER_BYTES 24         // 16-byte GUID and a 64-bit size that includes the header
+
+// Wave64 GUIDs: "riff" has its own tail, the rest share the one after "wave"
+static const uint8_t w64RiffTail[12] = {
+    0x2E, 0x91, 0xCF, 0x11, 0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00
+};
+static const uint8_t w64ChunkTail[12] = {
+    0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A
+};
+
+static uint32_t readLE32(const uint8_t* bytes) {
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+static uint64_t readLE64(const uint8_t* bytes) {
+    return (uint64_t)readLE32(bytes) | (uint64_t)readLE32(bytes + 4) << 32;
+}
+
+static uint32_t saturate32(uint64_t value) {
+    return value > RIFF_SIZE_UNKNOWN ? RIFF_SIZE_UNKNOWN : (uint32_t)value;
+}
+
+static bool parseFormat(CoralReadAt read, void* source, const CoralChunkInfo* chunk, WavFile* wavFile) {
+    uint8_t payload[16 + 24];
+    size_t size;
+
+    if (chunk->size < 16) {
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Invalid format chunk");
+        return false;
+    }
+    size = chunk->size < sizeof(payload) ? (size_t)chunk->size : sizeof(payload);
+    if (!read(source, chunk->offset, payload, size)) {
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Invalid format chunk");
+        return false;
+    }
+
+    memcpy(wavFile->wavFormat.subChunk1ID, "fmt ", 4);
+    wavFile->wavFormat.subChunk1Size = saturate32(chunk->size);
+    memcpy(&wavFile->wavFormat.audioFormat, payload, 16);
+    return coralApplyFormatExtension(wavFile, payload + 16, size - 16);
+}
+
+static bool parseSampler(CoralReadAt read, void* source, const CoralChunkInfo* chunk, WavFile* wavFile) {
+    uint8_t payload[SAMPLER_CHUNK_BYTES];
+    size_t size = chunk->size < sizeof(payload) ? (size_t)chunk->size : sizeof(payload);
+
+    if (!read(source, chunk->offset, payload, size)) {
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Invalid sampler chunk");
+        return false;
+    }
+    coralApplySamplerChunk(wavFile, payload, size);
+    return true;
+}
+
+// Reads the chunk header at pos. Returns false past the last whole header.
+static bool readChunkHeader(CoralReadAt read, void* source, CoralContainer container, uint64_t pos,
+    uint64_t fileSize, CoralChunkInfo* chunk, uint64_t* declared) {
+    uint8_t header[W64_HEADER_BYTES];
+    uint64_t headerBytes = container == CORAL_CONTAINER_WAVE64 ? W64_HEADER_BYTES : 8;
+
+    if (pos > fileSize || fileSize - pos < headerBytes || !read(source, pos, header, (size_t)headerBytes)) {
+        return false;
+    }
+    memcpy(chunk->id, header, 4);
+    chunk->offset = pos + headerBytes;
+    if (container == CORAL_CONTAINER_WAVE64) {
+        // Ids are GUIDs; the first four bytes spell the name for every chunk
+        // Coral reads. Sizes count the header, so anything shorter cannot be walked past.
+        *declared = readLE64(header + 16);
+        if (*declared < W64_HEADER_BYTES) {
+            return false;
+        }
+        *declared -= W64_HEADER_BYTES;
+    }
+    else {
+        *declared = readLE32(header + 4);
+    }
+    return true;
+}
+
+bool coralParseWav(CoralReadAt read, void* source, uint64_t fileSize, WavFile* wavFile, CoralWavLayout* layout) {
+    uint8_t header[W64_HEADER_BYTES + 16];
+    uint8_t ds64[DS64_BYTES];
+    CoralChunkInfo chunk;
+    CoralChunkInfo format;
+    CoralChunkInfo sampler;
+    uint64_t declared;
+    uint64_t riffSize = 0;
+    uint64_t largeDataSize = 0;
+    uint64_t pos;
+    bool haveFormat = false;
+    bool haveData = false;
+    bool haveSampler = false;
+
+    memset(&format, 0, sizeof(format));
+    memset(&sampler, 0, sizeof(sampler));
+    layout->chunkCount = 0;
+    layout->truncated = false;
+
+    if (fileSize < sizeof(RiffHeader) || !read(source, 0, header, sizeof(RiffHeader))) {
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Invalid WAV file header");
+        return false;
+    }
+    if (memcmp(header, "riff", 4) == 0) {
+        // Wave64: riff GUID, 64-bit size, then the wave GUID
+        if (fileSize < W64_HEADER_BYTES + 16 || !read(source, 0, header, W64_HEADER_BYTES + 16) ||
+            memcmp(header + 4, w64RiffTail, sizeof(w64RiffTail)) != 0 ||
+            memcmp(header + W64_HEADER_BYTES, "wave", 4) != 0 ||
+            memcmp(header + W64_HEADER_BYTES + 4, w64ChunkTail, sizeof(w64ChunkTail)) != 0) {
+            coralSetError(CORAL_ERROR_INVALID_FORMAT, "Not a valid WAV file");
+            return false;
+        }
+        layout->container = CORAL_CONTAINER_WAVE64;
+        riffSize = readLE64(header + 16);
+        pos = W64_HEADER_BYTES + 16;
+    }
+    else if ((memcmp(header, "RIFF", 4) == 0 || memcmp(header, "RF64", 4) == 0 || memcmp(header, "BW64", 4) == 0) &&
+        memcmp(header + 8, "WAVE", 4) == 0) {
+        layout->container = memcmp(header, "RIFF", 4) == 0 ? CORAL_CONTAINER_RIFF : CORAL_CONTAINER_RF64;
+        riffSize = readLE32(header + 4);
+        pos = sizeof(RiffHeader);
+    }
+    else {
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Not a valid WAV file");
+        return false;
+    }
+
+    if (layout->container == CORAL_CONTAINER_RF64) {
+        // ds64 must come first; it holds the sizes the 32-bit fields cannot
+        if (!readChunkHeader(read, source, layout->container, pos, fileSize, &chunk, &declared) ||
+            memcmp(chunk.id, "ds64", 4) != 0 || declared < DS64_BYTES ||
+            !read(source, chunk.offset, ds64, DS64_BYTES)) {
+            coralSetError(CORAL_ERROR_INVALID_FORMAT, "RF64 file without a ds64 chunk");
+            return false;
+        }
+        riffSize = readLE64(ds64);
+        largeDataSize = readLE64(ds64 + 8);
+    }
+
+    for (; readChunkHeader(read, source, layout->container, pos, fileSize, &chunk, &declared);
+        pos = chunk.offset + chunk.size + (layout->container == CORAL_CONTAINER_WAVE64 ? (8 - chunk.size % 8) % 8 : chunk.size & 1)) {
+        if (layout->container == CORAL_CONTAINER_RF64 && declared == RIFF_SIZE_UNKNOWN && memcmp(chunk.id, "data", 4) == 0) {
+            declared = largeDataSize;
+        }
+        chunk.size = declared;
+        if (declared > fileSize - chunk.offset) {
+            chunk.size = fileSize - chunk.offset;
+            // Writers that could not seek back leave a RIFF data size unset
+            if (memcmp(chunk.id, "data", 4) == 0 && !haveData &&
+                !(layout->container == CORAL_CONTAINER_RIFF && declared == RIFF_SIZE_UNKNOWN)) {
+                layout->truncated = true;
+            }
+        }
+
+        if (layout->chunks && layout->chunkCount < CORAL_MAX_CHUNKS) {
+            layout->chunks[layout->chunkCount] = chunk;
+        }
+        layout->chunkCount++;
+
+        if (memcmp(chunk.id, "fmt ", 4) == 0 && !haveFormat) {
+            format = chunk;
+            haveFormat = true;
+        }
+        else if (memcmp(chunk.id, "data", 4) == 0 && !haveData) {
+            layout->dataOffset = chunk.offset;
+            layout->dataSize = chunk.size;
+            haveData = true;
+        }
+        else if (memcmp(chunk.id, "smpl", 4) == 0 && !haveSampler) {
+            sampler = chunk;
+            haveSampler = true;
+        }
+    }
+
+    if (!haveFormat) {
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Format chunk missing");
+        return false;
+    }
+    if (!haveData) {
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Failed to find data chunk");
+        return false;
+    }
+    if (!parseFormat(read, source, &format, wavFile)) {
+        return false;
+    }
+    if (haveSampler && !parseSampler(read, source, &sampler, wavFile)) {
+        return false;
+    }
+
+    // The 32-bit header fields saturate; dataSize carries the real size
+    memcpy(wavFile->riffHeader.chunkID, header, 4);
+    wavFile->riffHeader.chunkSize = saturate32(riffSize);
+    memcpy(wavFile->riffHeader.format, "WAVE", 4);
+    memcpy(wavFile->wavData.subChunk2ID, "data", 4);
+    wavFile->wavData.subChunk2Size = saturate32(layout->dataSize);
+    wavFile->dataSize = layout->dataSize;
+    coralCheckLoop(wavFile);
+    return true;
+}
@@ -0,0 +1,693 @@
+/*
+@file - convert.c
+@developer - ColorProgrammy
+@brief - Sample format conversion.
+@date - 16/10/2026
+@description - Converts between U8, S16, packed S24, S24 in 32 bits, S32
+and float32, interleaved or planar. Integer samples go through normalized
+float, so every pair of formats needs only one decode and one encode
+kernel; encoding saturates and rounds to nearest.
+*/
+
+#include "internal.h"
+
+#define CONVERT_BLOCK_SAMPLES 4096
+
+typedef void (*DecodeFunc)(const uint8_t* src, float* dst, size_t count);
+typedef void (*EncodeFunc)(const float* src, uint8_t* dst, size_t count);
+
+typedef struct {
+    DecodeFunc decode[CORAL_SAMPLE_FORMAT_COUNT];
+    EncodeFunc encode[CORAL_SAMPLE_FORMAT_COUNT];
+} ConvertKernels;
+
+// Round to nearest, ties to even, without relying on lrintf. Adding 2^23
+// pushes the fraction out of the mantissa; larger values are already whole.
+static int32_t roundToInt(float value) {
+    if (value >= 8388608.0f || value <= -8388608.0f) {
+        return (int32_t)value;
+    }
+    if (value >= 0.0f) {
+        return (int32_t)((value + 8388608.0f) - 8388608.0f);
+    }
+    return -(int32_t)((-value + 8388608.0f) - 8388608.0f);
+}
+
+static void decodeU8Scalar(const uint8_t* src, float* dst, size_t count) {
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        dst[i] = (float)((int32_t)src[i] - 128) * (1.0f / 128.0f);
+    }
+}
+
+static void decodeS16Scalar(const uint8_t* src, float* dst, size_t count) {
+    const int16_t* samples = (const int16_t*)src;
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        dst[i] = (float)samples[i] * (1.0f / 32768.0f);
+    }
+}
+
+static void decodeS24Scalar(const uint8_t* src, float* dst, size_t count) {
+    size_t i;
+    int32_t sample;
+    for (i = 0; i < count; ++i, src += 3) {
+        sample = (int32_t)((uint32_t)src[0] << 8 | (uint32_t)src[1] << 16 | (uint32_t)src[2] << 24) >> 8;
+        dst[i] = (float)sample * (1.0f / 8388608.0f);
+    }
+}
+
+// The upper byte of S24_32 is ignored, as ALSA does
+static void decodeS24In32Scalar(const uint8_t* src, float* dst, size_t count) {
+    const int32_t* samples = (const int32_t*)src;
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        dst[i] = (float)((int32_t)((uint32_t)samples[i] << 8) >> 8) * (1.0f / 8388608.0f);
+    }
+}
+
+static void decodeS32Scalar(const uint8_t* src, float* dst, size_t count) {
+    const int32_t* samples = (const int32_t*)src;
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        dst[i] = (float)samples[i] * (1.0f / 2147483648.0f);
+    }
+}
+
+static void decodeF32(const uint8_t* src, float* dst, size_t count) {
+    memcpy(dst, src, count * sizeof(float));
+}
+
+static void encodeU8Scalar(const float* src, uint8_t* dst, size_t count) {
+    size_t i;
+    float scaled;
+    for (i = 0; i < count; ++i) {
+        scaled = src[i] * 128.0f;
+        if (scaled < -128.0f) scaled = -128.0f;
+        else if (scaled > 127.0f) scaled = 127.0f;
+        dst[i] = (uint8_t)(roundToInt(scaled) + 128);
+    }
+}
+
+static void encodeS16Scalar(const float* src, uint8_t* dst, size_t count) {
+    int16_t* samples = (int16_t*)dst;
+    size_t i;
+    float scaled;
+    for (i = 0; i < count; ++i) {
+        scaled = src[i] * 32768.0f;
+        if (scaled < -32768.0f) scaled = -32768.0f;
+        else if (scaled > 32767.0f) scaled = 32767.0f;
+        samples[i] = (int16_t)roundToInt(scaled);
+    }
+}
+
+static int32_t encode24(float value) {
+    float scaled = value * 8388608.0f;
+    if (scaled < -8388608.0f) scaled = -8388608.0f;
+    else if (scaled > 8388607.0f) scaled = 8388607.0f;
+    return roundToInt(scaled);
+}
+
+static void encodeS24Scalar(const float* src, uint8_t* dst, size_t count) {
+    size_t i;
+    int32_t value;
+    for (i = 0; i < count; ++i, dst += 3) {
+        value = encode24(src[i]);
+        dst[0] = (uint8_t)value;
+        dst[1] = (uint8_t)(value >> 8);
+        dst[2] = (uint8_t)(value >> 16);
+    }
+}
+
+static void encodeS24In32Scalar(const float* src, uint8_t* dst, size_t count) {
+    int32_t* samples = (int32_t*)dst;
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        samples[i] = encode24(src[i]);
+    }
+}
+
+static void encodeS32Scalar(const float* src, uint8_t* dst, size_t count) {
+    int32_t* samples = (int32_t*)dst;
+    size_t i;
+    float scaled;
+    for (i = 0; i < count; ++i) {
+        scaled = src[i] * 2147483648.0f;
+        if (scaled >= 2147483648.0f) samples[i] = INT32_MAX;
+        else if (scaled <= -2147483648.0f) samples[i] = INT32_MIN;
+        else samples[i] = roundToInt(scaled);
+    }
+}
+
+static void encodeF32(const float* src, uint8_t* dst, size_t count) {
+    memcpy(dst, src, count * sizeof(float));
+}
+
+static const ConvertKernels scalarKernels = {
+    { decodeU8Scalar, decodeS16Scalar, decodeS24Scalar, decodeS24In32Scalar, decodeS32Scalar, decodeF32 },
+    { encodeU8Scalar, encodeS16Scalar, encodeS24Scalar, encodeS24In32Scalar, encodeS32Scalar, encodeF32 }
+};
+
+#ifdef CORAL_ARCH_X86
+static CORAL_TARGET_SSE2 void decodeU8Sse2(const uint8_t* src, float* dst, size_t count) {
+    __m128 scale = _mm_set1_ps(1.0f / 128.0f);
+    __m128i bias = _mm_set1_epi16(128);
+    __m128i zero = _mm_setzero_si128();
+    __m128i v, lo, hi;
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        v = _mm_loadu_si128((const __m128i*)(src + i));
+        lo = _mm_sub_epi16(_mm_unpacklo_epi8(v, zero), bias);
+        hi = _mm_sub_epi16(_mm_unpackhi_epi8(v, zero), bias);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16)), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16)), scale));
+        _mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16)), scale));
+        _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16)), scale));
+    }
+    decodeU8Scalar(src + i, dst + i, count - i);
+}
+
+static CORAL_TARGET_SSE2 void decodeS16Sse2(const uint8_t* src, float* dst, size_t count) {
+    const int16_t* samples = (const int16_t*)src;
+    __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    __m128i v;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        v = _mm_loadu_si128((const __m128i*)(samples + i));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)), scale));
+    }
+    decodeS16Scalar(src + i * 2, dst + i, count - i);
+}
+
+static CORAL_TARGET_SSE2 void decodeS24In32Sse2(const uint8_t* src, float* dst, size_t count) {
+    const int32_t* samples = (const int32_t*)src;
+    __m128 scale = _mm_set1_ps(1.0f / 8388608.0f);
+    __m128i v;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        v = _mm_loadu_si128((const __m128i*)(samples + i));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(v, 8), 8)), scale));
+    }
+    decodeS24In32Scalar(src + i * 4, dst + i, count - i);
+}
+
+static CORAL_TARGET_SSE2 void decodeS32Sse2(const uint8_t* src, float* dst, size_t count) {
+    const int32_t* samples = (const int32_t*)src;
+    __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+    __m128i v;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        v = _mm_loadu_si128((const __m128i*)(samples + i));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+    decodeS32Scalar(src + i * 4, dst + i, count - i);
+}
+
+// Scales, clamps and rounds four floats (round to nearest even, as the
+// scalar path does)
+static CORAL_TARGET_SSE2 __m128i quantizeSse2(__m128 v, __m128 scale, __m128 lo, __m128 hi) {
+    return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(v, scale), lo), hi));
+}
+
+static CORAL_TARGET_SSE2 void encodeU8Sse2(const float* src, uint8_t* dst, size_t count) {
+    __m128 scale = _mm_set1_ps(128.0f);
+    __m128 lo = _mm_set1_ps(-128.0f);
+    __m128 hi = _mm_set1_ps(127.0f);
+    __m128i bias = _mm_set1_epi16(128);
+    __m128i a, b, c, d;
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        a = quantizeSse2(_mm_loadu_ps(src + i), scale, lo, hi);
+        b = quantizeSse2(_mm_loadu_ps(src + i + 4), scale, lo, hi);
+        c = quantizeSse2(_mm_loadu_ps(src + i + 8), scale, lo, hi);
+        d = quantizeSse2(_mm_loadu_ps(src + i + 12), scale, lo, hi);
+        a = _mm_add_epi16(_mm_packs_epi32(a, b), bias);
+        c = _mm_add_epi16(_mm_packs_epi32(c, d), bias);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(a, c));
+    }
+    encodeU8Scalar(src + i, dst + i, count - i);
+}
+
+static CORAL_TARGET_SSE2 void encodeS16Sse2(const float* src, uint8_t* dst, size_t count) {
+    int16_t* samples = (int16_t*)dst;
+    __m128 scale = _mm_set1_ps(32768.0f);
+    __m128 lo = _mm_set1_ps(-32768.0f);
+    __m128 hi = _mm_set1_ps(32767.0f);
+    __m128i a, b;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        a = quantizeSse2(_mm_loadu_ps(src + i), scale, lo, hi);
+        b = quantizeSse2(_mm_loadu_ps(src + i + 4), scale, lo, hi);
+        _mm_storeu_si128((__m128i*)(samples + i), _mm_packs_epi32(a, b));
+    }
+    encodeS16Scalar(src + i, dst + i * 2, count - i);
+}
+
+static CORAL_TARGET_SSE2 void encodeS24In32Sse2(const float* src, uint8_t* dst, size_t count) {
+    int32_t* samples = (int32_t*)dst;
+    __m128 scale = _mm_set1_ps(8388608.0f);
+    __m128 lo = _mm_set1_ps(-8388608.0f);
+    __m128 hi = _mm_set1_ps(8388607.0f);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i*)(samples + i), quantizeSse2(_mm_loadu_ps(src + i), scale, lo, hi));
+    }
+    encodeS24In32Scalar(src + i, dst + i * 4, count - i);
+}
+
+static CORAL_TARGET_SSE2 void encodeS32Sse2(const float* src, uint8_t* dst, size_t count) {
+    int32_t* samples = (int32_t*)dst;
+    __m128 scale = _mm_set1_ps(2147483648.0f);
+    __m128i max = _mm_set1_epi32(INT32_MAX);
+    __m128 scaled, over;
+    __m128i v;
+    size_t i = 0;
+
+    // cvtps returns INT32_MIN for anything out of range, which is already
+    // right for negative overflow; positive overflow is patched to INT32_MAX
+    for (; i + 4 <= count; i += 4) {
+        scaled = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+        over = _mm_cmpge_ps(scaled, scale);
+        v = _mm_cvtps_epi32(scaled);
+        v = _mm_or_si128(_mm_andnot_si128(_mm_castps_si128(over), v), _mm_and_si128(_mm_castps_si128(over), max));
+        _mm_storeu_si128((__m128i*)(samples + i), v);
+    }
+    encodeS32Scalar(src + i, dst + i * 4, count - i);
+}
+
+static const ConvertKernels sse2Kernels = {
+    { decodeU8Sse2, decodeS16Sse2, decodeS24Scalar, decodeS24In32Sse2, decodeS32Sse2, decodeF32 },
+    { encodeU8Sse2, encodeS16Sse2, encodeS24Scalar, encodeS24In32Sse2, encodeS32Sse2, encodeF32 }
+};
+
+#ifdef CORAL_HAVE_AVX2
+static CORAL_TARGET_AVX2 void decodeU8Avx2(const uint8_t* src, float* dst, size_t count) {
+    __m256 scale = _mm256_set1_ps(1.0f / 128.0f);
+    __m256i bias = _mm256_set1_epi32(128);
+    __m256i v;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        v = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i))), bias);
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    decodeU8Scalar(src + i, dst + i, count - i);
+}
+
+static CORAL_TARGET_AVX2 void decodeS16Avx2(const uint8_t* src, float* dst, size_t count) {
+    const int16_t* samples = (const int16_t*)src;
+    __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+    __m256i v;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(samples + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    decodeS16Scalar(src + i * 2, dst + i, count - i);
+}
+
+static CORAL_TARGET_AVX2 void decodeS24Avx2(const uint8_t* src, float* dst, size_t count) {
+    __m256 scale = _mm256_set1_ps(1.0f / 8388608.0f);
+    // Sample k's three bytes go to the top of dword k; srai then sign-extends
+    __m128i unpack = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    __m128i s0, s1;
+    __m256i v;
+    const uint8_t* p = src;
+    size_t i = 0;
+
+    // Each 16-byte load covers four samples plus four bytes of the next, so
+    // stop while two spare samples remain
+    for (; i + 10 <= count; i += 8, p += 24) {
+        s0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)p), unpack);
+        s1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 12)), unpack);
+        v = _mm256_inserti128_si256(_mm256_castsi128_si256(s0), s1, 1);
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(v, 8)), scale));
+    }
+    decodeS24Scalar(p, dst + i, count - i);
+}
+
+static CORAL_TARGET_AVX2 void decodeS24In32Avx2(const uint8_t* src, float* dst, size_t count) {
+    const int32_t* samples = (const int32_t*)src;
+    __m256 scale = _mm256_set1_ps(1.0f / 8388608.0f);
+    __m256i v;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        v = _mm256_loadu_si256((const __m256i*)(samples + i));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(v, 8), 8)), scale));
+    }
+    decodeS24In32Scalar(src + i * 4, dst + i, count - i);
+}
+
+static CORAL_TARGET_AVX2 void decodeS32Avx2(const uint8_t* src, float* dst, size_t count) {
+    const int32_t* samples = (const int32_t*)src;
+    __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(samples + i))), scale));
+    }
+    decodeS32Scalar(src + i * 4, dst + i, count - i);
+}
+
+static CORAL_TARGET_AVX2 __m256i quantizeAvx2(__m256 v, __m256 scale, __m256 lo, __m256 hi) {
+    return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(v, scale), lo), hi));
+}
+
+static CORAL_TARGET_AVX2 void encodeS16Avx2(const float* src, uint8_t* dst, size_t count) {
+    int16_t* samples = (int16_t*)dst;
+    __m256 scale = _mm256_set1_ps(32768.0f);
+    __m256 lo = _mm256_set1_ps(-32768.0f);
+    __m256 hi = _mm256_set1_ps(32767.0f);
+    __m256i a, b;
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        a = quantizeAvx2(_mm256_loadu_ps(src + i), scale, lo, hi);
+        b = quantizeAvx2(_mm256_loadu_ps(src + i + 8), scale, lo, hi);
+        _mm256_storeu_si256((__m256i*)(samples + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8));
+    }
+    encodeS16Scalar(src + i, dst + i * 2, count - i);
+}
+
+static CORAL_TARGET_AVX2 void encodeS24Avx2(const float* src, uint8_t* dst, size_t count) {
+    __m256 scale = _mm256_set1_ps(8388608.0f);
+    __m256 lo = _mm256_set1_ps(-8388608.0f);
+    __m256 hi = _mm256_set1_ps(8388607.0f);
+    __m128i repack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    __m128i s0, s1;
+    __m256i v;
+    int32_t tail;
+    uint8_t* p = dst;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8, p += 24) {
+        v = quantizeAvx2(_mm256_loadu_ps(src + i), scale, lo, hi);
+        s0 = _mm_shuffle_epi8(_mm256_castsi256_si128(v), repack);
+        s1 = _mm_shuffle_epi8(_mm256_extracti128_si256(v, 1), repack);
+        _mm_storel_epi64((__m128i*)p, s0);
+        tail = _mm_cvtsi128_si32(_mm_srli_si128(s0, 8));
+        memcpy(p + 8, &tail, 4);
+        _mm_storel_epi64((__m128i*)(p + 12), s1);
+        tail = _mm_cvtsi128_si32(_mm_srli_si128(s1, 8));
+        memcpy(p + 20, &tail, 4);
+    }
+    encodeS24Scalar(src + i, p, count - i);
+}
+
+static CORAL_TARGET_AVX2 void encodeS24In32Avx2(const float* src, uint8_t* dst, size_t count) {
+    int32_t* samples = (int32_t*)dst;
+    __m256 scale = _mm256_set1_ps(8388608.0f);
+    __m256 lo = _mm256_set1_ps(-8388608.0f);
+    __m256 hi = _mm256_set1_ps(8388607.0f);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_si256((__m256i*)(samples + i), quantizeAvx2(_mm256_loadu_ps(src + i), scale, lo, hi));
+    }
+    encodeS24In32Scalar(src + i, dst + i * 4, count - i);
+}
+
+static CORAL_TARGET_AVX2 void encodeS32Avx2(const float* src, uint8_t* dst, size_t count) {
+    int32_t* samples = (int32_t*)dst;
+    __m256 scale = _mm256_set1_ps(2147483648.0f);
+    __m256i max = _mm256_set1_epi32(INT32_MAX);
+    __m256 scaled;
+    __m256i over;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        scaled = _mm256_mul_ps(_mm256_loadu_ps(src + i), scale);
+        over = _mm256_castps_si256(_mm256_cmp_ps(scaled, scale, _CMP_GE_OQ));
+        _mm256_storeu_si256((__m256i*)(samples + i), _mm256_blendv_epi8(_mm256_cvtps_epi32(scaled), max, over));
+    }
+    encodeS32Scalar(src + i, dst + i * 4, count - i);
+}
+
+static const ConvertKernels avx2Kernels = {
+    { decodeU8Avx2, decodeS16Avx2, decodeS24Avx2, decodeS24In32Avx2, decodeS32Avx2, decodeF32 },
+    { encodeU8Sse2, encodeS16Avx2, encodeS24Avx2, encodeS24In32Avx2, encodeS32Avx2, encodeF32 }
+};
+#endif
+#endif
+
+#ifdef CORAL_ARCH_NEON
+static void decodeU8Neon(const uint8_t* src, float* dst, size_t count) {
+    int16x8_t bias = vdupq_n_s16(128);
+    int16x8_t v;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(src + i))), bias);
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), 1.0f / 128.0f));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), 1.0f / 128.0f));
+    }
+    decodeU8Scalar(src + i, dst + i, count - i);
+}
+
+static void decodeS16Neon(const uint8_t* src, float* dst, size_t count) {
+    const int16_t* samples = (const int16_t*)src;
+    int16x8_t v;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        v = vld1q_s16(samples + i);
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), 1.0f / 32768.0f));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), 1.0f / 32768.0f));
+    }
+    decodeS16Scalar(src + i * 2, dst + i, count - i);
+}
+
+static void decodeS24In32Neon(const uint8_t* src, float* dst, size_t count) {
+    const int32_t* samples = (const int32_t*)src;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vshrq_n_s32(vshlq_n_s32(vld1q_s32(samples + i), 8), 8)), 1.0f / 8388608.0f));
+    }
+    decodeS24In32Scalar(src + i * 4, dst + i, count - i);
+}
+
+static void decodeS32Neon(const uint8_t* src, float* dst, size_t count) {
+    const int32_t* samples = (const int32_t*)src;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(samples + i)), 1.0f / 2147483648.0f));
+    }
+    decodeS32Scalar(src + i * 4, dst + i, count - i);
+}
+
+// Round-to-nearest conversion (vcvtnq) only exists on AArch64; 32-bit NEON
+// keeps the scalar encoders so results match the other paths
+#if defined(__aarch64__) || defined(_M_ARM64)
+static int32x4_t quantizeNeon(float32x4_t v, float scale, float lo, float hi) {
+    return vcvtnq_s32_f32(vminq_f32(vmaxq_f32(vmulq_n_f32(v, scale), vdupq_n_f32(lo)), vdupq_n_f32(hi)));
+}
+
+static void encodeS16Neon(const float* src, uint8_t* dst, size_t count) {
+    int16_t* samples = (int16_t*)dst;
+    int32x4_t a, b;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        a = quantizeNeon(vld1q_f32(src + i), 32768.0f, -32768.0f, 32767.0f);
+        b = quantizeNeon(vld1q_f32(src + i + 4), 32768.0f, -32768.0f, 32767.0f);
+        vst1q_s16(samples + i, vcombine_s16(vmovn_s32(a), vmovn_s32(b)));
+    }
+    encodeS16Scalar(src + i, dst + i * 2, count - i);
+}
+
+static void encodeS24In32Neon(const float* src, uint8_t* dst, size_t count) {
+    int32_t* samples = (int32_t*)dst;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        vst1q_s32(samples + i, quantizeNeon(vld1q_f32(src + i), 8388608.0f, -8388608.0f, 8388607.0f));
+    }
+    encodeS24In32Scalar(src + i, dst + i * 4, count - i);
+}
+
+// vcvtnq saturates, so no clamp is needed for S32
+static void encodeS32Neon(const float* src, uint8_t* dst, size_t count) {
+    int32_t* samples = (int32_t*)dst;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        vst1q_s32(samples + i, vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(src + i), 2147483648.0f)));
+    }
+    encodeS32Scalar(src + i, dst + i * 4, count - i);
+}
+#define encodeS16Neon_ encodeS16Neon
+#define encodeS24In32Neon_ encodeS24In32Neon
+#define encodeS32Neon_ encodeS32Neon
+#else
+#define encodeS16Neon_ encodeS16Scalar
+#define encodeS24In32Neon_ encodeS24In32Scalar
+#define encodeS32Neon_ encodeS32Scalar
+#endif
+
+static const ConvertKernels neonKernels = {
+    { decodeU8Neon, decodeS16Neon, decodeS24Scalar, decodeS24In32Neon, decodeS32Neon, decodeF32 },
+    { encodeU8Scalar, encodeS16Neon_, encodeS24Scalar, encodeS24In32Neon_, encodeS32Neon_, encodeF32 }
+};
+#endif
+
+static const ConvertKernels* selectKernels(void) {
+    switch (coralGetSimdLevel()) {
+#ifdef CORAL_ARCH_X86
+#ifdef CORAL_HAVE_AVX2
+    case CORAL_SIMD_AVX2: return &avx2Kernels;
+#endif
+    case CORAL_SIMD_SSE2: return &sse2Kernels;
+#endif
+#ifdef CORAL_ARCH_NEON
+    case CORAL_SIMD_NEON: return &neonKernels;
+#endif
+    default: return &scalarKernels;
+    }
+}
+
+static bool validFormat(CoralSampleFormat format) {
+    return (int)format >= 0 && format < CORAL_SAMPLE_FORMAT_COUNT;
+}
+
+uint32_t coralSampleSize(CoralSampleFormat format) {
+    static const uint8_t sizes[CORAL_SAMPLE_FORMAT_COUNT] = { 1, 2, 3, 4, 4, 4 };
+    return validFormat(format) ? sizes[format] : 0;
+}
+
+bool coralSampleFormatOf(const WavFormat* format, CoralSampleFormat* sampleFormat) {
+    if (format->audioFormat == WAV_FORMAT_IEEE_FLOAT && format->bitsPerSample == 32) {
+        *sampleFormat = CORAL_SAMPLE_F32;
+        return true;
+    }
+    if (format->audioFormat != WAV_FORMAT_PCM) {
+        return false;
+    }
+    switch (format->bitsPerSample) {
+    case 8:  *sampleFormat = CORAL_SAMPLE_U8; return true;
+    case 16: *sampleFormat = CORAL_SAMPLE_S16; return true;
+    case 24: *sampleFormat = CORAL_SAMPLE_S24; return true;
+    case 32: *sampleFormat = CORAL_SAMPLE_S32; return true;
+    default: return false;
+    }
+}
+
+void coralDecodeToFloat(const uint8_t* src, CoralSampleFormat format, float* dst, size_t count) {
+    selectKernels()->decode[format](src, dst, count);
+}
+
+void coralEncodeFromFloat(const float* src, uint8_t* dst, CoralSampleFormat format, size_t count) {
+    selectKernels()->encode[format](src, dst, count);
+}
+
+bool coralConvertSamples(const void* src, CoralSampleFormat srcFormat, void* dst, CoralSampleFormat dstFormat, size_t count) {
+    const ConvertKernels* kernels;
+    float block[CONVERT_BLOCK_SAMPLES];
+    const uint8_t* in = (const uint8_t*)src;
+    uint8_t* out = (uint8_t*)dst;
+    size_t chunk;
+
+    if (!src || !dst) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null sample buffer");
+        return false;
+    }
+    if (!validFormat(srcFormat) || !validFormat(dstFormat)) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Unknown sample format");
+        return false;
+    }
+    if (srcFormat == dstFormat) {
+        memmove(dst, src, count * coralSampleSize(srcFormat));
+        return true;
+    }
+
+    kernels = selectKernels();
+    while (count > 0) {
+        chunk = count < CONVERT_BLOCK_SAMPLES ? count : CONVERT_BLOCK_SAMPLES;
+        kernels->decode[srcFormat](in, block, chunk);
+        kernels->encode[dstFormat](block, out, chunk);
+        in += chunk * coralSampleSize(srcFormat);
+        out += chunk * coralSampleSize(dstFormat);
+        count -= chunk;
+    }
+    return true;
+}
+
+bool coralConvertFrames(const void* const* src, CoralSampleFormat srcFormat, bool srcPlanar,
+    void* const* dst, CoralSampleFormat dstFormat, bool dstPlanar, uint16_t channels, size_t frames) {
+    const ConvertKernels* kernels;
+    float block[CONVERT_BLOCK_SAMPLES];
+    float swapped[CONVERT_BLOCK_SAMPLES];
+    float* result;
+    uint32_t srcSize = coralSampleSize(srcFormat);
+    uint32_t dstSize = coralSampleSize(dstFormat);
+    size_t blockFrames;
+    size_t done;
+    size_t chunk;
+    size_t f;
+    uint16_t c;
+
+    if (!src || !dst || channels == 0) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null sample buffer or no channels");
+        return false;
+    }
+    if (!validFormat(srcFormat) || !validFormat(dstFormat)) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Unknown sample format");
+        return false;
+    }
+    if (channels > CONVERT_BLOCK_SAMPLES) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Too many channels: %d", channels);
+        return false;
+    }
+    if (!srcPlanar && !dstPlanar) {
+        return coralConvertSamples(src[0], srcFormat, dst[0], dstFormat, frames * channels);
+    }
+
+    kernels = selectKernels();
+    blockFrames = CONVERT_BLOCK_SAMPLES / channels;
+    for (done = 0; done < frames; done += chunk) {
+        chunk = frames - done < blockFrames ? frames - done : blockFrames;
+
+        // Decode into float, planar or interleaved as the source is
+        if (srcPlanar) {
+            for (c = 0; c < channels; ++c) {
+                kernels->decode[srcFormat]((const uint8_t*)src[c] + done * srcSize, block + c * chunk, chunk);
+            }
+        }
+        else {
+            kernels->decode[srcFormat]((const uint8_t*)src[0] + done * channels * srcSize, block, chunk * channels);
+        }
+
+        // Transpose when the layouts differ
+        result = block;
+        if (srcPlanar != dstPlanar) {
+            for (c = 0; c < channels; ++c) {
+                for (f = 0; f < chunk; ++f) {
+                    if (srcPlanar) swapped[f * channels + c] = block[c * chunk + f];
+                    else swapped[c * chunk + f] = block[f * channels + c];
+                }
+            }
+            result = swapped;
+        }
+
+        if (dstPlanar) {
+            for (c = 0; c < channels; ++c) {
+                kernels->encode[dstFormat](result + c * chunk, (uint8_t*)dst[c] + done * dstSize, chunk);
+            }
+        }
+        else {
+            kernels->encode[dstFormat](result, (uint8_t*)dst[0] + done * channels * dstSize, chunk * channels);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,133 @@
+/*
+@file - cpu.c
+@developer - ColorProgrammy
+@brief - Runtime CPU feature detection.
+@date - 16/10/2026
+@description - Detects the widest instruction set the processor and OS
+support once, and lets callers lower it for testing. Also reports the
+number of online CPUs for sizing worker pools.
+*/
+
+#include "internal.h"
+
+#if defined(CORAL_ARCH_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(CORAL_ARCH_X86)
+#include <cpuid.h>
+#endif
+
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)
+#include <unistd.h>
+#endif
+
+static int detectedLevel = -1;
+static int activeLevel = -1;
+
+#ifdef CORAL_ARCH_X86
+static void readCpuid(int leaf, int subleaf, unsigned int regs[4]) {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuidex(info, leaf, subleaf);
+    regs[0] = (unsigned int)info[0];
+    regs[1] = (unsigned int)info[1];
+    regs[2] = (unsigned int)info[2];
+    regs[3] = (unsigned int)info[3];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// AVX state must be enabled by the OS, not just reported by CPUID
+static bool osSavesAvxState(void) {
+#ifdef _MSC_VER
+    return (_xgetbv(0) & 0x6) == 0x6;
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (eax & 0x6) == 0x6;
+#endif
+}
+#endif
+
+static CoralSimdLevel detectSimdLevel(void) {
+#ifdef CORAL_ARCH_X86
+    unsigned int regs[4];
+    unsigned int maxLeaf;
+    CoralSimdLevel level = CORAL_SIMD_SCALAR;
+
+    readCpuid(0, 0, regs);
+    maxLeaf = regs[0];
+    if (maxLeaf < 1) {
+        return level;
+    }
+
+    readCpuid(1, 0, regs);
+    if (regs[3] & (1u << 26)) {
+        level = CORAL_SIMD_SSE2;
+    }
+
+#ifdef CORAL_HAVE_AVX2
+    // OSXSAVE and AVX in leaf 1, AVX2 in leaf 7
+    if (level == CORAL_SIMD_SSE2 && maxLeaf >= 7 &&
+        (regs[2] & (1u << 27)) && (regs[2] & (1u << 28)) && osSavesAvxState()) {
+        readCpuid(7, 0, regs);
+        if (regs[1] & (1u << 5)) {
+            level = CORAL_SIMD_AVX2;
+        }
+    }
+#endif
+    return level;
+
+#elif defined(CORAL_ARCH_NEON)
+    return CORAL_SIMD_NEON;
+#else
+    return CORAL_SIMD_SCALAR;
+#endif
+}
+
+CoralSimdLevel coralGetSimdLevel(void) {
+    // Racing first calls all store the same values
+    if (activeLevel < 0) {
+        detectedLevel = (int)detectSimdLevel();
+        activeLevel = detectedLevel;
+    }
+    return (CoralSimdLevel)activeLevel;
+}
+
+bool coralSetSimdLevel(CoralSimdLevel level) {
+    coralGetSimdLevel();
+
+    if (level == CORAL_SIMD_SCALAR) {
+        activeLevel = level;
+        return true;
+    }
+#ifdef CORAL_ARCH_X86
+    if ((level == CORAL_SIMD_SSE2 || level == CORAL_SIMD_AVX2) && (int)level <= detectedLevel) {
+        activeLevel = level;
+        return true;
+    }
+#elif defined(CORAL_ARCH_NEON)
+    if (level == CORAL_SIMD_NEON) {
+        activeLevel = level;
+        return true;
+    }
+#endif
+
+    coralSetError(CORAL_ERROR_UNSUPPORTED, "SIMD level %d is not supported on this CPU", (int)level);
+    return false;
+}
+
+uint32_t coralCpuCount(void) {
+#ifdef PLATFORM_WINDOWS
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (uint32_t)info.dwNumberOfProcessors : 1;
+#elif defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return count > 0 ? (uint32_t)count : 1;
+#else
+    return 1;
+#endif
+}
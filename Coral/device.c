@@ -0,0 +1,1139 @@
+/*
+@file - device.c
+@developer - ColorProgrammy
+@brief - Audio output backends.
+@date - 16/10/2026
+@description - Opens the platform audio output for a PCM format and feeds
+it block by block. Used by every playback path in the library. The device
+is opened in the source sample format when it accepts it, otherwise in the
+best one it does, and each block is converted on the way. When a fixed
+speaker layout is chosen, blocks are remixed through a channel matrix. When
+the device runs at a different sample rate, either because it refused the
+source rate or because a fixed output rate was chosen, they pass through the
+resampler next, and then through the output effect chain, if one is set.
+When an offline backend is selected the device writes there instead.
+*/
+
+#include "internal.h"
+
+#ifdef PLATFORM_WINDOWS
+#include <mmreg.h>
+#define WAVEOUT_BUFFER_COUNT 4
+#define WAVEOUT_BUFFER_BYTES 65536
+#endif
+
+#define DEVICE_CONVERT_FRAMES 1024
+
+struct CoralDevice {
+    WavFormat format;
+    bool offline;               // Writes go to the offline render target
+    WavFormat offlineFormat;    // The source sample format in the output channels and rate
+    CoralSampleFormat sourceFormat;     // What callers write
+    CoralSampleFormat outputFormat;     // What the device was opened with
+    uint16_t outputBlockAlign;
+    uint8_t* convertBuffer;     // One block in outputFormat, when it differs
+    uint32_t periodFrames;      // Granted period and buffer sizes; 0 when unknown
+    uint32_t bufferFrames;
+    uint64_t lastMeasured;      // coralTimeNs of the last latency reading
+    uint32_t outputRate;        // Rate the device runs at
+    uint16_t outputChannels;    // Channels the device runs with
+    CoralChannelMatrix* matrix; // Set when outputChannels come from a fixed layout
+    float* matrixIn;            // One block of source channels for the matrix
+    CoralResampler* resampler;  // Set when outputRate differs from the source rate
+    float* resampleIn;
+    float* resampleOut;         // Float frames ready to quantize, after either stage
+    CoralEffectChain* effects;  // Copy of the output chain; runs on resampleOut
+    uint64_t generation;        // Of the output settings it was opened with
+#ifdef PLATFORM_WINDOWS
+    HWAVEOUT hWaveOut;
+    HANDLE doneEvent;
+    WAVEHDR headers[WAVEOUT_BUFFER_COUNT];
+    bool queued[WAVEOUT_BUFFER_COUNT];
+    uint8_t* buffers[WAVEOUT_BUFFER_COUNT];
+    int nextHeader;
+    int bufferCount;            // Headers in use, at most WAVEOUT_BUFFER_COUNT
+    size_t chunkBytes;          // Bytes per header
+    uint64_t bytesQueued;       // For measuring the delay against waveOutGetPosition
+#elif defined(PLATFORM_MACOS)
+    AudioComponentInstance audioUnit;
+#elif defined(PLATFORM_LINUX) && defined(TRY_PULSE_AUDIO)
+    pa_simple* s;
+#elif defined(PLATFORM_LINUX) && defined(TRY_ALSA)
+    snd_pcm_t* pcm_handle;
+#endif
+};
+
+#ifdef PLATFORM_WINDOWS
+// Waits until the header has been returned by the driver and unprepares it.
+static bool reclaimHeader(CoralDevice* device, int index) {
+    MMRESULT result;
+
+    if (!device->queued[index]) {
+        return true;
+    }
+    while ((device->headers[index].dwFlags & WHDR_DONE) == 0) {
+        WaitForSingleObject(device->doneEvent, 100);
+    }
+
+    device->queued[index] = false;
+    result = waveOutUnprepareHeader(device->hWaveOut, &device->headers[index], sizeof(WAVEHDR));
+    if (result != MMSYSERR_NOERROR) {
+        coralSetError(CORAL_ERROR_DEVICE, "Failed to unprepare header (Error %d)", result);
+        return false;
+    }
+    return true;
+}
+#endif
+
+#define LATENCY_MEASURE_INTERVAL_NS 50000000ULL
+
+// Output settings, read once per device open. Every change bumps the
+// generation, so a device opened under the old settings is not pooled.
+static struct {
+    CoralMutex mutex;
+    CoralLatencyConfig config;
+    CoralLatencyInfo info;
+    uint32_t rate;              // 0 opens devices at the source rate
+    uint32_t layout;            // 0 keeps the source channels
+    CoralResampleQuality quality;
+    CoralEffectChain* effects;  // Holds a reference while set
+    uint64_t generation;
+} output = { 0 };
+
+static CoralOnce outputOnce = CORAL_ONCE_INIT;
+
+static void outputInit(void) {
+    coralMutexInit(&output.mutex);
+    output.quality = CORAL_RESAMPLE_MEDIUM;
+}
+
+// Turns the latency configuration into a period size and count for a
+// device at the given rate. Returns false when everything is left default.
+static bool planBuffering(uint32_t rate, uint32_t* periodFrames, uint32_t* periodCount) {
+    CoralLatencyConfig config;
+    uint64_t targetFrames;
+
+    coralGetLatencyConfig(&config);
+    if (config.targetLatencyUs == 0 && config.periodFrames == 0 && config.periodCount == 0) {
+        return false;
+    }
+
+    targetFrames = (uint64_t)rate * config.targetLatencyUs / 1000000;
+    *periodCount = config.periodCount;
+    *periodFrames = config.periodFrames;
+    if (*periodCount == 0) {
+        *periodCount = *periodFrames > 0 && targetFrames / *periodFrames > 2 ?
+            (uint32_t)(targetFrames / *periodFrames) : 2;
+    }
+    if (*periodFrames == 0) {
+        *periodFrames = targetFrames > 0 ? (uint32_t)(targetFrames / *periodCount) : 1024;
+    }
+    if (*periodFrames == 0) {
+        *periodFrames = 1;
+    }
+    return true;
+}
+
+#if defined(PLATFORM_WINDOWS) || (defined(PLATFORM_LINUX) && defined(TRY_PULSE_AUDIO))
+// Formats tried in order when the device refuses the source format
+static const CoralSampleFormat fallbackFormats[] = { CORAL_SAMPLE_F32, CORAL_SAMPLE_S16 };
+#elif defined(PLATFORM_LINUX) && defined(TRY_ALSA)
+static const CoralSampleFormat fallbackFormats[] = {
+    CORAL_SAMPLE_F32, CORAL_SAMPLE_S32, CORAL_SAMPLE_S24_32, CORAL_SAMPLE_S24, CORAL_SAMPLE_S16, CORAL_SAMPLE_U8
+};
+#endif
+
+#ifdef PLATFORM_WINDOWS
+// Opens the wave mapper in the given sample format. *badFormat is set when
+// the driver rejected the format itself.
+static bool openWaveOut(CoralDevice* device, CoralSampleFormat sampleFormat, bool* badFormat) {
+    WAVEFORMATEX wfx;
+    MMRESULT result;
+
+    *badFormat = false;
+    if (sampleFormat == CORAL_SAMPLE_S24_32) {
+        // Needs WAVE_FORMAT_EXTENSIBLE; never asked for
+        *badFormat = true;
+        return false;
+    }
+
+    ZeroMemory(&wfx, sizeof(WAVEFORMATEX));
+    wfx.wFormatTag = sampleFormat == CORAL_SAMPLE_F32 ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+    wfx.nChannels = device->outputChannels;
+    wfx.nSamplesPerSec = device->outputRate;
+    wfx.wBitsPerSample = (WORD)(coralSampleSize(sampleFormat) * 8);
+    wfx.nBlockAlign = (WORD)(device->outputChannels * coralSampleSize(sampleFormat));
+    wfx.nAvgBytesPerSec = device->outputRate * wfx.nBlockAlign;
+    wfx.cbSize = 0;
+
+    result = waveOutOpen(&device->hWaveOut, WAVE_MAPPER, &wfx, (DWORD_PTR)device->doneEvent, 0, CALLBACK_EVENT);
+    if (result != MMSYSERR_NOERROR) {
+        device->hWaveOut = NULL;
+        *badFormat = result == WAVERR_BADFORMAT;
+        coralSetError(CORAL_ERROR_DEVICE, "Failed to open audio device (Error %d)", result);
+        return false;
+    }
+    device->outputFormat = sampleFormat;
+    return true;
+}
+#endif
+
+#if defined(PLATFORM_LINUX) && defined(TRY_PULSE_AUDIO)
+static bool openPulse(CoralDevice* device, CoralSampleFormat sampleFormat) {
+    static const pa_sample_format_t pulseFormats[CORAL_SAMPLE_FORMAT_COUNT] = {
+        PA_SAMPLE_U8, PA_SAMPLE_S16LE, PA_SAMPLE_S24LE, PA_SAMPLE_S24_32LE, PA_SAMPLE_S32LE, PA_SAMPLE_FLOAT32LE
+    };
+    pa_sample_spec ss;
+    pa_buffer_attr attr;
+    uint32_t periodFrames;
+    uint32_t periodCount;
+    uint32_t frameBytes;
+    bool planned;
+    int error;
+
+    ss.format = pulseFormats[sampleFormat];
+    ss.rate = device->outputRate;
+    ss.channels = (uint8_t)device->outputChannels;
+
+    // The server targets tlength of queued audio and asks for minreq at a time
+    planned = planBuffering(device->outputRate, &periodFrames, &periodCount);
+    if (planned) {
+        frameBytes = device->outputChannels * coralSampleSize(sampleFormat);
+        attr.maxlength = (uint32_t)-1;
+        attr.tlength = periodFrames * periodCount * frameBytes;
+        attr.prebuf = (uint32_t)-1;
+        attr.minreq = periodFrames * frameBytes;
+        attr.fragsize = (uint32_t)-1;
+        device->periodFrames = periodFrames;
+        device->bufferFrames = periodFrames * periodCount;
+    }
+
+    device->s = pa_simple_new(NULL, "WAV Player", PA_STREAM_PLAYBACK, NULL, "Playback", &ss, NULL,
+        planned ? &attr : NULL, &error);
+    if (!device->s) {
+        coralSetError(CORAL_ERROR_DEVICE, "PulseAudio error: %s", pa_strerror(error));
+        return false;
+    }
+    device->outputFormat = sampleFormat;
+    return true;
+}
+#endif
+
+// Opens the platform output, preferring the source sample format and
+// falling back to one the device accepts
+static bool openPlatform(CoralDevice* device) {
+    const WavFormat* format = &device->format;
+#ifdef PLATFORM_WINDOWS
+    bool badFormat;
+    uint32_t periodFrames;
+    uint32_t periodCount;
+    size_t blockAlign;
+    size_t f;
+    int i;
+#elif defined(PLATFORM_MACOS)
+    OSStatus status;
+    AudioStreamBasicDescription audioFormat;
+    AudioComponentDescription desc;
+#elif defined(PLATFORM_LINUX) && defined(TRY_PULSE_AUDIO)
+    size_t f;
+#elif defined(PLATFORM_LINUX) && defined(TRY_ALSA)
+    snd_pcm_sw_params_t *sw_params;
+    snd_pcm_uframes_t period_size;
+    snd_pcm_uframes_t buffer_size;
+    uint32_t periodFrames;
+    uint32_t periodCount;
+    bool planned;
+    static const snd_pcm_format_t alsaFormats[CORAL_SAMPLE_FORMAT_COUNT] = {
+        SND_PCM_FORMAT_U8, SND_PCM_FORMAT_S16_LE, SND_PCM_FORMAT_S24_3LE,
+        SND_PCM_FORMAT_S24_LE, SND_PCM_FORMAT_S32_LE, SND_PCM_FORMAT_FLOAT_LE
+    };
+    int err;
+    size_t f;
+    snd_pcm_hw_params_t *hw_params;
+    unsigned int sample_rate;
+#endif
+
+#ifdef PLATFORM_WINDOWS
+    (void)format;
+    device->doneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (!device->doneEvent) {
+        coralSetError(CORAL_ERROR_SYSTEM, "Failed to create event (Error %lu)", GetLastError());
+        return false;
+    }
+
+    if (!openWaveOut(device, device->sourceFormat, &badFormat)) {
+        for (f = 0; badFormat && f < sizeof(fallbackFormats) / sizeof(fallbackFormats[0]); ++f) {
+            if (fallbackFormats[f] != device->sourceFormat && openWaveOut(device, fallbackFormats[f], &badFormat)) {
+                break;
+            }
+        }
+        if (!device->hWaveOut) {
+            return false;
+        }
+    }
+
+    // A period becomes one header; the header count bounds the periods
+    blockAlign = device->outputChannels * coralSampleSize(device->outputFormat);
+    device->bufferCount = WAVEOUT_BUFFER_COUNT;
+    device->chunkBytes = WAVEOUT_BUFFER_BYTES - WAVEOUT_BUFFER_BYTES % blockAlign;
+    if (planBuffering(device->outputRate, &periodFrames, &periodCount)) {
+        device->bufferCount = periodCount < 2 ? 2 : (periodCount > WAVEOUT_BUFFER_COUNT ? WAVEOUT_BUFFER_COUNT : (int)periodCount);
+        if ((size_t)periodFrames * blockAlign < device->chunkBytes) {
+            device->chunkBytes = (size_t)periodFrames * blockAlign;
+        }
+    }
+    device->periodFrames = (uint32_t)(device->chunkBytes / blockAlign);
+    device->bufferFrames = device->periodFrames * (uint32_t)device->bufferCount;
+
+    for (i = 0; i < WAVEOUT_BUFFER_COUNT; ++i) {
+        device->buffers[i] = (uint8_t*)malloc(WAVEOUT_BUFFER_BYTES);
+        if (!device->buffers[i]) {
+            coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+            return false;
+        }
+    }
+    return true;
+
+#elif defined(PLATFORM_MACOS)
+    desc.componentType = kAudioUnitType_Output;
+    desc.componentSubType = kAudioUnitSubType_DefaultOutput;
+    desc.componentManufacturer = kAudioUnitManufacturer_Apple;
+    desc.componentFlags = 0;
+    desc.componentFlagsMask = 0;
+
+    status = AudioComponentInstanceNew(AudioComponentFindNext(NULL, &desc), &device->audioUnit);
+    if (status != noErr) {
+        device->audioUnit = NULL;
+        coralSetError(CORAL_ERROR_DEVICE, "Failed to create audio unit (Error %d)", (int)status);
+        return false;
+    }
+
+    // Core Audio converts any linear PCM layout itself
+    audioFormat.mSampleRate = device->outputRate;
+    audioFormat.mFormatID = kAudioFormatLinearPCM;
+    audioFormat.mFormatFlags = (device->sourceFormat == CORAL_SAMPLE_F32 ? kAudioFormatFlagIsFloat :
+        kAudioFormatFlagIsSignedInteger) | kAudioFormatFlagIsPacked;
+    audioFormat.mBytesPerPacket = device->outputChannels * coralSampleSize(device->sourceFormat);
+    audioFormat.mFramesPerPacket = 1;
+    audioFormat.mBytesPerFrame = audioFormat.mBytesPerPacket;
+    audioFormat.mChannelsPerFrame = device->outputChannels;
+    audioFormat.mBitsPerChannel = format->bitsPerSample;
+
+    status = AudioUnitSetProperty(device->audioUnit,
+        kAudioUnitProperty_StreamFormat,
+        kAudioUnitScope_Input,
+        0,
+        &audioFormat,
+        sizeof(audioFormat));
+    if (status != noErr) {
+        coralSetError(CORAL_ERROR_DEVICE, "Failed to set audio format (Error %d)", (int)status);
+        return false;
+    }
+    device->outputFormat = device->sourceFormat;
+    return true;
+
+#elif defined(PLATFORM_LINUX) && defined(TRY_PULSE_AUDIO)
+    // Pulse accepts every format we produce, so a fallback only helps
+    // servers built without some of them
+    (void)format;
+    if (openPulse(device, device->sourceFormat)) {
+        return true;
+    }
+    for (f = 0; f < sizeof(fallbackFormats) / sizeof(fallbackFormats[0]); ++f) {
+        if (fallbackFormats[f] != device->sourceFormat && openPulse(device, fallbackFormats[f])) {
+            return true;
+        }
+    }
+    return false;
+
+#elif defined(PLATFORM_LINUX) && defined(TRY_ALSA)
+    (void)format;
+    if ((err = snd_pcm_open(&device->pcm_handle, "default", SND_PCM_STREAM_PLAYBACK, 0)) < 0) {
+        device->pcm_handle = NULL;
+        coralSetError(CORAL_ERROR_DEVICE, "ALSA open error: %s", snd_strerror(err));
+        return false;
+    }
+
+    snd_pcm_hw_params_alloca(&hw_params);
+
+    if ((err = snd_pcm_hw_params_any(device->pcm_handle, hw_params)) < 0) {
+        coralSetError(CORAL_ERROR_DEVICE, "ALSA init error: %s", snd_strerror(err));
+        return false;
+    }
+
+    if ((err = snd_pcm_hw_params_set_access(device->pcm_handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
+        coralSetError(CORAL_ERROR_DEVICE, "ALSA access error: %s", snd_strerror(err));
+        return false;
+    }
+
+    // Ask the hardware what it takes natively rather than relying on plug
+    device->outputFormat = device->sourceFormat;
+    if (snd_pcm_hw_params_test_format(device->pcm_handle, hw_params, alsaFormats[device->sourceFormat]) < 0) {
+        for (f = 0; f < sizeof(fallbackFormats) / sizeof(fallbackFormats[0]); ++f) {
+            if (snd_pcm_hw_params_test_format(device->pcm_handle, hw_params, alsaFormats[fallbackFormats[f]]) == 0) {
+                device->outputFormat = fallbackFormats[f];
+                break;
+            }
+        }
+    }
+
+    if ((err = snd_pcm_hw_params_set_format(device->pcm_handle, hw_params, alsaFormats[device->outputFormat])) < 0) {
+        coralSetError(CORAL_ERROR_DEVICE, "ALSA format error: %s", snd_strerror(err));
+        return false;
+    }
+
+    // The hardware may settle on a nearby rate; the resampler covers the gap
+    sample_rate = device->outputRate;
+    if ((err = snd_pcm_hw_params_set_rate_near(device->pcm_handle, hw_params, &sample_rate, 0)) < 0) {
+        coralSetError(CORAL_ERROR_DEVICE, "ALSA rate error: %s", snd_strerror(err));
+        return false;
+    }
+    device->outputRate = sample_rate;
+
+    if ((err = snd_pcm_hw_params_set_channels(device->pcm_handle, hw_params, device->outputChannels)) < 0) {
+        coralSetError(CORAL_ERROR_DEVICE, "ALSA channels error: %s", snd_strerror(err));
+        return false;
+    }
+
+    planned = planBuffering(device->outputRate, &periodFrames, &periodCount);
+    if (planned) {
+        period_size = periodFrames;
+        buffer_size = (snd_pcm_uframes_t)periodFrames * periodCount;
+        if ((err = snd_pcm_hw_params_set_period_size_near(device->pcm_handle, hw_params, &period_size, 0)) < 0 ||
+            (err = snd_pcm_hw_params_set_buffer_size_near(device->pcm_handle, hw_params, &buffer_size)) < 0) {
+            coralSetError(CORAL_ERROR_DEVICE, "ALSA buffer size error: %s", snd_strerror(err));
+            return false;
+        }
+    }
+
+    if ((err = snd_pcm_hw_params(device->pcm_handle, hw_params)) < 0) {
+        coralSetError(CORAL_ERROR_DEVICE, "ALSA apply params error: %s", snd_strerror(err));
+        return false;
+    }
+
+    // Record what the driver granted, which may differ from the request
+    if (snd_pcm_hw_params_get_period_size(hw_params, &period_size, 0) == 0 &&
+        snd_pcm_hw_params_get_buffer_size(hw_params, &buffer_size) == 0) {
+        device->periodFrames = (uint32_t)period_size;
+        device->bufferFrames = (uint32_t)buffer_size;
+    }
+
+    // Start as soon as one period is queued instead of when the buffer is full
+    if (planned && device->periodFrames > 0) {
+        snd_pcm_sw_params_alloca(&sw_params);
+        if ((err = snd_pcm_sw_params_current(device->pcm_handle, sw_params)) < 0 ||
+            (err = snd_pcm_sw_params_set_start_threshold(device->pcm_handle, sw_params, device->periodFrames)) < 0 ||
+            (err = snd_pcm_sw_params_set_avail_min(device->pcm_handle, sw_params, device->periodFrames)) < 0 ||
+            (err = snd_pcm_sw_params(device->pcm_handle, sw_params)) < 0) {
+            coralSetError(CORAL_ERROR_DEVICE, "ALSA software params error: %s", snd_strerror(err));
+            return false;
+        }
+    }
+    return true;
+#else
+    (void)format;
+    coralSetError(CORAL_ERROR_UNSUPPORTED, "Unsupported platform");
+    return false;
+#endif
+}
+
+CoralDevice* coralDeviceOpen(const WavFormat* format) {
+    CoralDevice* device;
+    CoralSampleFormat sampleFormat;
+    uint32_t rate;
+    uint32_t layout;
+    CoralResampleQuality quality;
+    uint64_t generation;
+    CoralEffectChain* effects;
+    uint64_t start = coralTimeNs();
+
+    if (!coralSampleFormatOf(format, &sampleFormat) || format->numChannels == 0) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Unsupported sample format: %d-bit, format tag %d",
+            format->bitsPerSample, format->audioFormat);
+        return NULL;
+    }
+    // Formats built by hand never went through the parser's check
+    if (!coralCheckFormat(format, NULL, 0)) {
+        return NULL;
+    }
+
+    coralCallOnce(&outputOnce, outputInit);
+    coralMutexLock(&output.mutex);
+    rate = output.rate;
+    layout = output.layout;
+    quality = output.quality;
+    generation = output.generation;
+    coralMutexUnlock(&output.mutex);
+
+    device = (CoralDevice*)malloc(sizeof(CoralDevice));
+    if (!device) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+    memset(device, 0, sizeof(CoralDevice));
+    device->format = *format;
+    device->sourceFormat = sampleFormat;
+    device->outputFormat = sampleFormat;
+    device->outputRate = rate != 0 ? rate : format->sampleRate;
+    device->outputChannels = format->numChannels;
+    device->generation = generation;
+
+    if (layout != 0 && layout != coralDefaultChannelLayout(format->numChannels)) {
+        if (coralDefaultChannelLayout(format->numChannels) == 0) {
+            free(device);
+            coralSetError(CORAL_ERROR_UNSUPPORTED, "No speaker layout to remix %d channels from", format->numChannels);
+            return NULL;
+        }
+        device->matrix = coralChannelMatrixCreateLayout(coralDefaultChannelLayout(format->numChannels), layout);
+        device->matrixIn = (float*)malloc(DEVICE_CONVERT_FRAMES * format->numChannels * sizeof(float));
+        if (!device->matrix || !device->matrixIn) {
+            coralChannelMatrixDestroy(device->matrix);
+            free(device->matrixIn);
+            free(device);
+            coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+            return NULL;
+        }
+        device->outputChannels = coralChannelMatrixOutputs(device->matrix);
+    }
+
+    if (coralOfflineSelected()) {
+        device->offlineFormat = *format;
+        device->offlineFormat.numChannels = device->outputChannels;
+        device->offlineFormat.blockAlign = (uint16_t)(device->outputChannels * coralSampleSize(sampleFormat));
+        device->offlineFormat.sampleRate = device->outputRate;
+        device->offlineFormat.byteRate = device->outputRate * device->offlineFormat.blockAlign;
+        if (!coralOfflineOpen(&device->offlineFormat)) {
+            coralChannelMatrixDestroy(device->matrix);
+            free(device->matrixIn);
+            free(device);
+            return NULL;
+        }
+        device->offline = true;
+    }
+    else if (!openPlatform(device)) {
+        coralDeviceClose(device);
+        return NULL;
+    }
+
+    device->outputBlockAlign = (uint16_t)(device->outputChannels * coralSampleSize(device->outputFormat));
+    if (device->outputRate != format->sampleRate) {
+        device->resampler = coralResamplerCreate(format->sampleRate, device->outputRate, device->outputChannels, quality);
+        device->resampleIn = (float*)malloc(DEVICE_CONVERT_FRAMES * device->outputChannels * sizeof(float));
+        if (!device->resampler || !device->resampleIn) {
+            coralDeviceClose(device);
+            coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+            return NULL;
+        }
+    }
+
+    // The output's chain can be replaced meanwhile; the reference keeps it
+    // whole while it is copied, and the generation marks the device stale
+    coralMutexLock(&output.mutex);
+    effects = output.effects;
+    coralEffectChainRetain(effects);
+    coralMutexUnlock(&output.mutex);
+    if (effects) {
+        device->effects = coralEffectChainCopy(effects, device->outputRate, device->outputChannels);
+        coralEffectChainRelease(effects);
+        if (!device->effects) {
+            coralDeviceClose(device);
+            return NULL;
+        }
+    }
+    if (device->resampler || device->matrix || device->effects) {
+        device->resampleOut = (float*)malloc(DEVICE_CONVERT_FRAMES * device->outputChannels * sizeof(float));
+        if (!device->resampleOut) {
+            coralDeviceClose(device);
+            coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+            return NULL;
+        }
+    }
+    if (device->outputFormat != device->sourceFormat || device->resampler || device->matrix || device->effects) {
+        device->convertBuffer = (uint8_t*)malloc(DEVICE_CONVERT_FRAMES * device->outputBlockAlign);
+        if (!device->convertBuffer) {
+            coralDeviceClose(device);
+            coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+            return NULL;
+        }
+    }
+    coralRecord(CORAL_TIME_DEVICE_OPEN, coralTimeNs() - start);
+    return device;
+}
+
+bool coralDeviceCurrent(const CoralDevice* device) {
+    bool current;
+
+    coralCallOnce(&outputOnce, outputInit);
+    coralMutexLock(&output.mutex);
+    current = device->generation == output.generation;
+    coralMutexUnlock(&output.mutex);
+    return current;
+}
+
+void coralSetOutputSampleRate(uint32_t rate) {
+    coralCallOnce(&outputOnce, outputInit);
+    coralMutexLock(&output.mutex);
+    output.rate = rate;
+    output.generation++;
+    coralMutexUnlock(&output.mutex);
+
+    // Pooled devices still run at the old rate
+    coralFlushDevicePool();
+}
+
+uint32_t coralGetOutputSampleRate(void) {
+    uint32_t rate;
+
+    coralCallOnce(&outputOnce, outputInit);
+    coralMutexLock(&output.mutex);
+    rate = output.rate;
+    coralMutexUnlock(&output.mutex);
+    return rate;
+}
+
+void coralSetOutputChannelLayout(uint32_t layout) {
+    coralCallOnce(&outputOnce, outputInit);
+    coralMutexLock(&output.mutex);
+    output.layout = layout;
+    output.generation++;
+    coralMutexUnlock(&output.mutex);
+
+    // Pooled devices still run in the old layout
+    coralFlushDevicePool();
+}
+
+uint32_t coralGetOutputChannelLayout(void) {
+    uint32_t layout;
+
+    coralCallOnce(&outputOnce, outputInit);
+    coralMutexLock(&output.mutex);
+    layout = output.layout;
+    coralMutexUnlock(&output.mutex);
+    return layout;
+}
+
+void coralSetOutputEffectChain(CoralEffectChain* chain) {
+    CoralEffectChain* previous;
+
+    coralEffectChainRetain(chain);
+    coralCallOnce(&outputOnce, outputInit);
+    coralMutexLock(&output.mutex);
+    previous = output.effects;
+    output.effects = chain;
+    output.generation++;
+    coralMutexUnlock(&output.mutex);
+    coralEffectChainRelease(previous);
+
+    // Pooled devices still run a copy of the old chain
+    coralFlushDevicePool();
+}
+
+CoralEffectChain* coralGetOutputEffectChain(void) {
+    CoralEffectChain* chain;
+
+    coralCallOnce(&outputOnce, outputInit);
+    coralMutexLock(&output.mutex);
+    chain = output.effects;
+    coralMutexUnlock(&output.mutex);
+    return chain;
+}
+
+void coralClearOutputEffectChain(const CoralEffectChain* chain) {
+    bool cleared = false;
+
+    coralCallOnce(&outputOnce, outputInit);
+    coralMutexLock(&output.mutex);
+    if (output.effects == chain) {
+        output.effects = NULL;
+        output.generation++;
+        cleared = true;
+    }
+    coralMutexUnlock(&output.mutex);
+
+    if (cleared) {
+        coralEffectChainRelease((CoralEffectChain*)chain);
+        coralFlushDevicePool();
+    }
+}
+
+bool coralSetLatencyConfig(const CoralLatencyConfig* config) {
+    CoralLatencyConfig defaults;
+
+    if (!config) {
+        memset(&defaults, 0, sizeof(defaults));
+        config = &defaults;
+    }
+    coralCallOnce(&outputOnce, outputInit);
+    coralMutexLock(&output.mutex);
+    output.config = *config;
+    output.generation++;
+    coralMutexUnlock(&output.mutex);
+
+    // Pooled devices still have the old buffering
+    coralFlushDevicePool();
+    return true;
+}
+
+void coralGetLatencyConfig(CoralLatencyConfig* config) {
+    if (!config) {
+        return;
+    }
+    coralCallOnce(&outputOnce, outputInit);
+    coralMutexLock(&output.mutex);
+    *config = output.config;
+    coralMutexUnlock(&output.mutex);
+}
+
+void coralGetLatencyInfo(CoralLatencyInfo* info) {
+    if (!info) {
+        return;
+    }
+    coralCallOnce(&outputOnce, outputInit);
+    coralMutexLock(&output.mutex);
+    *info = output.info;
+    coralMutexUnlock(&output.mutex);
+}
+
+void coralNoteRealtime(bool granted) {
+    coralCallOnce(&outputOnce, outputInit);
+    coralMutexLock(&output.mutex);
+    output.info.realtimeGranted = granted;
+    coralMutexUnlock(&output.mutex);
+}
+
+bool coralSetResampleQuality(CoralResampleQuality quality) {
+    if ((int)quality < CORAL_RESAMPLE_FAST || quality > CORAL_RESAMPLE_HIGH) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Invalid resampler quality: %d", (int)quality);
+        return false;
+    }
+    coralCallOnce(&outputOnce, outputInit);
+    coralMutexLock(&output.mutex);
+    output.quality = quality;
+    output.generation++;
+    coralMutexUnlock(&output.mutex);
+
+    // Pooled devices still resample at the old quality
+    coralFlushDevicePool();
+    return true;
+}
+
+static bool writeNative(CoralDevice* device, const uint8_t* data, size_t size) {
+#ifdef PLATFORM_WINDOWS
+    MMRESULT result;
+    WAVEHDR* header;
+    size_t chunk;
+    int index;
+#elif defined(PLATFORM_MACOS)
+    OSStatus status;
+    AudioBufferList bufferList;
+#elif defined(PLATFORM_LINUX) && defined(TRY_PULSE_AUDIO)
+    int error;
+#elif defined(PLATFORM_LINUX) && defined(TRY_ALSA)
+    snd_pcm_uframes_t frames;
+    snd_pcm_sframes_t frames_written;
+    int err;
+#endif
+
+#ifdef PLATFORM_WINDOWS
+    // Copy into the next free driver buffer so the caller can reuse its
+    // block as soon as we return
+    while (size > 0) {
+        index = device->nextHeader;
+        if (!reclaimHeader(device, index)) {
+            return false;
+        }
+
+        chunk = size < device->chunkBytes ? size : device->chunkBytes;
+        chunk -= chunk % device->outputBlockAlign;
+        if (chunk == 0) {
+            chunk = size;
+        }
+        memcpy(device->buffers[index], data, chunk);
+
+        header = &device->headers[index];
+        ZeroMemory(header, sizeof(WAVEHDR));
+        header->lpData = (LPSTR)device->buffers[index];
+        header->dwBufferLength = (DWORD)chunk;
+
+        result = waveOutPrepareHeader(device->hWaveOut, header, sizeof(WAVEHDR));
+        if (result != MMSYSERR_NOERROR) {
+            coralSetError(CORAL_ERROR_DEVICE, "Failed to prepare header (Error %d)", result);
+            return false;
+        }
+
+        result = waveOutWrite(device->hWaveOut, header, sizeof(WAVEHDR));
+        if (result != MMSYSERR_NOERROR) {
+            waveOutUnprepareHeader(device->hWaveOut, header, sizeof(WAVEHDR));
+            coralSetError(CORAL_ERROR_DEVICE, "Failed to play audio (Error %d)", result);
+            return false;
+        }
+
+        device->queued[index] = true;
+        device->nextHeader = (index + 1) % device->bufferCount;
+        device->bytesQueued += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    return true;
+
+#elif defined(PLATFORM_MACOS)
+    bufferList.mNumberBuffers = 1;
+    bufferList.mBuffers[0].mNumberChannels = device->outputChannels;
+    bufferList.mBuffers[0].mDataByteSize = (UInt32)size;
+    bufferList.mBuffers[0].mData = (void*)data;
+
+    status = AudioUnitRender(device->audioUnit, NULL, kAudioUnitRenderAction_OutputData, 0, 0, &bufferList);
+    if (status != noErr) {
+        coralSetError(CORAL_ERROR_DEVICE, "Failed to render audio (Error %d)", (int)status);
+        return false;
+    }
+    return true;
+
+#elif defined(PLATFORM_LINUX) && defined(TRY_PULSE_AUDIO)
+    if (pa_simple_write(device->s, data, size, &error) < 0) {
+        coralSetError(CORAL_ERROR_DEVICE, "PulseAudio write error: %s", pa_strerror(error));
+        return false;
+    }
+    return true;
+
+#elif defined(PLATFORM_LINUX) && defined(TRY_ALSA)
+    frames = size / device->outputBlockAlign;
+
+    while (frames > 0) {
+        frames_written = snd_pcm_writei(device->pcm_handle, data, frames);
+        if (frames_written < 0) {
+            if (frames_written == -EPIPE) {
+                coralCount(CORAL_COUNT_XRUNS, 1);
+            }
+            if ((err = snd_pcm_recover(device->pcm_handle, (int)frames_written, 0)) < 0) {
+                coralSetError(CORAL_ERROR_DEVICE, "ALSA write error: %s", snd_strerror(err));
+                return false;
+            }
+            coralCount(CORAL_COUNT_RECOVERIES, 1);
+            continue;
+        }
+        data += frames_written * device->outputBlockAlign;
+        frames -= frames_written;
+    }
+    return true;
+#else
+    (void)device;
+    (void)data;
+    (void)size;
+    coralSetError(CORAL_ERROR_UNSUPPORTED, "Unsupported platform");
+    return false;
+#endif
+}
+
+static bool writeOutput(CoralDevice* device, const uint8_t* data, size_t size) {
+    if (device->offline) {
+        return coralOfflineWrite(&device->offlineFormat, data, size);
+    }
+    return writeNative(device, data, size);
+}
+
+// Runs processed frames through the effects, quantizes them to the output
+// format and writes them
+static bool writeFloatFrames(CoralDevice* device, size_t frames) {
+    coralEffectChainProcess(device->effects, device->resampleOut, frames);
+    coralEncodeFromFloat(device->resampleOut, device->convertBuffer, device->outputFormat,
+        frames * device->outputChannels);
+    return writeOutput(device, device->convertBuffer, frames * device->outputBlockAlign);
+}
+
+// Takes each block through the float stages: the channel matrix, the resampler
+// and, in writeFloatFrames, the effects
+static bool writeProcessed(CoralDevice* device, const uint8_t* data, size_t frames) {
+    float* remixed = device->resampler ? device->resampleIn : device->resampleOut;
+    size_t chunk;
+    size_t offset;
+    size_t consumed;
+    size_t made;
+
+    while (frames > 0) {
+        chunk = frames < DEVICE_CONVERT_FRAMES ? frames : DEVICE_CONVERT_FRAMES;
+        if (device->matrix) {
+            coralDecodeToFloat(data, device->sourceFormat, device->matrixIn, chunk * device->format.numChannels);
+            coralChannelMatrixProcess(device->matrix, device->matrixIn, remixed, chunk);
+        }
+        else {
+            coralDecodeToFloat(data, device->sourceFormat, remixed, chunk * device->format.numChannels);
+        }
+
+        if (!device->resampler) {
+            if (!writeFloatFrames(device, chunk)) {
+                return false;
+            }
+        }
+        for (offset = 0; device->resampler && offset < chunk; offset += consumed) {
+            made = coralResamplerProcess(device->resampler, device->resampleIn + offset * device->outputChannels,
+                chunk - offset, &consumed, device->resampleOut, DEVICE_CONVERT_FRAMES);
+            if (made > 0 && !writeFloatFrames(device, made)) {
+                return false;
+            }
+        }
+        data += chunk * device->format.blockAlign;
+        frames -= chunk;
+    }
+    return true;
+}
+
+// Writes the filter tail so the last input frames are heard
+static bool flushResampler(CoralDevice* device) {
+    size_t made;
+
+    while ((made = coralResamplerFlush(device->resampler, device->resampleOut, DEVICE_CONVERT_FRAMES)) > 0) {
+        if (!writeFloatFrames(device, made)) {
+            return false;
+        }
+    }
+    coralResamplerReset(device->resampler);
+    return true;
+}
+
+// Pushes silence through the effects so the audio held back for look-ahead is heard
+static bool flushEffects(CoralDevice* device) {
+    size_t remaining = coralEffectChainLatency(device->effects);
+    size_t chunk;
+
+    while (remaining > 0) {
+        chunk = remaining < DEVICE_CONVERT_FRAMES ? remaining : DEVICE_CONVERT_FRAMES;
+        memset(device->resampleOut, 0, chunk * device->outputChannels * sizeof(float));
+        if (!writeFloatFrames(device, chunk)) {
+            return false;
+        }
+        remaining -= chunk;
+    }
+    coralEffectChainReset(device->effects);
+    return true;
+}
+
+// Samples how much audio is queued ahead of the speaker, at most every
+// LATENCY_MEASURE_INTERVAL_NS since the query can cost a server round trip
+static void measureLatency(CoralDevice* device) {
+    uint64_t now = coralTimeNs();
+    uint64_t delayUs = 0;
+    bool measured = false;
+#ifdef PLATFORM_WINDOWS
+    MMTIME position;
+    uint32_t pending;
+#elif defined(PLATFORM_LINUX) && defined(TRY_PULSE_AUDIO)
+    pa_usec_t usec;
+    int error;
+#elif defined(PLATFORM_LINUX) && defined(TRY_ALSA)
+    snd_pcm_sframes_t delay;
+#endif
+
+    if (device->lastMeasured != 0 && now - device->lastMeasured < LATENCY_MEASURE_INTERVAL_NS) {
+        return;
+    }
+    device->lastMeasured = now;
+
+#ifdef PLATFORM_WINDOWS
+    position.wType = TIME_BYTES;
+    if (waveOutGetPosition(device->hWaveOut, &position, sizeof(position)) == MMSYSERR_NOERROR &&
+        position.wType == TIME_BYTES) {
+        // The byte position is 32 bits and wraps
+        pending = (uint32_t)device->bytesQueued - position.u.cb;
+        delayUs = (uint64_t)(pending / device->outputBlockAlign) * 1000000 / device->outputRate;
+        measured = true;
+    }
+#elif defined(PLATFORM_LINUX) && defined(TRY_PULSE_AUDIO)
+    usec = pa_simple_get_latency(device->s, &error);
+    if (usec != (pa_usec_t)-1) {
+        delayUs = usec;
+        measured = true;
+    }
+#elif defined(PLATFORM_LINUX) && defined(TRY_ALSA)
+    if (snd_pcm_delay(device->pcm_handle, &delay) == 0 && delay >= 0) {
+        delayUs = (uint64_t)delay * 1000000 / device->outputRate;
+        measured = true;
+    }
+#endif
+
+    if (measured) {
+        coralCallOnce(&outputOnce, outputInit);
+        coralMutexLock(&output.mutex);
+        output.info.sampleRate = device->outputRate;
+        output.info.periodFrames = device->periodFrames;
+        output.info.bufferFrames = device->bufferFrames;
+        output.info.measuredLatencyUs = delayUs;
+        coralMutexUnlock(&output.mutex);
+    }
+}
+
+static bool writeBlock(CoralDevice* device, const uint8_t* data, size_t size) {
+    size_t frames = size / device->format.blockAlign;
+    size_t chunk;
+
+    if (device->resampler || device->matrix || device->effects) {
+        return writeProcessed(device, data, frames);
+    }
+    if (device->offline) {
+        return coralOfflineWrite(&device->offlineFormat, data, size);
+    }
+    if (device->outputFormat == device->sourceFormat) {
+        return writeNative(device, data, size);
+    }
+
+    // Convert once per block into the format the device was opened with
+    while (frames > 0) {
+        chunk = frames < DEVICE_CONVERT_FRAMES ? frames : DEVICE_CONVERT_FRAMES;
+        coralConvertSamples(data, device->sourceFormat, device->convertBuffer, device->outputFormat,
+            chunk * device->format.numChannels);
+        if (!writeNative(device, device->convertBuffer, chunk * device->outputBlockAlign)) {
+            return false;
+        }
+        data += chunk * device->format.blockAlign;
+        frames -= chunk;
+    }
+    return true;
+}
+
+bool coralDeviceWrite(CoralDevice* device, const uint8_t* data, size_t size) {
+    uint64_t start = coralTimeNs();
+
+    if (!writeBlock(device, data, size)) {
+        return false;
+    }
+    coralRecord(CORAL_TIME_WRITE, coralTimeNs() - start);
+    coralCount(CORAL_COUNT_BYTES_WRITTEN, size);
+    if (!device->offline) {
+        measureLatency(device);
+    }
+    return true;
+}
+
+uint32_t coralDevicePeriodFrames(const CoralDevice* device) {
+    return device->periodFrames;
+}
+
+static bool drainDevice(CoralDevice* device) {
+#ifdef PLATFORM_WINDOWS
+    int i;
+#elif defined(PLATFORM_LINUX) && defined(TRY_PULSE_AUDIO)
+    int error;
+#endif
+
+    if (device->resampler && !flushResampler(device)) {
+        return false;
+    }
+    if (device->effects && !flushEffects(device)) {
+        return false;
+    }
+    if (device->offline) {
+        return coralOfflineDrain();
+    }
+
+#ifdef PLATFORM_WINDOWS
+    // Wait for playback to complete
+    for (i = 0; i < device->bufferCount; ++i) {
+        if (!reclaimHeader(device, (device->nextHeader + i) % device->bufferCount)) {
+            return false;
+        }
+    }
+    return true;
+
+#elif defined(PLATFORM_LINUX) && defined(TRY_PULSE_AUDIO)
+    if (pa_simple_drain(device->s, &error) < 0) {
+        coralSetError(CORAL_ERROR_DEVICE, "PulseAudio drain error: %s", pa_strerror(error));
+        return false;
+    }
+    return true;
+
+#elif defined(PLATFORM_LINUX) && defined(TRY_ALSA)
+    snd_pcm_drain(device->pcm_handle);
+    return true;
+#else
+    (void)device;
+    return true;
+#endif
+}
+
+bool coralDeviceDrain(CoralDevice* device) {
+    uint64_t start = coralTimeNs();
+
+    if (!drainDevice(device)) {
+        return false;
+    }
+    coralRecord(CORAL_TIME_DRAIN, coralTimeNs() - start);
+    return true;
+}
+
+bool coralDeviceReset(CoralDevice* device) {
+#if defined(PLATFORM_LINUX) && !defined(TRY_PULSE_AUDIO) && defined(TRY_ALSA)
+    int err;
+#endif
+
+    coralResamplerReset(device->resampler);
+    coralEffectChainReset(device->effects);
+#if defined(PLATFORM_LINUX) && !defined(TRY_PULSE_AUDIO) && defined(TRY_ALSA)
+    if (device->offline) {
+        return true;
+    }
+
+    // snd_pcm_drain leaves the PCM in the SETUP state
+    if ((err = snd_pcm_prepare(device->pcm_handle)) < 0) {
+        coralSetError(CORAL_ERROR_DEVICE, "ALSA prepare error: %s", snd_strerror(err));
+        return false;
+    }
+    return true;
+#else
+    return true;
+#endif
+}
+
+void coralDeviceClose(CoralDevice* device) {
+#ifdef PLATFORM_WINDOWS
+    int i;
+#endif
+
+    if (!device) {
+        return;
+    }
+    coralResamplerDestroy(device->resampler);
+    free(device->resampleIn);
+    free(device->resampleOut);
+    coralEffectChainRelease(device->effects);
+    coralChannelMatrixDestroy(device->matrix);
+    free(device->matrixIn);
+    if (device->offline) {
+        coralOfflineDrain();
+        free(device->convertBuffer);
+        free(device);
+        return;
+    }
+
+#ifdef PLATFORM_WINDOWS
+    if (device->hWaveOut) {
+        waveOutReset(device->hWaveOut);
+        for (i = 0; i < WAVEOUT_BUFFER_COUNT; ++i) {
+            if (device->queued[i]) {
+                waveOutUnprepareHeader(device->hWaveOut, &device->headers[i], sizeof(WAVEHDR));
+            }
+        }
+        waveOutClose(device->hWaveOut);
+    }
+    for (i = 0; i < WAVEOUT_BUFFER_COUNT; ++i) {
+        free(device->buffers[i]);
+    }
+    if (device->doneEvent) {
+        CloseHandle(device->doneEvent);
+    }
+#elif defined(PLATFORM_MACOS)
+    if (device->audioUnit) {
+        AudioComponentInstanceDispose(device->audioUnit);
+    }
+#elif defined(PLATFORM_LINUX) && defined(TRY_PULSE_AUDIO)
+    if (device->s) {
+        pa_simple_free(device->s);
+    }
+#elif defined(PLATFORM_LINUX) && defined(TRY_ALSA)
+    if (device->pcm_handle) {
+        snd_pcm_close(device->pcm_handle);
+    }
+#endif
+
+    free(device->convertBuffer);
+    free(device);
+}
@@ -0,0 +1,928 @@
+/*
+@file - effects.c
+@developer - ColorProgrammy
+@brief - Effect chains.
+@date - 16/10/2026
+@description - Runs interleaved float audio through a list of nodes (biquad
+EQ cascades, a compressor and a look-ahead limiter) one block at a time, so
+a block stays in cache while every node works on it. Each node keeps count
+of the blocks and time it took. The biquad kernels put channels side by side
+in a SIMD register and fill the lanes left over with the next stages of the
+cascade, one frame behind each other. The output devices run a copy of the
+chain set by coralSetOutputEffectChain.
+*/
+
+#include "internal.h"
+#include <math.h>
+
+#define EFFECT_PADDING 16           // Floats a lane kernel may read past a block
+#define EFFECT_MAX_LOOKAHEAD_MS 1000.0f
+#define EFFECT_LANES 8              // The widest SIMD register
+#define EFFECT_IDLE_LANE 1.0e9f     // Cascade position of an unused lane; never active
+#define EFFECT_DENORMAL 1.0e-15f    // Filter state below this is flushed to zero
+#define EFFECT_DB_TO_LOG 0.11512925f    // ln(10) / 20
+
+typedef enum {
+    EFFECT_EQ,
+    EFFECT_COMPRESSOR,
+    EFFECT_LIMITER
+} EffectType;
+
+// Shared between a chain and the copies the devices run
+typedef struct {
+    volatile size_t bypass;
+    volatile uint64_t blocks;
+    volatile uint64_t frames;
+    volatile uint64_t totalNs;
+    volatile uint64_t maxBlockNs;
+} EffectShared;
+
+typedef struct {
+    EffectType type;
+    EffectShared own;
+    EffectShared* shared;       // &own, or the node this one was copied from
+    uint32_t latency;           // Frames of look-ahead delay
+
+    // EQ: stages x (b0 b1 b2 a1 a2), normalized by a0, and two state
+    // values per stage and channel
+    CoralBiquadBand* bands;
+    uint32_t stages;
+    float* coefficients;
+    float* z1;
+    float* z2;
+
+    // Compressor: gain reduction in dB, smoothed
+    CoralCompressorConfig compressor;
+    float kneeStart;            // Linear level below which nothing is reduced
+    float attack;               // Per-frame smoothing coefficients
+    float release;
+    float makeup;               // Linear
+    float reduction;
+
+    // Limiter: delay line of latency frames, the minimum of the gain needed
+    // over the last latency + 1 frames, and a running average of that
+    // minimum over as many frames, which reaches the needed gain by the time
+    // the peak leaves the delay line
+    CoralLimiterConfig limiter;
+    float ceiling;
+    float* delay;
+    float* holdGain;            // Monotonic queue of (gain, frame), increasing gains
+    uint64_t* holdFrame;
+    uint32_t holdHead;
+    uint32_t holdCount;
+    float* history;             // Held gains inside the average
+    double historySum;
+    uint64_t position;          // Frames seen
+    float gain;                 // Applied gain after release smoothing
+} EffectNode;
+
+struct CoralEffectChain {
+    uint32_t sampleRate;
+    uint16_t channels;
+    EffectNode** nodes;
+    uint32_t count;
+    uint32_t capacity;
+    float* block;               // One block and EFFECT_PADDING floats
+    volatile size_t references; // The owner's, the output's while set, and one per live copy
+    CoralEffectChain* source;   // Chain this one was copied from, or NULL
+};
+
+// Lanes of one SIMD pass over the cascade. Lane l carries channel
+// first + l % width through stage firstStage + l / width; a lane for stage
+// s works on frame j - s at step j.
+typedef struct {
+    float b0[EFFECT_LANES];
+    float b1[EFFECT_LANES];
+    float b2[EFFECT_LANES];
+    float a1[EFFECT_LANES];
+    float a2[EFFECT_LANES];
+    float z1[EFFECT_LANES];
+    float z2[EFFECT_LANES];
+    float stage[EFFECT_LANES];
+    uint32_t low[EFFECT_LANES];     // All ones in the lanes of the first stage
+    uint16_t first;                 // First channel
+    uint16_t width;                 // Channels in the pass
+    uint32_t firstStage;
+    uint32_t stages;                // In flight, one frame apart
+} BiquadLanes;
+
+typedef void (*LaneKernel)(BiquadLanes* lanes, float* x, size_t frames, uint16_t channels);
+
+static float fromDb(float db) {
+    return expf(db * EFFECT_DB_TO_LOG);
+}
+
+// Robert Bristow-Johnson's cookbook filters
+static void designBiquad(const CoralBiquadBand* band, uint32_t sampleRate, float* out) {
+    double frequency = band->frequency < 0.499 * sampleRate ? band->frequency : 0.499 * sampleRate;
+    double w0 = 2.0 * 3.14159265358979323846 * frequency / sampleRate;
+    double cosw = cos(w0);
+    double alpha = sin(w0) / (2.0 * band->q);
+    double a = pow(10.0, band->gainDb / 40.0);
+    double shelf = 2.0 * sqrt(a) * alpha;
+    double b[3];
+    double d[3];
+
+    switch (band->type) {
+    case CORAL_BIQUAD_LOWPASS:
+        b[0] = (1.0 - cosw) / 2.0; b[1] = 1.0 - cosw; b[2] = b[0];
+        d[0] = 1.0 + alpha; d[1] = -2.0 * cosw; d[2] = 1.0 - alpha;
+        break;
+    case CORAL_BIQUAD_HIGHPASS:
+        b[0] = (1.0 + cosw) / 2.0; b[1] = -(1.0 + cosw); b[2] = b[0];
+        d[0] = 1.0 + alpha; d[1] = -2.0 * cosw; d[2] = 1.0 - alpha;
+        break;
+    case CORAL_BIQUAD_BANDPASS:
+        b[0] = alpha; b[1] = 0.0; b[2] = -alpha;
+        d[0] = 1.0 + alpha; d[1] = -2.0 * cosw; d[2] = 1.0 - alpha;
+        break;
+    case CORAL_BIQUAD_NOTCH:
+        b[0] = 1.0; b[1] = -2.0 * cosw; b[2] = 1.0;
+        d[0] = 1.0 + alpha; d[1] = -2.0 * cosw; d[2] = 1.0 - alpha;
+        break;
+    case CORAL_BIQUAD_PEAK:
+        b[0] = 1.0 + alpha * a; b[1] = -2.0 * cosw; b[2] = 1.0 - alpha * a;
+        d[0] = 1.0 + alpha / a; d[1] = -2.0 * cosw; d[2] = 1.0 - alpha / a;
+        break;
+    case CORAL_BIQUAD_LOW_SHELF:
+        b[0] = a * ((a + 1.0) - (a - 1.0) * cosw + shelf);
+        b[1] = 2.0 * a * ((a - 1.0) - (a + 1.0) * cosw);
+        b[2] = a * ((a + 1.0) - (a - 1.0) * cosw - shelf);
+        d[0] = (a + 1.0) + (a - 1.0) * cosw + shelf;
+        d[1] = -2.0 * ((a - 1.0) + (a + 1.0) * cosw);
+        d[2] = (a + 1.0) + (a - 1.0) * cosw - shelf;
+        break;
+    default:
+        b[0] = a * ((a + 1.0) + (a - 1.0) * cosw + shelf);
+        b[1] = -2.0 * a * ((a - 1.0) + (a + 1.0) * cosw);
+        b[2] = a * ((a + 1.0) + (a - 1.0) * cosw - shelf);
+        d[0] = (a + 1.0) - (a - 1.0) * cosw + shelf;
+        d[1] = 2.0 * ((a - 1.0) - (a + 1.0) * cosw);
+        d[2] = (a + 1.0) - (a - 1.0) * cosw - shelf;
+        break;
+    }
+
+    out[0] = (float)(b[0] / d[0]);
+    out[1] = (float)(b[1] / d[0]);
+    out[2] = (float)(b[2] / d[0]);
+    out[3] = (float)(d[1] / d[0]);
+    out[4] = (float)(d[2] / d[0]);
+}
+
+static float flushDenormal(float value) {
+    return fabsf(value) < EFFECT_DENORMAL ? 0.0f : value;
+}
+
+// Transposed direct form II, one stage and channel at a time
+static void processEqScalar(EffectNode* node, float* x, size_t frames, uint16_t channels) {
+    const float* c;
+    float* p;
+    float in;
+    float y;
+    float z1;
+    float z2;
+    size_t f;
+    uint32_t k;
+    uint16_t ch;
+
+    for (k = 0; k < node->stages; ++k) {
+        c = node->coefficients + k * 5;
+        for (ch = 0; ch < channels; ++ch) {
+            z1 = node->z1[k * channels + ch];
+            z2 = node->z2[k * channels + ch];
+            for (f = 0, p = x + ch; f < frames; ++f, p += channels) {
+                in = *p;
+                y = c[0] * in + z1;
+                z1 = c[1] * in - c[3] * y + z2;
+                z2 = c[2] * in - c[4] * y;
+                *p = y;
+            }
+            node->z1[k * channels + ch] = flushDenormal(z1);
+            node->z2[k * channels + ch] = flushDenormal(z2);
+        }
+    }
+}
+
+static void loadLanes(const EffectNode* node, BiquadLanes* lanes, uint16_t channels, uint16_t first,
+    uint16_t width, uint32_t firstStage, uint32_t stages) {
+    const float* c;
+    uint32_t l;
+    uint32_t k;
+    uint16_t ch;
+
+    lanes->first = first;
+    lanes->width = width;
+    lanes->firstStage = firstStage;
+    lanes->stages = stages;
+    for (l = 0; l < EFFECT_LANES; ++l) {
+        k = firstStage + l / width;
+        ch = (uint16_t)(first + l % width);
+        lanes->low[l] = l < width ? 0xFFFFFFFFu : 0;
+        if (l >= stages * width || k >= node->stages) {
+            // Passes the input through untouched
+            lanes->b0[l] = 1.0f;
+            lanes->b1[l] = lanes->b2[l] = lanes->a1[l] = lanes->a2[l] = 0.0f;
+            lanes->z1[l] = lanes->z2[l] = 0.0f;
+            lanes->stage[l] = l < stages * width ? (float)(l / width) : EFFECT_IDLE_LANE;
+            continue;
+        }
+        c = node->coefficients + k * 5;
+        lanes->b0[l] = c[0];
+        lanes->b1[l] = c[1];
+        lanes->b2[l] = c[2];
+        lanes->a1[l] = c[3];
+        lanes->a2[l] = c[4];
+        lanes->z1[l] = node->z1[k * channels + ch];
+        lanes->z2[l] = node->z2[k * channels + ch];
+        lanes->stage[l] = (float)(l / width);
+    }
+}
+
+static void saveLanes(EffectNode* node, const BiquadLanes* lanes, uint16_t channels) {
+    uint32_t l;
+    uint32_t k;
+    uint16_t ch;
+
+    for (l = 0; l < lanes->stages * lanes->width; ++l) {
+        k = lanes->firstStage + l / lanes->width;
+        ch = (uint16_t)(lanes->first + l % lanes->width);
+        if (k < node->stages) {
+            node->z1[k * channels + ch] = flushDenormal(lanes->z1[l]);
+            node->z2[k * channels + ch] = flushDenormal(lanes->z2[l]);
+        }
+    }
+}
+
+// Copies the last stage's lanes of step j back over frame j - lag
+static void storeLanes(const BiquadLanes* lanes, const float* y, float* x, size_t frame, uint16_t channels) {
+    const float* src = y + (lanes->stages - 1) * lanes->width;
+    float* dst = x + frame * channels + lanes->first;
+    uint16_t c;
+
+    for (c = 0; c < lanes->width; ++c) {
+        dst[c] = src[c];
+    }
+}
+
+#ifdef CORAL_ARCH_X86
+static CORAL_TARGET_SSE2 void runLanesSse2(BiquadLanes* lanes, float* x, size_t frames, uint16_t channels) {
+    size_t lag = lanes->stages - 1;
+    size_t steps = frames + lag;
+    size_t j;
+    float out[4];
+    __m128 b0 = _mm_loadu_ps(lanes->b0);
+    __m128 b1 = _mm_loadu_ps(lanes->b1);
+    __m128 b2 = _mm_loadu_ps(lanes->b2);
+    __m128 a1 = _mm_loadu_ps(lanes->a1);
+    __m128 a2 = _mm_loadu_ps(lanes->a2);
+    __m128 z1 = _mm_loadu_ps(lanes->z1);
+    __m128 z2 = _mm_loadu_ps(lanes->z2);
+    __m128 stage = _mm_loadu_ps(lanes->stage);
+    __m128 low = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)lanes->low));
+    __m128 end = _mm_set1_ps((float)frames);
+    __m128 zero = _mm_setzero_ps();
+    __m128 y = zero;
+    __m128 in;
+    __m128 n1;
+    __m128 n2;
+    __m128 t;
+    __m128 active;
+
+    for (j = 0; j < steps; ++j) {
+        in = _mm_loadu_ps(x + j * channels + lanes->first);
+        if (lag > 0) {
+            // The earlier stages' last outputs move up one stage
+            t = lanes->width == 1 ? _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(y), 4)) :
+                _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(y), 8));
+            in = _mm_or_ps(_mm_and_ps(low, in), _mm_andnot_ps(low, t));
+        }
+        y = _mm_add_ps(_mm_mul_ps(b0, in), z1);
+        n1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, in), _mm_mul_ps(a1, y)), z2);
+        n2 = _mm_sub_ps(_mm_mul_ps(b2, in), _mm_mul_ps(a2, y));
+        if (j >= lag && j < frames) {
+            z1 = n1;
+            z2 = n2;
+        }
+        else {
+            // Filling or draining: lanes without a frame keep their state
+            t = _mm_sub_ps(_mm_set1_ps((float)j), stage);
+            active = _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmplt_ps(t, end));
+            z1 = _mm_or_ps(_mm_and_ps(active, n1), _mm_andnot_ps(active, z1));
+            z2 = _mm_or_ps(_mm_and_ps(active, n2), _mm_andnot_ps(active, z2));
+        }
+        if (j >= lag) {
+            _mm_storeu_ps(out, y);
+            storeLanes(lanes, out, x, j - lag, channels);
+        }
+    }
+    _mm_storeu_ps(lanes->z1, z1);
+    _mm_storeu_ps(lanes->z2, z2);
+}
+
+#ifdef CORAL_HAVE_AVX2
+static CORAL_TARGET_AVX2 void runLanesAvx2(BiquadLanes* lanes, float* x, size_t frames, uint16_t channels) {
+    size_t lag = lanes->stages - 1;
+    size_t steps = frames + lag;
+    size_t j;
+    float out[8];
+    __m256 b0 = _mm256_loadu_ps(lanes->b0);
+    __m256 b1 = _mm256_loadu_ps(lanes->b1);
+    __m256 b2 = _mm256_loadu_ps(lanes->b2);
+    __m256 a1 = _mm256_loadu_ps(lanes->a1);
+    __m256 a2 = _mm256_loadu_ps(lanes->a2);
+    __m256 z1 = _mm256_loadu_ps(lanes->z1);
+    __m256 z2 = _mm256_loadu_ps(lanes->z2);
+    __m256 stage = _mm256_loadu_ps(lanes->stage);
+    __m256 low = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)lanes->low));
+    __m256i up = _mm256_and_si256(_mm256_sub_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+        _mm256_set1_epi32(lanes->width)), _mm256_set1_epi32(7));
+    __m256 end = _mm256_set1_ps((float)frames);
+    __m256 zero = _mm256_setzero_ps();
+    __m256 y = zero;
+    __m256 in;
+    __m256 n1;
+    __m256 n2;
+    __m256 t;
+    __m256 active;
+
+    for (j = 0; j < steps; ++j) {
+        in = _mm256_loadu_ps(x + j * channels + lanes->first);
+        if (lag > 0) {
+            in = _mm256_blendv_ps(_mm256_permutevar8x32_ps(y, up), in, low);
+        }
+        y = _mm256_add_ps(_mm256_mul_ps(b0, in), z1);
+        n1 = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(b1, in), _mm256_mul_ps(a1, y)), z2);
+        n2 = _mm256_sub_ps(_mm256_mul_ps(b2, in), _mm256_mul_ps(a2, y));
+        if (j >= lag && j < frames) {
+            z1 = n1;
+            z2 = n2;
+        }
+        else {
+            t = _mm256_sub_ps(_mm256_set1_ps((float)j), stage);
+            active = _mm256_and_ps(_mm256_cmp_ps(t, zero, _CMP_GE_OQ), _mm256_cmp_ps(t, end, _CMP_LT_OQ));
+            z1 = _mm256_blendv_ps(z1, n1, active);
+            z2 = _mm256_blendv_ps(z2, n2, active);
+        }
+        if (j >= lag) {
+            _mm256_storeu_ps(out, y);
+            storeLanes(lanes, out, x, j - lag, channels);
+        }
+    }
+    _mm256_storeu_ps(lanes->z1, z1);
+    _mm256_storeu_ps(lanes->z2, z2);
+}
+#endif
+#endif
+
+#ifdef CORAL_ARCH_NEON
+static void runLanesNeon(BiquadLanes* lanes, float* x, size_t frames, uint16_t channels) {
+    size_t lag = lanes->stages - 1;
+    size_t steps = frames + lag;
+    size_t j;
+    float out[4];
+    float32x4_t b0 = vld1q_f32(lanes->b0);
+    float32x4_t b1 = vld1q_f32(lanes->b1);
+    float32x4_t b2 = vld1q_f32(lanes->b2);
+    float32x4_t a1 = vld1q_f32(lanes->a1);
+    float32x4_t a2 = vld1q_f32(lanes->a2);
+    float32x4_t z1 = vld1q_f32(lanes->z1);
+    float32x4_t z2 = vld1q_f32(lanes->z2);
+    float32x4_t stage = vld1q_f32(lanes->stage);
+    uint32x4_t low = vld1q_u32(lanes->low);
+    float32x4_t end = vdupq_n_f32((float)frames);
+    float32x4_t zero = vdupq_n_f32(0.0f);
+    float32x4_t y = zero;
+    float32x4_t in;
+    float32x4_t n1;
+    float32x4_t n2;
+    float32x4_t t;
+    uint32x4_t active;
+
+    for (j = 0; j < steps; ++j) {
+        in = vld1q_f32(x + j * channels + lanes->first);
+        if (lag > 0) {
+            t = lanes->width == 1 ? vextq_f32(zero, y, 3) : vextq_f32(zero, y, 2);
+            in = vbslq_f32(low, in, t);
+        }
+        y = vaddq_f32(vmulq_f32(b0, in), z1);
+        n1 = vaddq_f32(vsubq_f32(vmulq_f32(b1, in), vmulq_f32(a1, y)), z2);
+        n2 = vsubq_f32(vmulq_f32(b2, in), vmulq_f32(a2, y));
+        if (j >= lag && j < frames) {
+            z1 = n1;
+            z2 = n2;
+        }
+        else {
+            t = vsubq_f32(vdupq_n_f32((float)j), stage);
+            active = vandq_u32(vcgeq_f32(t, zero), vcltq_f32(t, end));
+            z1 = vbslq_f32(active, n1, z1);
+            z2 = vbslq_f32(active, n2, z2);
+        }
+        if (j >= lag) {
+            vst1q_f32(out, y);
+            storeLanes(lanes, out, x, j - lag, channels);
+        }
+    }
+    vst1q_f32(lanes->z1, z1);
+    vst1q_f32(lanes->z2, z2);
+}
+#endif
+
+// Channels are taken a register at a time. When they leave lanes over,
+// as many further stages ride along, so mono runs four or eight stages per
+// pass and stereo two or four. The separate multiplies and adds keep every
+// path bit-identical to the scalar one.
+static void processEqLanes(EffectNode* node, float* x, size_t frames, uint16_t channels, uint16_t laneCount, LaneKernel kernel) {
+    BiquadLanes lanes;
+    uint32_t stages = channels <= laneCount ? laneCount / channels : 1;
+    uint32_t k;
+    uint16_t first;
+    uint16_t width;
+
+    for (first = 0; first < channels; first = (uint16_t)(first + width)) {
+        width = channels - first < laneCount ? (uint16_t)(channels - first) : laneCount;
+        for (k = 0; k < node->stages; k += stages) {
+            loadLanes(node, &lanes, channels, first, width, k, stages);
+            kernel(&lanes, x, frames, channels);
+            saveLanes(node, &lanes, channels);
+        }
+    }
+}
+
+static void processEq(EffectNode* node, float* x, size_t frames, uint16_t channels) {
+    switch (coralGetSimdLevel()) {
+#ifdef CORAL_ARCH_X86
+#ifdef CORAL_HAVE_AVX2
+    case CORAL_SIMD_AVX2: processEqLanes(node, x, frames, channels, 8, runLanesAvx2); return;
+#endif
+    case CORAL_SIMD_SSE2: processEqLanes(node, x, frames, channels, 4, runLanesSse2); return;
+#endif
+#ifdef CORAL_ARCH_NEON
+    case CORAL_SIMD_NEON: processEqLanes(node, x, frames, channels, 4, runLanesNeon); return;
+#endif
+    default: processEqScalar(node, x, frames, channels); return;
+    }
+}
+
+// Feed-forward with the channels linked: the loudest sample of a frame sets
+// the level. Below the knee the logarithms are skipped.
+static void processCompressor(EffectNode* node, float* x, size_t frames, uint16_t channels) {
+    const CoralCompressorConfig* config = &node->compressor;
+    float slope = 1.0f - 1.0f / config->ratio;
+    float peak;
+    float over;
+    float target;
+    float gain;
+    size_t f;
+    uint16_t c;
+
+    for (f = 0; f < frames; ++f, x += channels) {
+        peak = 0.0f;
+        for (c = 0; c < channels; ++c) {
+            peak = fabsf(x[c]) > peak ? fabsf(x[c]) : peak;
+        }
+
+        target = 0.0f;
+        if (peak > node->kneeStart) {
+            over = logf(peak) / EFFECT_DB_TO_LOG - config->thresholdDb;
+            if (2.0f * over >= config->kneeDb) {
+                target = slope * over;
+            }
+            else {
+                over += config->kneeDb / 2.0f;
+                target = slope * over * over / (2.0f * config->kneeDb);
+            }
+        }
+
+        node->reduction = target + (target > node->reduction ? node->attack : node->release) * (node->reduction - target);
+        if (node->reduction < 1.0e-6f) {
+            node->reduction = 0.0f;
+            gain = node->makeup;
+        }
+        else {
+            gain = node->makeup * fromDb(-node->reduction);
+        }
+        for (c = 0; c < channels; ++c) {
+            x[c] *= gain;
+        }
+    }
+}
+
+static void processLimiter(EffectNode* node, float* x, size_t frames, uint16_t channels) {
+    uint32_t window = node->latency + 1;
+    uint32_t slot;
+    uint32_t tail;
+    float* delayed;
+    float peak;
+    float needed;
+    float held;
+    float average;
+    float sample;
+    size_t f;
+    uint16_t c;
+    bool bypass = coralAtomicLoad(&node->shared->bypass) != 0;
+
+    for (f = 0; f < frames; ++f, x += channels) {
+        peak = 0.0f;
+        for (c = 0; c < channels; ++c) {
+            peak = fabsf(x[c]) > peak ? fabsf(x[c]) : peak;
+        }
+        needed = peak > node->ceiling ? node->ceiling / peak : 1.0f;
+
+        // Sliding minimum over the window
+        if (node->holdCount > 0 && node->holdFrame[node->holdHead] + window <= node->position) {
+            node->holdHead = (node->holdHead + 1) % window;
+            node->holdCount--;
+        }
+        while (node->holdCount > 0 && node->holdGain[(node->holdHead + node->holdCount - 1) % window] >= needed) {
+            node->holdCount--;
+        }
+        tail = (node->holdHead + node->holdCount) % window;
+        node->holdGain[tail] = needed;
+        node->holdFrame[tail] = node->position;
+        node->holdCount++;
+        held = node->holdGain[node->holdHead];
+
+        slot = (uint32_t)(node->position % window);
+        node->historySum += held - node->history[slot];
+        node->history[slot] = held;
+        average = (float)(node->historySum / window);
+        average = average < held ? held : average;
+
+        // Falls with the average at once, recovers at the release rate
+        if (average < node->gain) {
+            node->gain = average;
+        }
+        else {
+            node->gain = average + node->release * (node->gain - average);
+        }
+
+        if (node->latency > 0) {
+            delayed = node->delay + (node->position % node->latency) * channels;
+            for (c = 0; c < channels; ++c) {
+                sample = delayed[c];
+                delayed[c] = x[c];
+                x[c] = bypass ? sample : sample * node->gain;
+            }
+        }
+        else if (!bypass) {
+            for (c = 0; c < channels; ++c) {
+                x[c] *= node->gain;
+            }
+        }
+        node->position++;
+    }
+}
+
+static void resetNode(EffectNode* node, uint16_t channels) {
+    uint32_t window = node->latency + 1;
+    uint32_t i;
+
+    switch (node->type) {
+    case EFFECT_EQ:
+        memset(node->z1, 0, (size_t)node->stages * channels * sizeof(float));
+        memset(node->z2, 0, (size_t)node->stages * channels * sizeof(float));
+        break;
+    case EFFECT_COMPRESSOR:
+        node->reduction = 0.0f;
+        break;
+    case EFFECT_LIMITER:
+        memset(node->delay, 0, (size_t)node->latency * channels * sizeof(float));
+        for (i = 0; i < window; ++i) {
+            node->history[i] = 1.0f;
+        }
+        node->historySum = window;
+        node->holdHead = 0;
+        node->holdCount = 0;
+        node->position = 0;
+        node->gain = 1.0f;
+        break;
+    }
+}
+
+static void freeNode(EffectNode* node) {
+    if (!node) {
+        return;
+    }
+    free(node->bands);
+    free(node->coefficients);
+    free(node->z1);
+    free(node->z2);
+    free(node->delay);
+    free(node->holdGain);
+    free(node->holdFrame);
+    free(node->history);
+    free(node);
+}
+
+// Builds the node's state for the chain's rate and channels. shared is the
+// node of the chain being copied, or NULL for a new node.
+static bool addNode(CoralEffectChain* chain, const EffectNode* config, EffectShared* shared) {
+    EffectNode* node;
+    EffectNode** nodes;
+    uint32_t window;
+    uint32_t k;
+    bool allocated = true;
+
+    // Copies and the output read the node array without a lock
+    if (coralAtomicLoad(&chain->references) > 1) {
+        coralSetError(CORAL_ERROR_BUSY, "Effect chain is in use by the output; add nodes before setting it");
+        return false;
+    }
+    if (chain->count == chain->capacity) {
+        nodes = (EffectNode**)realloc(chain->nodes, (chain->capacity * 2 + 4) * sizeof(EffectNode*));
+        if (!nodes) {
+            coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+            return false;
+        }
+        chain->nodes = nodes;
+        chain->capacity = chain->capacity * 2 + 4;
+    }
+
+    node = (EffectNode*)calloc(1, sizeof(EffectNode));
+    if (!node) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return false;
+    }
+    node->type = config->type;
+    node->shared = shared ? shared : &node->own;
+    node->compressor = config->compressor;
+    node->limiter = config->limiter;
+
+    switch (node->type) {
+    case EFFECT_EQ:
+        node->stages = config->stages;
+        node->bands = (CoralBiquadBand*)malloc(node->stages * sizeof(CoralBiquadBand));
+        node->coefficients = (float*)malloc(node->stages * 5 * sizeof(float));
+        node->z1 = (float*)malloc((size_t)node->stages * chain->channels * sizeof(float));
+        node->z2 = (float*)malloc((size_t)node->stages * chain->channels * sizeof(float));
+        allocated = node->bands && node->coefficients && node->z1 && node->z2;
+        for (k = 0; allocated && k < node->stages; ++k) {
+            node->bands[k] = config->bands[k];
+            designBiquad(&node->bands[k], chain->sampleRate, node->coefficients + k * 5);
+        }
+        break;
+    case EFFECT_COMPRESSOR:
+        node->kneeStart = fromDb(node->compressor.thresholdDb - node->compressor.kneeDb / 2.0f);
+        node->attack = node->compressor.attackMs > 0.0f ?
+            (float)exp(-1000.0 / (node->compressor.attackMs * chain->sampleRate)) : 0.0f;
+        node->release = node->compressor.releaseMs > 0.0f ?
+            (float)exp(-1000.0 / (node->compressor.releaseMs * chain->sampleRate)) : 0.0f;
+        node->makeup = fromDb(node->compressor.makeupDb);
+        break;
+    case EFFECT_LIMITER:
+        node->ceiling = fromDb(node->limiter.ceilingDb);
+        node->release = node->limiter.releaseMs > 0.0f ?
+            (float)exp(-1000.0 / (node->limiter.releaseMs * chain->sampleRate)) : 0.0f;
+        node->latency = (uint32_t)(node->limiter.lookaheadMs * chain->sampleRate / 1000.0f + 0.5f);
+        window = node->latency + 1;
+        node->delay = (float*)malloc(((size_t)node->latency * chain->channels + 1) * sizeof(float));
+        node->holdGain = (float*)malloc(window * sizeof(float));
+        node->holdFrame = (uint64_t*)malloc(window * sizeof(uint64_t));
+        node->history = (float*)malloc(window * sizeof(float));
+        allocated = node->delay && node->holdGain && node->holdFrame && node->history;
+        break;
+    }
+
+    if (!allocated) {
+        freeNode(node);
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return false;
+    }
+    resetNode(node, chain->channels);
+    chain->nodes[chain->count++] = node;
+    return true;
+}
+
+CoralEffectChain* coralEffectChainCreate(uint32_t sampleRate, uint16_t channels) {
+    CoralEffectChain* chain;
+
+    if (sampleRate == 0 || channels == 0) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Invalid effect chain format: %u Hz, %d channels",
+            (unsigned)sampleRate, channels);
+        return NULL;
+    }
+
+    chain = (CoralEffectChain*)calloc(1, sizeof(CoralEffectChain));
+    if (!chain) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+    chain->sampleRate = sampleRate;
+    chain->channels = channels;
+    chain->references = 1;
+    chain->block = (float*)calloc((size_t)CORAL_EFFECT_BLOCK_FRAMES * channels + EFFECT_PADDING, sizeof(float));
+    if (!chain->block) {
+        free(chain);
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+    return chain;
+}
+
+void coralEffectChainDestroy(CoralEffectChain* chain) {
+    if (!chain) {
+        return;
+    }
+    // Devices opened from now on must not copy it; those still playing run
+    // copies that point at its nodes and keep it alive
+    coralClearOutputEffectChain(chain);
+    coralEffectChainRelease(chain);
+}
+
+void coralEffectChainRetain(CoralEffectChain* chain) {
+    if (chain) {
+        coralAtomicAdd(&chain->references, 1);
+    }
+}
+
+void coralEffectChainRelease(CoralEffectChain* chain) {
+    CoralEffectChain* source;
+    uint32_t i;
+
+    if (!chain || coralAtomicAdd(&chain->references, (size_t)-1) != 0) {
+        return;
+    }
+
+    source = chain->source;
+    for (i = 0; i < chain->count; ++i) {
+        freeNode(chain->nodes[i]);
+    }
+    free(chain->nodes);
+    free(chain->block);
+    free(chain);
+    coralEffectChainRelease(source);
+}
+
+CoralEffectChain* coralEffectChainCopy(CoralEffectChain* chain, uint32_t sampleRate, uint16_t channels) {
+    CoralEffectChain* copy = coralEffectChainCreate(sampleRate, channels);
+    uint32_t i;
+
+    for (i = 0; copy && i < chain->count; ++i) {
+        if (!addNode(copy, chain->nodes[i], chain->nodes[i]->shared)) {
+            coralEffectChainRelease(copy);
+            return NULL;
+        }
+    }
+    if (copy) {
+        copy->source = chain;
+        coralEffectChainRetain(chain);
+    }
+    return copy;
+}
+
+bool coralEffectChainAddEq(CoralEffectChain* chain, const CoralBiquadBand* bands, uint32_t count) {
+    EffectNode config;
+    uint32_t i;
+
+    if (!chain || !bands || count == 0) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Invalid argument");
+        return false;
+    }
+    for (i = 0; i < count; ++i) {
+        if (bands[i].type < CORAL_BIQUAD_LOWPASS || bands[i].type > CORAL_BIQUAD_HIGH_SHELF ||
+            !(bands[i].frequency > 0.0f) || !(bands[i].q > 0.0f)) {
+            coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Invalid EQ band %u", (unsigned)i);
+            return false;
+        }
+    }
+
+    memset(&config, 0, sizeof(config));
+    config.type = EFFECT_EQ;
+    config.bands = (CoralBiquadBand*)bands;
+    config.stages = count;
+    return addNode(chain, &config, NULL);
+}
+
+bool coralEffectChainAddCompressor(CoralEffectChain* chain, const CoralCompressorConfig* compressor) {
+    EffectNode config;
+
+    if (!chain || !compressor || !(compressor->ratio >= 1.0f) || !(compressor->kneeDb >= 0.0f) ||
+        !(compressor->attackMs >= 0.0f) || !(compressor->releaseMs >= 0.0f)) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Invalid compressor settings");
+        return false;
+    }
+
+    memset(&config, 0, sizeof(config));
+    config.type = EFFECT_COMPRESSOR;
+    config.compressor = *compressor;
+    return addNode(chain, &config, NULL);
+}
+
+bool coralEffectChainAddLimiter(CoralEffectChain* chain, const CoralLimiterConfig* limiter) {
+    EffectNode config;
+
+    if (!chain || !limiter || !(limiter->lookaheadMs >= 0.0f) || limiter->lookaheadMs > EFFECT_MAX_LOOKAHEAD_MS ||
+        !(limiter->releaseMs >= 0.0f) || !(limiter->ceilingDb <= 0.0f)) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Invalid limiter settings");
+        return false;
+    }
+
+    memset(&config, 0, sizeof(config));
+    config.type = EFFECT_LIMITER;
+    config.limiter = *limiter;
+    return addNode(chain, &config, NULL);
+}
+
+uint32_t coralEffectChainNodeCount(const CoralEffectChain* chain) {
+    return chain ? chain->count : 0;
+}
+
+bool coralEffectChainSetBypass(CoralEffectChain* chain, uint32_t node, bool bypass) {
+    if (!chain || node >= chain->count) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "No effect node %u", (unsigned)node);
+        return false;
+    }
+    coralAtomicStore(&chain->nodes[node]->shared->bypass, bypass ? 1 : 0);
+    return true;
+}
+
+uint32_t coralEffectChainLatency(const CoralEffectChain* chain) {
+    uint32_t latency = 0;
+    uint32_t i;
+
+    for (i = 0; chain && i < chain->count; ++i) {
+        latency += chain->nodes[i]->latency;
+    }
+    return latency;
+}
+
+void coralEffectChainReset(CoralEffectChain* chain) {
+    uint32_t i;
+
+    for (i = 0; chain && i < chain->count; ++i) {
+        resetNode(chain->nodes[i], chain->channels);
+    }
+}
+
+static void runNode(EffectNode* node, float* block, size_t frames, uint16_t channels) {
+    EffectShared* shared = node->shared;
+    uint64_t start;
+    uint64_t elapsed;
+
+    // A bypassed limiter still delays, so the timing does not jump
+    if (coralAtomicLoad(&shared->bypass) && node->latency == 0) {
+        return;
+    }
+
+    start = coralTimeNs();
+    switch (node->type) {
+    case EFFECT_EQ: processEq(node, block, frames, channels); break;
+    case EFFECT_COMPRESSOR: processCompressor(node, block, frames, channels); break;
+    case EFFECT_LIMITER: processLimiter(node, block, frames, channels); break;
+    }
+    elapsed = coralTimeNs() - start;
+
+    coralAtomicAdd64(&shared->blocks, 1);
+    coralAtomicAdd64(&shared->frames, frames);
+    coralAtomicAdd64(&shared->totalNs, elapsed);
+    coralAtomicMax64(&shared->maxBlockNs, elapsed);
+}
+
+void coralEffectChainProcess(CoralEffectChain* chain, float* samples, size_t frames) {
+    size_t chunk;
+    uint32_t i;
+
+    if (!chain || !samples || chain->count == 0) {
+        return;
+    }
+
+    while (frames > 0) {
+        chunk = frames < CORAL_EFFECT_BLOCK_FRAMES ? frames : CORAL_EFFECT_BLOCK_FRAMES;
+        // The block buffer has room for the lane kernels to read past the end
+        memcpy(chain->block, samples, chunk * chain->channels * sizeof(float));
+        for (i = 0; i < chain->count; ++i) {
+            runNode(chain->nodes[i], chain->block, chunk, chain->channels);
+        }
+        memcpy(samples, chain->block, chunk * chain->channels * sizeof(float));
+        samples += chunk * chain->channels;
+        frames -= chunk;
+    }
+}
+
+bool coralEffectChainGetStats(const CoralEffectChain* chain, uint32_t node, CoralEffectStats* stats) {
+    EffectShared* shared;
+
+    if (!chain || !stats || node >= chain->count) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "No effect node %u", (unsigned)node);
+        return false;
+    }
+    shared = chain->nodes[node]->shared;
+    stats->blocks = coralAtomicLoad64(&shared->blocks);
+    stats->frames = coralAtomicLoad64(&shared->frames);
+    stats->totalNs = coralAtomicLoad64(&shared->totalNs);
+    stats->maxBlockNs = coralAtomicLoad64(&shared->maxBlockNs);
+    return true;
+}
+
+void coralEffectChainResetStats(CoralEffectChain* chain) {
+    EffectShared* shared;
+    uint32_t i;
+
+    for (i = 0; chain && i < chain->count; ++i) {
+        shared = chain->nodes[i]->shared;
+        coralAtomicStore64(&shared->blocks, 0);
+        coralAtomicStore64(&shared->frames, 0);
+        coralAtomicStore64(&shared->totalNs, 0);
+        coralAtomicStore64(&shared->maxBlockNs, 0);
+    }
+}
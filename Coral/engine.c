@@ -0,0 +1,681 @@
+/*
+@file - engine.c
+@developer - ColorProgrammy
+@brief - Asynchronous playback.
+@date - 16/10/2026
+@description - A single audio thread plays every sound started with
+playWavFileAsync. Sounds that share a format are voices of one mixer and
+one output, so firing many short sounds does not open many devices.
+*/
+
+#include "internal.h"
+
+#define ENGINE_MAX_VOICES 4096
+#define ENGINE_BLOCK_FRAMES 1024
+#define ENGINE_IDLE_CLOSE_MS 2000
+#define NO_SLOT (-1)
+
+enum {
+    SLOT_FREE,
+    SLOT_ACTIVE,
+    SLOT_DONE
+};
+
+typedef struct {
+    uint16_t generation;        // Bumped on every reuse so stale handles miss
+    uint8_t state;
+    bool completed;             // Result once state is SLOT_DONE
+    bool stopRequested;
+    bool gainChanged;           // gain, rampFrames and rampShape wait for the audio thread
+    bool loopChanged;           // Likewise loopStart, loopEnd and repeats
+
+    const WavFile* wavFile;
+    WavFormat format;
+    CoralVoice voice;           // Voice in the output's mixer once attached
+    CoralCompletionCallback callback;
+    void* userData;
+    float startGain;
+    float gain;
+    uint32_t rampFrames;
+    CoralRampShape rampShape;
+    uint64_t loopStart;
+    uint64_t loopEnd;
+    uint32_t repeats;
+
+    int next;                   // Link in the pending, output or finished list
+} EngineSlot;
+
+typedef struct EngineOutput {
+    WavFormat format;
+    CoralDevice* device;
+    int voices;
+    uint64_t idleSince;         // 0 while voices are playing
+    CoralMixer* mixer;
+    uint8_t* block;
+    uint32_t blockFrames;       // Matches the device period when one was configured
+    struct EngineOutput* next;
+} EngineOutput;
+
+static struct {
+    CoralMutex mutex;
+    CoralCond wake;             // New work for the audio thread
+    CoralCond finished;         // A sound finished; wakes coralWait
+    CoralThread thread;
+    bool running;
+    bool stopping;
+
+    EngineSlot slots[ENGINE_MAX_VOICES];
+    // FIFO, so the result of a finished sound survives as long as possible
+    int freeSlots[ENGINE_MAX_VOICES];
+    int freeHead;
+    int freeCount;
+    int pendingHead;
+    int pendingTail;
+
+    EngineOutput* outputs;      // Owned by the audio thread
+} engine;
+
+static CoralOnce engineOnce = CORAL_ONCE_INIT;
+
+static void engineInit(void) {
+    int i;
+
+    coralMutexInit(&engine.mutex);
+    coralCondInit(&engine.wake);
+    coralCondInit(&engine.finished);
+    for (i = 0; i < ENGINE_MAX_VOICES; ++i) {
+        engine.freeSlots[i] = i;
+    }
+    engine.freeCount = ENGINE_MAX_VOICES;
+    engine.pendingHead = NO_SLOT;
+    engine.pendingTail = NO_SLOT;
+}
+
+static CoralHandle makeHandle(int index) {
+    return ((CoralHandle)engine.slots[index].generation << 16) | (CoralHandle)(index + 1);
+}
+
+static EngineSlot* lookupSlot(CoralHandle handle) {
+    int index = (int)(handle & 0xFFFF) - 1;
+
+    if (index < 0 || index >= ENGINE_MAX_VOICES ||
+        engine.slots[index].generation != (uint16_t)(handle >> 16)) {
+        return NULL;
+    }
+    return &engine.slots[index];
+}
+
+static bool sameFormat(const WavFormat* a, const WavFormat* b) {
+    return a->audioFormat == b->audioFormat &&
+        a->sampleRate == b->sampleRate &&
+        a->numChannels == b->numChannels &&
+        a->bitsPerSample == b->bitsPerSample;
+}
+
+// Moves every voice of the output onto the finished list
+static void finishOutputVoices(EngineOutput* output, bool completed, int* finished) {
+    int index;
+
+    while (output->voices != NO_SLOT) {
+        index = output->voices;
+        output->voices = engine.slots[index].next;
+        coralMixerRemoveVoice(output->mixer, engine.slots[index].voice);
+        engine.slots[index].completed = completed;
+        engine.slots[index].next = *finished;
+        *finished = index;
+    }
+}
+
+// Retires stopped voices and passes gain changes on to the mixers.
+// Called with the engine mutex held.
+static void collectRequests(int* finished) {
+    EngineOutput* output;
+    EngineSlot* voice;
+    int* link;
+    int index;
+
+    for (output = engine.outputs; output; output = output->next) {
+        link = &output->voices;
+        while (*link != NO_SLOT) {
+            index = *link;
+            voice = &engine.slots[index];
+            if (voice->stopRequested) {
+                *link = voice->next;
+                coralMixerRemoveVoice(output->mixer, voice->voice);
+                voice->completed = false;
+                voice->next = *finished;
+                *finished = index;
+            }
+            else {
+                if (voice->gainChanged) {
+                    coralMixerRampVoice(output->mixer, voice->voice, voice->gain, voice->rampFrames, voice->rampShape);
+                    voice->gainChanged = false;
+                }
+                if (voice->loopChanged) {
+                    coralMixerLoopVoice(output->mixer, voice->voice, voice->loopStart, voice->loopEnd, voice->repeats);
+                    voice->loopChanged = false;
+                }
+                link = &voice->next;
+            }
+        }
+    }
+}
+
+static EngineOutput* findOutput(const WavFormat* format) {
+    EngineOutput* output;
+    CoralSampleFormat sampleFormat;
+
+    for (output = engine.outputs; output; output = output->next) {
+        if (sameFormat(&output->format, format)) {
+            return output;
+        }
+    }
+
+    output = (EngineOutput*)malloc(sizeof(EngineOutput));
+    if (!output) {
+        return NULL;
+    }
+    memset(output, 0, sizeof(EngineOutput));
+    output->format = *format;
+    output->voices = NO_SLOT;
+    output->mixer = coralSampleFormatOf(format, &sampleFormat) ?
+        coralMixerCreate(format->sampleRate, format->numChannels, sampleFormat) : NULL;
+    output->block = (uint8_t*)malloc(ENGINE_BLOCK_FRAMES * format->blockAlign);
+    output->blockFrames = ENGINE_BLOCK_FRAMES;
+    if (!output->mixer || !output->block) {
+        coralMixerDestroy(output->mixer);
+        free(output->block);
+        free(output);
+        return NULL;
+    }
+    output->next = engine.outputs;
+    engine.outputs = output;
+    return output;
+}
+
+static void freeOutput(EngineOutput* output) {
+    if (output->device) {
+        if (coralDeviceDrain(output->device)) {
+            coralDeviceRelease(output->device, &output->format);
+        }
+        else {
+            coralDeviceClose(output->device);
+        }
+    }
+    coralMixerDestroy(output->mixer);
+    free(output->block);
+    free(output);
+}
+
+// Hands newly started voices to the output for their format. Devices are
+// opened here, outside the engine mutex.
+static void attachVoices(int pending, int* finished) {
+    EngineOutput* output;
+    EngineSlot* voice;
+    bool stopped;
+    int index;
+
+    while (pending != NO_SLOT) {
+        index = pending;
+        voice = &engine.slots[index];
+        pending = voice->next;
+
+        // Stopped before it started: it never reaches a device
+        coralMutexLock(&engine.mutex);
+        stopped = voice->stopRequested;
+        coralMutexUnlock(&engine.mutex);
+        if (stopped) {
+            voice->completed = false;
+            voice->next = *finished;
+            *finished = index;
+            continue;
+        }
+
+        output = findOutput(&voice->format);
+        if (output && !output->device) {
+            output->device = coralDeviceAcquire(&output->format);
+            output->blockFrames = ENGINE_BLOCK_FRAMES;
+            if (output->device && coralDevicePeriodFrames(output->device) > 0 &&
+                coralDevicePeriodFrames(output->device) < ENGINE_BLOCK_FRAMES) {
+                output->blockFrames = coralDevicePeriodFrames(output->device);
+            }
+        }
+        if (output && output->device) {
+            voice->voice = coralMixerAddVoice(output->mixer, voice->wavFile, voice->startGain, 0.0f);
+            // Set the loop before the first block renders; coralSetLoop may
+            // already be changing it, so look under the mutex
+            coralMutexLock(&engine.mutex);
+            if (voice->voice && voice->loopChanged) {
+                coralMixerLoopVoice(output->mixer, voice->voice, voice->loopStart, voice->loopEnd, voice->repeats);
+                voice->loopChanged = false;
+            }
+            // A stop that came in while the device opened drops the voice before it renders
+            if (voice->voice && voice->stopRequested) {
+                coralMixerRemoveVoice(output->mixer, voice->voice);
+                voice->voice = 0;
+            }
+            coralMutexUnlock(&engine.mutex);
+        }
+        if (!output || !output->device || !voice->voice) {
+            voice->completed = false;
+            voice->next = *finished;
+            *finished = index;
+            continue;
+        }
+
+        voice->next = output->voices;
+        output->voices = index;
+        output->idleSince = 0;
+    }
+}
+
+// Writes one block to the output and retires voices that ran out of data
+static void renderOutput(EngineOutput* output, int* finished) {
+    EngineSlot* voice;
+    size_t frames;
+    int* link;
+    int index;
+
+    frames = coralMixerRenderFrames(output->mixer, output->block, output->blockFrames, NULL);
+    if (frames > 0 && !coralDeviceWrite(output->device, output->block, frames * output->format.blockAlign)) {
+        // Drop the device; the next sound in this format reopens it
+        finishOutputVoices(output, false, finished);
+        coralDeviceClose(output->device);
+        output->device = NULL;
+        return;
+    }
+
+    link = &output->voices;
+    while (*link != NO_SLOT) {
+        index = *link;
+        voice = &engine.slots[index];
+        if (!coralMixerIsVoiceActive(output->mixer, voice->voice)) {
+            *link = voice->next;
+            voice->completed = true;
+            voice->next = *finished;
+            *finished = index;
+        }
+        else {
+            link = &voice->next;
+        }
+    }
+}
+
+// Runs callbacks, then releases the slots and wakes coralWait
+static void reportFinished(int finished) {
+    EngineSlot* slot;
+    int index;
+
+    while (finished != NO_SLOT) {
+        index = finished;
+        slot = &engine.slots[index];
+        finished = slot->next;
+
+        if (slot->callback) {
+            slot->callback(makeHandle(index), slot->completed, slot->userData);
+        }
+
+        coralMutexLock(&engine.mutex);
+        slot->state = SLOT_DONE;
+        engine.freeSlots[(engine.freeHead + engine.freeCount) % ENGINE_MAX_VOICES] = index;
+        engine.freeCount++;
+        coralCondBroadcast(&engine.finished);
+        coralMutexUnlock(&engine.mutex);
+    }
+}
+
+// Hands outputs that have had nothing to play for a while back to the
+// device pool. Returns true while any output is still attached.
+static bool closeIdleOutputs(void) {
+    EngineOutput** link = &engine.outputs;
+    EngineOutput* output;
+    uint64_t now = coralTimeNs();
+
+    while (*link) {
+        output = *link;
+        if (output->voices == NO_SLOT) {
+            if (output->idleSince == 0) {
+                output->idleSince = now;
+            }
+            else if (now - output->idleSince >= (uint64_t)ENGINE_IDLE_CLOSE_MS * 1000000ULL) {
+                *link = output->next;
+                freeOutput(output);
+                continue;
+            }
+        }
+        link = &output->next;
+    }
+    return engine.outputs != NULL;
+}
+
+static void engineThread(void* arg) {
+    CoralLatencyConfig config;
+    EngineOutput* output;
+    int pending;
+    int finished;
+    bool playing;
+
+    (void)arg;
+
+    coralGetLatencyConfig(&config);
+    if (config.realtimePriority) {
+        coralNoteRealtime(coralThreadSetRealtime());
+    }
+
+    coralMutexLock(&engine.mutex);
+    while (engine.running) {
+        pending = engine.pendingHead;
+        engine.pendingHead = NO_SLOT;
+        engine.pendingTail = NO_SLOT;
+        finished = NO_SLOT;
+        collectRequests(&finished);
+        coralMutexUnlock(&engine.mutex);
+
+        attachVoices(pending, &finished);
+
+        playing = false;
+        for (output = engine.outputs; output; output = output->next) {
+            if (output->voices != NO_SLOT) {
+                renderOutput(output, &finished);
+                playing = playing || output->voices != NO_SLOT;
+            }
+        }
+        reportFinished(finished);
+
+        coralMutexLock(&engine.mutex);
+        if (!playing && engine.pendingHead == NO_SLOT && engine.running) {
+            // Keep idle outputs warm for a while so bursts reuse them
+            coralMutexUnlock(&engine.mutex);
+            playing = closeIdleOutputs();
+            coralMutexLock(&engine.mutex);
+            if (engine.pendingHead == NO_SLOT && engine.running) {
+                if (playing) {
+                    coralCondWaitTimeout(&engine.wake, &engine.mutex, 100);
+                }
+                else {
+                    coralCondWait(&engine.wake, &engine.mutex);
+                }
+            }
+        }
+    }
+
+    // Shutting down: everything left counts as stopped
+    finished = NO_SLOT;
+    while (engine.pendingHead != NO_SLOT) {
+        pending = engine.pendingHead;
+        engine.pendingHead = engine.slots[pending].next;
+        engine.slots[pending].completed = false;
+        engine.slots[pending].next = finished;
+        finished = pending;
+    }
+    engine.pendingTail = NO_SLOT;
+    coralMutexUnlock(&engine.mutex);
+
+    for (output = engine.outputs; output; output = output->next) {
+        finishOutputVoices(output, false, &finished);
+    }
+    reportFinished(finished);
+
+    while (engine.outputs) {
+        output = engine.outputs;
+        engine.outputs = output->next;
+        if (output->device) {
+            coralDeviceClose(output->device);
+            output->device = NULL;
+        }
+        freeOutput(output);
+    }
+}
+
+CoralHandle playWavFileAsync(const WavFile* wavFile, CoralCompletionCallback callback, void* userData) {
+    return playWavFileAsyncWithGain(wavFile, 1.0f, callback, userData);
+}
+
+// Checks a loop the way coralMixerLoopVoice will, so errors reach the caller
+static bool checkLoop(const WavFile* wavFile, uint64_t loopStart, uint64_t loopEnd) {
+    uint64_t frames = coralFrameCount(&wavFile->wavFormat, coralWavDataSize(wavFile));
+
+    if (loopStart == 0 && loopEnd == 0) {
+        if (frames == 0) {
+            coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Sound has no frames to loop");
+            return false;
+        }
+        return true;
+    }
+    if (loopStart >= loopEnd || loopEnd > frames) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Loop %llu-%llu does not fit the %llu frames of the sound",
+            (unsigned long long)loopStart, (unsigned long long)loopEnd, (unsigned long long)frames);
+        return false;
+    }
+    return true;
+}
+
+static CoralHandle startSound(const WavFile* wavFile, float gain, bool looped, uint64_t loopStart, uint64_t loopEnd,
+    uint32_t repeats, CoralCompletionCallback callback, void* userData) {
+    EngineSlot* slot;
+    CoralHandle handle;
+    CoralSampleFormat sampleFormat;
+    WavFormat playback;
+    int index;
+
+    if (!wavFile) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null WAV file pointer");
+        return 0;
+    }
+    if (!coralPlaybackFormat(&wavFile->wavFormat, &playback, &sampleFormat)) {
+        return 0;
+    }
+    if (wavFile->wavFormat.numChannels == 0 || (coralCodecOf(&wavFile->wavFormat) == CORAL_CODEC_NONE &&
+        wavFile->wavFormat.blockAlign != wavFile->wavFormat.numChannels * (wavFile->wavFormat.bitsPerSample / 8))) {
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Invalid block alignment");
+        return 0;
+    }
+    if (looped && !checkLoop(wavFile, loopStart, loopEnd)) {
+        return 0;
+    }
+
+    coralCallOnce(&engineOnce, engineInit);
+    coralMutexLock(&engine.mutex);
+
+    if (engine.stopping) {
+        coralMutexUnlock(&engine.mutex);
+        coralSetError(CORAL_ERROR_BUSY, "Audio engine is shutting down");
+        return 0;
+    }
+    if (!engine.running) {
+        engine.running = true;
+        if (!coralThreadStart(&engine.thread, engineThread, NULL)) {
+            engine.running = false;
+            coralMutexUnlock(&engine.mutex);
+            return 0;
+        }
+    }
+    if (engine.freeCount == 0) {
+        coralMutexUnlock(&engine.mutex);
+        coralSetError(CORAL_ERROR_BUSY, "Too many sounds playing");
+        return 0;
+    }
+
+    index = engine.freeSlots[engine.freeHead];
+    engine.freeHead = (engine.freeHead + 1) % ENGINE_MAX_VOICES;
+    engine.freeCount--;
+
+    slot = &engine.slots[index];
+    slot->generation++;
+    slot->state = SLOT_ACTIVE;
+    slot->completed = false;
+    slot->stopRequested = false;
+    slot->gainChanged = false;
+    slot->loopChanged = looped;
+    slot->loopStart = loopStart;
+    slot->loopEnd = loopEnd;
+    slot->repeats = repeats;
+    slot->startGain = gain;
+    slot->gain = gain;
+    slot->wavFile = wavFile;
+    slot->voice = 0;
+    // Compressed sounds share the output of the PCM they decode to
+    slot->format = playback;
+    slot->callback = callback;
+    slot->userData = userData;
+    slot->next = NO_SLOT;
+
+    if (engine.pendingTail == NO_SLOT) {
+        engine.pendingHead = index;
+    }
+    else {
+        engine.slots[engine.pendingTail].next = index;
+    }
+    engine.pendingTail = index;
+
+    handle = makeHandle(index);
+    coralCondSignal(&engine.wake);
+    coralMutexUnlock(&engine.mutex);
+    return handle;
+}
+
+CoralHandle playWavFileAsyncWithGain(const WavFile* wavFile, float gain, CoralCompletionCallback callback, void* userData) {
+    return startSound(wavFile, gain, false, 0, 0, 0, callback, userData);
+}
+
+CoralHandle playWavFileAsyncLooped(const WavFile* wavFile, uint64_t loopStart, uint64_t loopEnd, uint32_t repeats,
+    CoralCompletionCallback callback, void* userData) {
+    return startSound(wavFile, 1.0f, true, loopStart, loopEnd, repeats, callback, userData);
+}
+
+bool coralWait(CoralHandle handle) {
+    EngineSlot* slot;
+    bool completed = true;
+    int index = (int)(handle & 0xFFFF) - 1;
+
+    coralCallOnce(&engineOnce, engineInit);
+    coralMutexLock(&engine.mutex);
+    // A slot that never held a sound cannot have issued the handle
+    if (index < 0 || index >= ENGINE_MAX_VOICES || engine.slots[index].state == SLOT_FREE) {
+        coralMutexUnlock(&engine.mutex);
+        coralSetError(CORAL_ERROR_INVALID_HANDLE, "Invalid sound handle");
+        return false;
+    }
+    slot = lookupSlot(handle);
+    if (slot) {
+        while (slot->state == SLOT_ACTIVE && slot->generation == (uint16_t)(handle >> 16)) {
+            coralCondWait(&engine.finished, &engine.mutex);
+        }
+        // If the slot was already reused the sound is long gone
+        if (slot->generation == (uint16_t)(handle >> 16)) {
+            completed = slot->completed;
+        }
+    }
+    coralMutexUnlock(&engine.mutex);
+    return completed;
+}
+
+bool coralStop(CoralHandle handle) {
+    EngineSlot* slot;
+    bool stopped = false;
+
+    coralCallOnce(&engineOnce, engineInit);
+    coralMutexLock(&engine.mutex);
+    slot = lookupSlot(handle);
+    if (slot && slot->state == SLOT_ACTIVE) {
+        slot->stopRequested = true;
+        coralCondSignal(&engine.wake);
+        stopped = true;
+    }
+    coralMutexUnlock(&engine.mutex);
+
+    if (!stopped) {
+        coralSetError(CORAL_ERROR_INVALID_HANDLE, "Sound is not playing");
+    }
+    return stopped;
+}
+
+bool coralSetGain(CoralHandle handle, float gain, uint32_t rampFrames, CoralRampShape shape) {
+    EngineSlot* slot;
+    bool changed = false;
+
+    if (shape != CORAL_RAMP_LINEAR && shape != CORAL_RAMP_EXPONENTIAL) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Invalid ramp shape: %d", (int)shape);
+        return false;
+    }
+
+    coralCallOnce(&engineOnce, engineInit);
+    coralMutexLock(&engine.mutex);
+    slot = lookupSlot(handle);
+    if (slot && slot->state == SLOT_ACTIVE) {
+        // Applied by the audio thread before its next block; a later call
+        // replaces a change it has not picked up yet
+        slot->gain = gain;
+        slot->rampFrames = rampFrames;
+        slot->rampShape = shape;
+        slot->gainChanged = true;
+        changed = true;
+    }
+    coralMutexUnlock(&engine.mutex);
+
+    if (!changed) {
+        coralSetError(CORAL_ERROR_INVALID_HANDLE, "Sound is not playing");
+    }
+    return changed;
+}
+
+bool coralSetLoop(CoralHandle handle, uint64_t loopStart, uint64_t loopEnd, uint32_t repeats) {
+    EngineSlot* slot;
+    bool changed = false;
+
+    coralCallOnce(&engineOnce, engineInit);
+    coralMutexLock(&engine.mutex);
+    slot = lookupSlot(handle);
+    if (!slot || slot->state != SLOT_ACTIVE) {
+        coralMutexUnlock(&engine.mutex);
+        coralSetError(CORAL_ERROR_INVALID_HANDLE, "Sound is not playing");
+        return false;
+    }
+    // The slot keeps its WavFile alive for as long as it plays
+    if (checkLoop(slot->wavFile, loopStart, loopEnd)) {
+        slot->loopStart = loopStart;
+        slot->loopEnd = loopEnd;
+        slot->repeats = repeats;
+        slot->loopChanged = true;
+        changed = true;
+    }
+    coralMutexUnlock(&engine.mutex);
+    return changed;
+}
+
+bool coralIsPlaying(CoralHandle handle) {
+    EngineSlot* slot;
+    bool playing;
+
+    coralCallOnce(&engineOnce, engineInit);
+    coralMutexLock(&engine.mutex);
+    slot = lookupSlot(handle);
+    playing = slot && slot->state == SLOT_ACTIVE;
+    coralMutexUnlock(&engine.mutex);
+    return playing;
+}
+
+void coralShutdown(void) {
+    coralCallOnce(&engineOnce, engineInit);
+    coralMutexLock(&engine.mutex);
+    if (engine.stopping) {
+        coralMutexUnlock(&engine.mutex);
+        return;
+    }
+    if (engine.running) {
+        engine.running = false;
+        engine.stopping = true;
+        coralCondSignal(&engine.wake);
+        coralMutexUnlock(&engine.mutex);
+
+        coralThreadJoin(engine.thread);
+
+        coralMutexLock(&engine.mutex);
+        engine.stopping = false;
+    }
+    coralMutexUnlock(&engine.mutex);
+
+    // Blocking playback parks devices too, whether or not the engine ran;
+    // the engine hands its outputs to the pool, so the pool goes last
+    coralDevicePoolShutdown();
+}
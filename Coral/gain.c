@@ -0,0 +1,725 @@
+/*
+@file - gain.c
+@developer - ColorProgrammy
+@brief - Volume adjustment kernels.
+@date - 16/10/2026
+@description - Scalar, SSE2, AVX2 and NEON gain kernels for 8/16/24/32-bit
+PCM and 32-bit float, picked once per call from the detected instruction set.
+Also runs the sample-accurate gain ramps used at playback time.
+*/
+
+#include "internal.h"
+#include <math.h>
+
+// Exponential ramps cannot start or end at zero; -80 dB stands in for it
+#define RAMP_FLOOR 0.0001f
+
+// The scalar kernels are the reference. Vector kernels clamp in float before
+// truncating, which gives the same result as truncating first because the
+// limits are whole numbers, so every path produces bit-identical output.
+
+typedef void (*GainKernel)(uint8_t* data, size_t count, float gain);
+typedef void (*FixedGainKernel)(uint8_t* data, size_t count, int32_t gain);
+
+typedef struct {
+    GainKernel gain[4];             // Indexed by bytes per sample - 1
+    FixedGainKernel fixedGain[4];
+    GainKernel floatGain;           // IEEE float; no clamping, values may exceed 1
+} GainKernels;
+
+static int32_t load24(const uint8_t* p) {
+    return (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8;
+}
+
+static void store24(uint8_t* p, int32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+}
+
+static void gain8Scalar(uint8_t* data, size_t count, float gain) {
+    size_t i;
+    float scaled;
+
+    for (i = 0; i < count; ++i) {
+        scaled = (float)(data[i] - 128) * gain;
+        if (scaled < -128.0f) scaled = -128.0f;
+        else if (scaled > 127.0f) scaled = 127.0f;
+        data[i] = (uint8_t)((int32_t)scaled + 128);
+    }
+}
+
+static void gain16Scalar(uint8_t* data, size_t count, float gain) {
+    int16_t* samples = (int16_t*)data;
+    size_t i;
+    float scaled;
+
+    for (i = 0; i < count; ++i) {
+        scaled = (float)samples[i] * gain;
+        if (scaled < -32768.0f) scaled = -32768.0f;
+        else if (scaled > 32767.0f) scaled = 32767.0f;
+        samples[i] = (int16_t)scaled;
+    }
+}
+
+static void gain24Scalar(uint8_t* data, size_t count, float gain) {
+    size_t i;
+    float scaled;
+
+    for (i = 0; i < count; ++i, data += 3) {
+        scaled = (float)load24(data) * gain;
+        if (scaled < -8388608.0f) scaled = -8388608.0f;
+        else if (scaled > 8388607.0f) scaled = 8388607.0f;
+        store24(data, (int32_t)scaled);
+    }
+}
+
+static void gain32Scalar(uint8_t* data, size_t count, float gain) {
+    int32_t* samples = (int32_t*)data;
+    size_t i;
+    float scaled;
+
+    // INT32_MAX is not representable as a float, so compare against 2^31
+    for (i = 0; i < count; ++i) {
+        scaled = (float)samples[i] * gain;
+        if (scaled >= 2147483648.0f) samples[i] = INT32_MAX;
+        else if (scaled <= -2147483648.0f) samples[i] = INT32_MIN;
+        else samples[i] = (int32_t)scaled;
+    }
+}
+
+static void fixedGain8Scalar(uint8_t* data, size_t count, int32_t gain) {
+    size_t i;
+    int32_t value;
+
+    for (i = 0; i < count; ++i) {
+        value = ((int32_t)(data[i] - 128) * gain) >> 8;
+        if (value < -128) value = -128;
+        else if (value > 127) value = 127;
+        data[i] = (uint8_t)(value + 128);
+    }
+}
+
+static void fixedGain16Scalar(uint8_t* data, size_t count, int32_t gain) {
+    int16_t* samples = (int16_t*)data;
+    size_t i;
+    int32_t value;
+
+    for (i = 0; i < count; ++i) {
+        value = ((int32_t)samples[i] * gain) >> 8;
+        if (value < INT16_MIN) value = INT16_MIN;
+        else if (value > INT16_MAX) value = INT16_MAX;
+        samples[i] = (int16_t)value;
+    }
+}
+
+static void fixedGain24Scalar(uint8_t* data, size_t count, int32_t gain) {
+    size_t i;
+    int64_t value;
+
+    for (i = 0; i < count; ++i, data += 3) {
+        value = ((int64_t)load24(data) * gain) >> 8;
+        if (value < -8388608) value = -8388608;
+        else if (value > 8388607) value = 8388607;
+        store24(data, (int32_t)value);
+    }
+}
+
+static void fixedGain32Scalar(uint8_t* data, size_t count, int32_t gain) {
+    int32_t* samples = (int32_t*)data;
+    size_t i;
+    int64_t value;
+
+    for (i = 0; i < count; ++i) {
+        value = ((int64_t)samples[i] * gain) >> 8;
+        if (value < INT32_MIN) value = INT32_MIN;
+        else if (value > INT32_MAX) value = INT32_MAX;
+        samples[i] = (int32_t)value;
+    }
+}
+
+static void gainFloatScalar(uint8_t* data, size_t count, float gain) {
+    float* samples = (float*)data;
+    size_t i;
+
+    for (i = 0; i < count; ++i) {
+        samples[i] *= gain;
+    }
+}
+
+static const GainKernels scalarKernels = {
+    { gain8Scalar, gain16Scalar, gain24Scalar, gain32Scalar },
+    { fixedGain8Scalar, fixedGain16Scalar, fixedGain24Scalar, fixedGain32Scalar },
+    gainFloatScalar
+};
+
+#ifdef CORAL_ARCH_X86
+static CORAL_TARGET_SSE2 __m128i scaleSse2(__m128i v, __m128 gain, __m128 lo, __m128 hi) {
+    __m128 scaled = _mm_mul_ps(_mm_cvtepi32_ps(v), gain);
+    scaled = _mm_min_ps(_mm_max_ps(scaled, lo), hi);
+    return _mm_cvttps_epi32(scaled);
+}
+
+static CORAL_TARGET_SSE2 void gain8Sse2(uint8_t* data, size_t count, float gain) {
+    __m128 g = _mm_set1_ps(gain);
+    __m128 lo = _mm_set1_ps(-128.0f);
+    __m128 hi = _mm_set1_ps(127.0f);
+    __m128i zero = _mm_setzero_si128();
+    __m128i bias = _mm_set1_epi32(128);
+    __m128i v, w0, w1, a, b, c, d;
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        v = _mm_loadu_si128((const __m128i*)(data + i));
+        w0 = _mm_unpacklo_epi8(v, zero);
+        w1 = _mm_unpackhi_epi8(v, zero);
+        a = _mm_sub_epi32(_mm_unpacklo_epi16(w0, zero), bias);
+        b = _mm_sub_epi32(_mm_unpackhi_epi16(w0, zero), bias);
+        c = _mm_sub_epi32(_mm_unpacklo_epi16(w1, zero), bias);
+        d = _mm_sub_epi32(_mm_unpackhi_epi16(w1, zero), bias);
+        a = _mm_add_epi32(scaleSse2(a, g, lo, hi), bias);
+        b = _mm_add_epi32(scaleSse2(b, g, lo, hi), bias);
+        c = _mm_add_epi32(scaleSse2(c, g, lo, hi), bias);
+        d = _mm_add_epi32(scaleSse2(d, g, lo, hi), bias);
+        v = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128((__m128i*)(data + i), v);
+    }
+    gain8Scalar(data + i, count - i, gain);
+}
+
+static CORAL_TARGET_SSE2 void gain16Sse2(uint8_t* data, size_t count, float gain) {
+    int16_t* samples = (int16_t*)data;
+    __m128 g = _mm_set1_ps(gain);
+    __m128 lo = _mm_set1_ps(-32768.0f);
+    __m128 hi = _mm_set1_ps(32767.0f);
+    __m128i v, a, b;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        v = _mm_loadu_si128((const __m128i*)(samples + i));
+        a = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        b = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        a = scaleSse2(a, g, lo, hi);
+        b = scaleSse2(b, g, lo, hi);
+        _mm_storeu_si128((__m128i*)(samples + i), _mm_packs_epi32(a, b));
+    }
+    gain16Scalar(data + i * 2, count - i, gain);
+}
+
+static CORAL_TARGET_SSE2 void gain24Sse2(uint8_t* data, size_t count, float gain) {
+    __m128 g = _mm_set1_ps(gain);
+    __m128 lo = _mm_set1_ps(-8388608.0f);
+    __m128 hi = _mm_set1_ps(8388607.0f);
+    int32_t out[4];
+    uint8_t* p = data;
+    size_t i = 0;
+
+    // SSE2 has no byte shuffle, so only the arithmetic is vectorized
+    for (; i + 4 <= count; i += 4, p += 12) {
+        __m128i v = _mm_setr_epi32(load24(p), load24(p + 3), load24(p + 6), load24(p + 9));
+        _mm_storeu_si128((__m128i*)out, scaleSse2(v, g, lo, hi));
+        store24(p, out[0]);
+        store24(p + 3, out[1]);
+        store24(p + 6, out[2]);
+        store24(p + 9, out[3]);
+    }
+    gain24Scalar(p, count - i, gain);
+}
+
+static CORAL_TARGET_SSE2 void gain32Sse2(uint8_t* data, size_t count, float gain) {
+    int32_t* samples = (int32_t*)data;
+    __m128 g = _mm_set1_ps(gain);
+    __m128 limit = _mm_set1_ps(2147483648.0f);
+    __m128i maxValue = _mm_set1_epi32(INT32_MAX);
+    __m128 scaled;
+    __m128i over, r;
+    size_t i = 0;
+
+    // Out-of-range conversions return INT32_MIN, which is already right for
+    // the negative side; patch the positive side to INT32_MAX
+    for (; i + 4 <= count; i += 4) {
+        scaled = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(samples + i))), g);
+        over = _mm_castps_si128(_mm_cmpge_ps(scaled, limit));
+        r = _mm_cvttps_epi32(scaled);
+        r = _mm_or_si128(_mm_andnot_si128(over, r), _mm_and_si128(over, maxValue));
+        _mm_storeu_si128((__m128i*)(samples + i), r);
+    }
+    gain32Scalar(data + i * 4, count - i, gain);
+}
+
+// 16 x 8.8 products, shifted back and saturated to 16 bits
+static CORAL_TARGET_SSE2 __m128i fixedScaleSse2(__m128i v, __m128i gain) {
+    __m128i lo = _mm_mullo_epi16(v, gain);
+    __m128i hi = _mm_mulhi_epi16(v, gain);
+    __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 8);
+    __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 8);
+    return _mm_packs_epi32(a, b);
+}
+
+static CORAL_TARGET_SSE2 void fixedGain8Sse2(uint8_t* data, size_t count, int32_t gain) {
+    __m128i g = _mm_set1_epi16((short)gain);
+    __m128i zero = _mm_setzero_si128();
+    __m128i bias = _mm_set1_epi16(128);
+    __m128i v, a, b;
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        v = _mm_loadu_si128((const __m128i*)(data + i));
+        a = _mm_sub_epi16(_mm_unpacklo_epi8(v, zero), bias);
+        b = _mm_sub_epi16(_mm_unpackhi_epi8(v, zero), bias);
+        a = _mm_adds_epi16(fixedScaleSse2(a, g), bias);
+        b = _mm_adds_epi16(fixedScaleSse2(b, g), bias);
+        _mm_storeu_si128((__m128i*)(data + i), _mm_packus_epi16(a, b));
+    }
+    fixedGain8Scalar(data + i, count - i, gain);
+}
+
+static CORAL_TARGET_SSE2 void fixedGain16Sse2(uint8_t* data, size_t count, int32_t gain) {
+    int16_t* samples = (int16_t*)data;
+    __m128i g = _mm_set1_epi16((short)gain);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(samples + i));
+        _mm_storeu_si128((__m128i*)(samples + i), fixedScaleSse2(v, g));
+    }
+    fixedGain16Scalar(data + i * 2, count - i, gain);
+}
+
+static CORAL_TARGET_SSE2 void gainFloatSse2(uint8_t* data, size_t count, float gain) {
+    float* samples = (float*)data;
+    __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), g));
+    }
+    gainFloatScalar(data + i * 4, count - i, gain);
+}
+
+static const GainKernels sse2Kernels = {
+    { gain8Sse2, gain16Sse2, gain24Sse2, gain32Sse2 },
+    { fixedGain8Sse2, fixedGain16Sse2, fixedGain24Scalar, fixedGain32Scalar },
+    gainFloatSse2
+};
+
+#ifdef CORAL_HAVE_AVX2
+static CORAL_TARGET_AVX2 __m256i scaleAvx2(__m256i v, __m256 gain, __m256 lo, __m256 hi) {
+    __m256 scaled = _mm256_mul_ps(_mm256_cvtepi32_ps(v), gain);
+    scaled = _mm256_min_ps(_mm256_max_ps(scaled, lo), hi);
+    return _mm256_cvttps_epi32(scaled);
+}
+
+static CORAL_TARGET_AVX2 void gain8Avx2(uint8_t* data, size_t count, float gain) {
+    __m256 g = _mm256_set1_ps(gain);
+    __m256 lo = _mm256_set1_ps(-128.0f);
+    __m256 hi = _mm256_set1_ps(127.0f);
+    __m256i bias = _mm256_set1_epi32(128);
+    __m256i a, b, packed;
+    __m128i v;
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        v = _mm_loadu_si128((const __m128i*)(data + i));
+        a = _mm256_sub_epi32(_mm256_cvtepu8_epi32(v), bias);
+        b = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8)), bias);
+        a = _mm256_add_epi32(scaleAvx2(a, g, lo, hi), bias);
+        b = _mm256_add_epi32(scaleAvx2(b, g, lo, hi), bias);
+        // packs works per 128-bit lane; restore sample order before narrowing
+        packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+        v = _mm_packus_epi16(_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1));
+        _mm_storeu_si128((__m128i*)(data + i), v);
+    }
+    gain8Scalar(data + i, count - i, gain);
+}
+
+static CORAL_TARGET_AVX2 void gain16Avx2(uint8_t* data, size_t count, float gain) {
+    int16_t* samples = (int16_t*)data;
+    __m256 g = _mm256_set1_ps(gain);
+    __m256 lo = _mm256_set1_ps(-32768.0f);
+    __m256 hi = _mm256_set1_ps(32767.0f);
+    __m256i v, a, b;
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        v = _mm256_loadu_si256((const __m256i*)(samples + i));
+        a = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v));
+        b = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1));
+        a = scaleAvx2(a, g, lo, hi);
+        b = scaleAvx2(b, g, lo, hi);
+        v = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i*)(samples + i), v);
+    }
+    gain16Scalar(data + i * 2, count - i, gain);
+}
+
+static CORAL_TARGET_AVX2 void gain24Avx2(uint8_t* data, size_t count, float gain) {
+    __m256 g = _mm256_set1_ps(gain);
+    __m256 lo = _mm256_set1_ps(-8388608.0f);
+    __m256 hi = _mm256_set1_ps(8388607.0f);
+    // Sample k's three bytes go to the top of dword k; srai then sign-extends
+    __m128i unpack = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    __m128i repack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    __m128i s0, s1;
+    __m256i v;
+    int32_t tail;
+    uint8_t* p = data;
+    size_t i = 0;
+
+    // Each 16-byte load covers four samples plus four bytes of the next, so
+    // stop while two spare samples remain
+    for (; i + 10 <= count; i += 8, p += 24) {
+        s0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)p), unpack);
+        s1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 12)), unpack);
+        v = _mm256_inserti128_si256(_mm256_castsi128_si256(s0), s1, 1);
+        v = scaleAvx2(_mm256_srai_epi32(v, 8), g, lo, hi);
+
+        s0 = _mm_shuffle_epi8(_mm256_castsi256_si128(v), repack);
+        s1 = _mm_shuffle_epi8(_mm256_extracti128_si256(v, 1), repack);
+        _mm_storel_epi64((__m128i*)p, s0);
+        tail = _mm_cvtsi128_si32(_mm_srli_si128(s0, 8));
+        memcpy(p + 8, &tail, 4);
+        _mm_storel_epi64((__m128i*)(p + 12), s1);
+        tail = _mm_cvtsi128_si32(_mm_srli_si128(s1, 8));
+        memcpy(p + 20, &tail, 4);
+    }
+    gain24Scalar(p, count - i, gain);
+}
+
+static CORAL_TARGET_AVX2 void gain32Avx2(uint8_t* data, size_t count, float gain) {
+    int32_t* samples = (int32_t*)data;
+    __m256 g = _mm256_set1_ps(gain);
+    __m256 limit = _mm256_set1_ps(2147483648.0f);
+    __m256i maxValue = _mm256_set1_epi32(INT32_MAX);
+    __m256 scaled;
+    __m256i r;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        scaled = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(samples + i))), g);
+        r = _mm256_cvttps_epi32(scaled);
+        r = _mm256_blendv_epi8(r, maxValue, _mm256_castps_si256(_mm256_cmp_ps(scaled, limit, _CMP_GE_OQ)));
+        _mm256_storeu_si256((__m256i*)(samples + i), r);
+    }
+    gain32Scalar(data + i * 4, count - i, gain);
+}
+
+static CORAL_TARGET_AVX2 __m256i fixedScaleAvx2(__m256i v, __m256i gain) {
+    __m256i lo = _mm256_mullo_epi16(v, gain);
+    __m256i hi = _mm256_mulhi_epi16(v, gain);
+    __m256i a = _mm256_srai_epi32(_mm256_unpacklo_epi16(lo, hi), 8);
+    __m256i b = _mm256_srai_epi32(_mm256_unpackhi_epi16(lo, hi), 8);
+    return _mm256_packs_epi32(a, b);
+}
+
+static CORAL_TARGET_AVX2 void fixedGain8Avx2(uint8_t* data, size_t count, int32_t gain) {
+    __m256i g = _mm256_set1_epi16((short)gain);
+    __m256i zero = _mm256_setzero_si256();
+    __m256i bias = _mm256_set1_epi16(128);
+    __m256i v, a, b;
+    size_t i = 0;
+
+    // Unpack and pack both work per lane, so the byte order round-trips
+    for (; i + 32 <= count; i += 32) {
+        v = _mm256_loadu_si256((const __m256i*)(data + i));
+        a = _mm256_sub_epi16(_mm256_unpacklo_epi8(v, zero), bias);
+        b = _mm256_sub_epi16(_mm256_unpackhi_epi8(v, zero), bias);
+        a = _mm256_adds_epi16(fixedScaleAvx2(a, g), bias);
+        b = _mm256_adds_epi16(fixedScaleAvx2(b, g), bias);
+        _mm256_storeu_si256((__m256i*)(data + i), _mm256_packus_epi16(a, b));
+    }
+    fixedGain8Scalar(data + i, count - i, gain);
+}
+
+static CORAL_TARGET_AVX2 void fixedGain16Avx2(uint8_t* data, size_t count, int32_t gain) {
+    int16_t* samples = (int16_t*)data;
+    __m256i g = _mm256_set1_epi16((short)gain);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(samples + i));
+        _mm256_storeu_si256((__m256i*)(samples + i), fixedScaleAvx2(v, g));
+    }
+    fixedGain16Scalar(data + i * 2, count - i, gain);
+}
+
+static CORAL_TARGET_AVX2 void gainFloatAvx2(uint8_t* data, size_t count, float gain) {
+    float* samples = (float*)data;
+    __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), g));
+    }
+    gainFloatScalar(data + i * 4, count - i, gain);
+}
+
+static const GainKernels avx2Kernels = {
+    { gain8Avx2, gain16Avx2, gain24Avx2, gain32Avx2 },
+    { fixedGain8Avx2, fixedGain16Avx2, fixedGain24Scalar, fixedGain32Scalar },
+    gainFloatAvx2
+};
+#endif
+#endif
+
+#ifdef CORAL_ARCH_NEON
+static int32x4_t scaleNeon(int32x4_t v, float32x4_t gain, float32x4_t lo, float32x4_t hi) {
+    float32x4_t scaled = vmulq_f32(vcvtq_f32_s32(v), gain);
+    return vcvtq_s32_f32(vminq_f32(vmaxq_f32(scaled, lo), hi));
+}
+
+static void gain8Neon(uint8_t* data, size_t count, float gain) {
+    float32x4_t g = vdupq_n_f32(gain);
+    float32x4_t lo = vdupq_n_f32(-128.0f);
+    float32x4_t hi = vdupq_n_f32(127.0f);
+    int16x8_t bias = vdupq_n_s16(128);
+    int16x8_t w;
+    int32x4_t a, b;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        w = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(data + i))), bias);
+        a = scaleNeon(vmovl_s16(vget_low_s16(w)), g, lo, hi);
+        b = scaleNeon(vmovl_s16(vget_high_s16(w)), g, lo, hi);
+        w = vaddq_s16(vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)), bias);
+        vst1_u8(data + i, vqmovun_s16(w));
+    }
+    gain8Scalar(data + i, count - i, gain);
+}
+
+static void gain16Neon(uint8_t* data, size_t count, float gain) {
+    int16_t* samples = (int16_t*)data;
+    float32x4_t g = vdupq_n_f32(gain);
+    float32x4_t lo = vdupq_n_f32(-32768.0f);
+    float32x4_t hi = vdupq_n_f32(32767.0f);
+    int16x8_t v;
+    int32x4_t a, b;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        v = vld1q_s16(samples + i);
+        a = scaleNeon(vmovl_s16(vget_low_s16(v)), g, lo, hi);
+        b = scaleNeon(vmovl_s16(vget_high_s16(v)), g, lo, hi);
+        vst1q_s16(samples + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+    gain16Scalar(data + i * 2, count - i, gain);
+}
+
+static void gain24Neon(uint8_t* data, size_t count, float gain) {
+    float32x4_t g = vdupq_n_f32(gain);
+    float32x4_t lo = vdupq_n_f32(-8388608.0f);
+    float32x4_t hi = vdupq_n_f32(8388607.0f);
+    int32_t in[4];
+    int32_t out[4];
+    uint8_t* p = data;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4, p += 12) {
+        in[0] = load24(p);
+        in[1] = load24(p + 3);
+        in[2] = load24(p + 6);
+        in[3] = load24(p + 9);
+        vst1q_s32(out, scaleNeon(vld1q_s32(in), g, lo, hi));
+        store24(p, out[0]);
+        store24(p + 3, out[1]);
+        store24(p + 6, out[2]);
+        store24(p + 9, out[3]);
+    }
+    gain24Scalar(p, count - i, gain);
+}
+
+static void gain32Neon(uint8_t* data, size_t count, float gain) {
+    int32_t* samples = (int32_t*)data;
+    float32x4_t g = vdupq_n_f32(gain);
+    size_t i = 0;
+
+    // vcvtq_s32_f32 saturates, which matches the scalar clamp exactly
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t scaled = vmulq_f32(vcvtq_f32_s32(vld1q_s32(samples + i)), g);
+        vst1q_s32(samples + i, vcvtq_s32_f32(scaled));
+    }
+    gain32Scalar(data + i * 4, count - i, gain);
+}
+
+static int16x8_t fixedScaleNeon(int16x8_t v, int16x4_t gain) {
+    int32x4_t a = vshrq_n_s32(vmull_s16(vget_low_s16(v), gain), 8);
+    int32x4_t b = vshrq_n_s32(vmull_s16(vget_high_s16(v), gain), 8);
+    return vcombine_s16(vqmovn_s32(a), vqmovn_s32(b));
+}
+
+static void fixedGain8Neon(uint8_t* data, size_t count, int32_t gain) {
+    int16x4_t g = vdup_n_s16((int16_t)gain);
+    int16x8_t bias = vdupq_n_s16(128);
+    int16x8_t w;
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        w = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(data + i))), bias);
+        w = vqaddq_s16(fixedScaleNeon(w, g), bias);
+        vst1_u8(data + i, vqmovun_s16(w));
+    }
+    fixedGain8Scalar(data + i, count - i, gain);
+}
+
+static void fixedGain16Neon(uint8_t* data, size_t count, int32_t gain) {
+    int16_t* samples = (int16_t*)data;
+    int16x4_t g = vdup_n_s16((int16_t)gain);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        vst1q_s16(samples + i, fixedScaleNeon(vld1q_s16(samples + i), g));
+    }
+    fixedGain16Scalar(data + i * 2, count - i, gain);
+}
+
+static void gainFloatNeon(uint8_t* data, size_t count, float gain) {
+    float* samples = (float*)data;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(samples + i, vmulq_n_f32(vld1q_f32(samples + i), gain));
+    }
+    gainFloatScalar(data + i * 4, count - i, gain);
+}
+
+static const GainKernels neonKernels = {
+    { gain8Neon, gain16Neon, gain24Neon, gain32Neon },
+    { fixedGain8Neon, fixedGain16Neon, fixedGain24Scalar, fixedGain32Scalar },
+    gainFloatNeon
+};
+#endif
+
+static const GainKernels* selectKernels(void) {
+    switch (coralGetSimdLevel()) {
+#ifdef CORAL_ARCH_X86
+#ifdef CORAL_HAVE_AVX2
+    case CORAL_SIMD_AVX2: return &avx2Kernels;
+#endif
+    case CORAL_SIMD_SSE2: return &sse2Kernels;
+#endif
+#ifdef CORAL_ARCH_NEON
+    case CORAL_SIMD_NEON: return &neonKernels;
+#endif
+    default: return &scalarKernels;
+    }
+}
+
+// Validates the format and returns the number of samples to process
+static bool checkGainFormat(const WavFile* wavFile, size_t* numSamples) {
+    uint16_t bitsPerSample;
+
+    if (!wavFile) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null WAV file pointer");
+        return false;
+    }
+    bitsPerSample = wavFile->wavFormat.bitsPerSample;
+    if (wavFile->wavFormat.audioFormat == WAV_FORMAT_IEEE_FLOAT && bitsPerSample == 32) {
+        *numSamples = (size_t)(coralWavDataSize(wavFile) / 4);
+        return true;
+    }
+    if (wavFile->wavFormat.audioFormat != WAV_FORMAT_PCM) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Volume adjustment only supports PCM and 32-bit float formats");
+        return false;
+    }
+
+    if (bitsPerSample % 8 != 0 || bitsPerSample < 8 || bitsPerSample > 32) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Unsupported bits per sample: %d", bitsPerSample);
+        return false;
+    }
+
+    *numSamples = (size_t)(coralWavDataSize(wavFile) / (bitsPerSample / 8));
+    return true;
+}
+
+bool adjustVolume(WavFile* wavFile, float volumeFactor) {
+    size_t numSamples;
+
+    if (!checkGainFormat(wavFile, &numSamples)) {
+        return false;
+    }
+
+    if (wavFile->wavFormat.audioFormat == WAV_FORMAT_IEEE_FLOAT) {
+        selectKernels()->floatGain(wavFile->data, numSamples, volumeFactor);
+        return true;
+    }
+    selectKernels()->gain[wavFile->wavFormat.bitsPerSample / 8 - 1](wavFile->data, numSamples, volumeFactor);
+    return true;
+}
+
+bool adjustVolumeFixed(WavFile* wavFile, int16_t gain) {
+    size_t numSamples;
+
+    if (!checkGainFormat(wavFile, &numSamples)) {
+        return false;
+    }
+    if (gain < 0) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Fixed-point gain must not be negative");
+        return false;
+    }
+
+    if (wavFile->wavFormat.audioFormat == WAV_FORMAT_IEEE_FLOAT) {
+        selectKernels()->floatGain(wavFile->data, numSamples, (float)gain / 256.0f);
+        return true;
+    }
+    selectKernels()->fixedGain[wavFile->wavFormat.bitsPerSample / 8 - 1](wavFile->data, numSamples, gain);
+    return true;
+}
+
+void coralRampInit(CoralGainRamp* ramp, float gain) {
+    ramp->current = gain;
+    ramp->target = gain;
+    ramp->step = 0.0f;
+    ramp->remaining = 0;
+    ramp->shape = CORAL_RAMP_LINEAR;
+}
+
+void coralRampStart(CoralGainRamp* ramp, float target, uint32_t frames, CoralRampShape shape) {
+    float from;
+    float to;
+
+    ramp->target = target;
+    ramp->shape = shape;
+    ramp->remaining = frames;
+    if (frames == 0) {
+        ramp->current = target;
+        return;
+    }
+
+    if (shape == CORAL_RAMP_EXPONENTIAL) {
+        from = ramp->current > RAMP_FLOOR ? ramp->current : RAMP_FLOOR;
+        to = target > RAMP_FLOOR ? target : RAMP_FLOOR;
+        ramp->current = from;
+        ramp->step = (float)pow((double)to / from, 1.0 / frames);
+    }
+    else {
+        ramp->step = (target - ramp->current) / (float)frames;
+    }
+}
+
+void coralRampApply(CoralGainRamp* ramp, float* samples, size_t frames, uint16_t channels) {
+    size_t ramped = frames < ramp->remaining ? frames : ramp->remaining;
+    size_t f;
+    uint16_t c;
+
+    for (f = 0; f < ramped; ++f) {
+        for (c = 0; c < channels; ++c) {
+            samples[c] *= ramp->current;
+        }
+        samples += channels;
+        if (ramp->shape == CORAL_RAMP_EXPONENTIAL) {
+            ramp->current *= ramp->step;
+        }
+        else {
+            ramp->current += ramp->step;
+        }
+    }
+    ramp->remaining -= (uint32_t)ramped;
+    if (ramp->remaining == 0) {
+        // Land exactly on the target, whatever rounding crept in
+        ramp->current = ramp->target;
+    }
+
+    if (frames > ramped && ramp->current != 1.0f) {
+        selectKernels()->floatGain((uint8_t*)samples, (frames - ramped) * channels, ramp->current);
+    }
+}
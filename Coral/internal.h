@@ -0,0 +1,351 @@
+/*
+@file - internal.h
+@developer - ColorProgrammy
+@brief - Private declarations shared by the library sources.
+@date - 16/10/2026
+@description - Platform selection, threading primitives and the output
+device layer. Not part of the public API; include "wave.h" instead.
+*/
+
+#ifndef CORAL_INTERNAL_H
+#define CORAL_INTERNAL_H
+
+#define _CRT_SECURE_NO_WARNINGS
+#define _FILE_OFFSET_BITS 64
+// POSIX clocks, fseeko and pread stay hidden under a strict -std=c99/c11
+#if !defined(_WIN32) && !defined(__APPLE__) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#define CORAL_DLL_EXPORTS
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define snprintf _snprintf
+#define vsnprintf _vsnprintf
+#endif
+
+#include "wave.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Platform detection
+#if defined(_WIN32)
+#define PLATFORM_WINDOWS
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#elif defined(__linux__)
+#define PLATFORM_LINUX
+#elif defined(__APPLE__)
+#define PLATFORM_MACOS
+#include <CoreAudio/CoreAudio.h>
+#include <AudioToolbox/AudioToolbox.h>
+#endif
+
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)
+#include <pthread.h>
+#endif
+
+// Linux audio backend selection
+#ifdef PLATFORM_LINUX
+#define TRY_PULSE_AUDIO
+
+#define TRY_ALSA
+#if !defined(TRY_PULSE_AUDIO) && !defined(TRY_ALSA)
+#error "Please define either TRY_PULSE_AUDIO or TRY_ALSA for Linux"
+#endif
+
+#ifdef TRY_PULSE_AUDIO
+#include <pulse/simple.h>
+#include <pulse/error.h>
+#endif
+
+#ifdef TRY_ALSA
+#include <alsa/asoundlib.h>
+#endif
+#endif
+
+// Instruction sets with hand-written kernels
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CORAL_ARCH_X86
+#include <emmintrin.h>
+#if !defined(_MSC_VER) || _MSC_VER >= 1700
+#define CORAL_HAVE_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define CORAL_ARCH_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CORAL_TARGET_SSE2 __attribute__((target("sse2")))
+#define CORAL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CORAL_TARGET_SSE2
+#define CORAL_TARGET_AVX2
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Format tags of the fmt chunk
+#define WAV_FORMAT_PCM 1
+#define WAV_FORMAT_IEEE_FLOAT 3
+#define WAV_FORMAT_ALAW 6
+#define WAV_FORMAT_MULAW 7
+#define WAV_FORMAT_IMA_ADPCM 0x11
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+
+// Error reporting (wave.c). Sets the calling thread's error code and message.
+void coralSetError(CoralError code, const char* format, ...);
+
+// 64-bit stdio positions
+#ifdef _MSC_VER
+#define coralSeek _fseeki64
+#define coralTell _ftelli64
+#else
+#define coralSeek fseeko
+#define coralTell ftello
+#endif
+
+// Container parsing (container.c). Reads size bytes at offset; false on a short read.
+typedef bool (*CoralReadAt)(void* source, uint64_t offset, void* buffer, size_t size);
+
+typedef struct {
+    CoralContainer container;
+    uint64_t dataOffset;
+    uint64_t dataSize;          // Clamped to the end of the file
+    bool truncated;             // The data chunk claims more bytes than the file has
+    uint32_t chunkCount;
+    CoralChunkInfo* chunks;     // Optional; receives the first CORAL_MAX_CHUNKS chunks
+} CoralWavLayout;
+
+// Walks the chunks of a RIFF, RF64 or Wave64 file of fileSize bytes. Fills
+// the header fields of wavFile, including dataSize and the loop points.
+bool coralParseWav(CoralReadAt read, void* source, uint64_t fileSize, WavFile* wavFile, CoralWavLayout* layout);
+
+// Reads the headers of a file in any container and leaves it positioned
+// at the first PCM byte. wavFile->data is left untouched.
+bool coralReadWavHeaders(FILE* file, WavFile* wavFile);
+// Bytes of sample data; falls back to the header for files built by hand
+uint64_t coralWavDataSize(const WavFile* wavFile);
+// Resolves the fmt chunk bytes past the first 16. Sets channelMask and
+// validBitsPerSample and reduces WAVE_FORMAT_EXTENSIBLE to its subformat tag.
+bool coralApplyFormatExtension(WavFile* wavFile, const uint8_t* extra, size_t extraSize);
+// Takes the first loop of a smpl chunk payload; at most SAMPLER_CHUNK_BYTES are looked at
+#define SAMPLER_CHUNK_BYTES 60
+void coralApplySamplerChunk(WavFile* wavFile, const uint8_t* payload, size_t size);
+// Drops loop points that do not fit inside the data
+void coralCheckLoop(WavFile* wavFile);
+
+// Threads (thread.c)
+#ifdef PLATFORM_WINDOWS
+typedef HANDLE CoralThread;
+typedef CRITICAL_SECTION CoralMutex;
+typedef CONDITION_VARIABLE CoralCond;
+typedef INIT_ONCE CoralOnce;
+#define CORAL_ONCE_INIT INIT_ONCE_STATIC_INIT
+#else
+typedef pthread_t CoralThread;
+typedef pthread_mutex_t CoralMutex;
+typedef pthread_cond_t CoralCond;
+typedef pthread_once_t CoralOnce;
+#define CORAL_ONCE_INIT PTHREAD_ONCE_INIT
+#endif
+
+typedef void (*CoralThreadFunc)(void* arg);
+
+bool coralThreadStart(CoralThread* thread, CoralThreadFunc func, void* arg);
+void coralThreadJoin(CoralThread thread);
+
+void coralMutexInit(CoralMutex* mutex);
+void coralMutexDestroy(CoralMutex* mutex);
+void coralMutexLock(CoralMutex* mutex);
+void coralMutexUnlock(CoralMutex* mutex);
+
+void coralCondInit(CoralCond* cond);
+void coralCondDestroy(CoralCond* cond);
+void coralCondWait(CoralCond* cond, CoralMutex* mutex);
+void coralCondSignal(CoralCond* cond);
+void coralCondBroadcast(CoralCond* cond);
+// Returns false on timeout
+bool coralCondWaitTimeout(CoralCond* cond, CoralMutex* mutex, uint32_t milliseconds);
+
+void coralCallOnce(CoralOnce* once, void (*func)(void));
+// Raises the calling thread to realtime scheduling; false if not permitted
+bool coralThreadSetRealtime(void);
+void coralSleepMs(uint32_t milliseconds);
+
+// Word-sized atomics: loads acquire, stores release
+size_t coralAtomicLoad(const volatile size_t* value);
+void coralAtomicStore(volatile size_t* value, size_t newValue);
+// Returns the new value; ordered both ways, for reference counts
+size_t coralAtomicAdd(volatile size_t* value, size_t amount);
+// 64-bit counters; relaxed, for statistics only
+void coralAtomicAdd64(volatile uint64_t* value, uint64_t amount);
+uint64_t coralAtomicLoad64(const volatile uint64_t* value);
+void coralAtomicStore64(volatile uint64_t* value, uint64_t newValue);
+void coralAtomicMax64(volatile uint64_t* value, uint64_t candidate);
+
+// Monotonic clock in nanoseconds
+uint64_t coralTimeNs(void);
+
+// Online processors, at least 1 (cpu.c)
+uint32_t coralCpuCount(void);
+
+// Instrumentation (stats.c)
+typedef enum {
+    CORAL_COUNT_FILES_LOADED = 0,
+    CORAL_COUNT_LOAD_FAILURES,
+    CORAL_COUNT_BYTES_READ,
+    CORAL_COUNT_BYTES_MAPPED,
+    CORAL_COUNT_BYTES_WRITTEN,
+    CORAL_COUNT_XRUNS,
+    CORAL_COUNT_RECOVERIES,
+    CORAL_COUNTER_COUNT
+} CoralCounter;
+
+typedef enum {
+    CORAL_TIME_LOAD = 0,
+    CORAL_TIME_PARSE,
+    CORAL_TIME_DEVICE_OPEN,
+    CORAL_TIME_WRITE,
+    CORAL_TIME_DRAIN,
+    CORAL_SIZE_ALLOCATION,
+    CORAL_HISTOGRAM_COUNT
+} CoralHistogramId;
+
+void coralCount(CoralCounter counter, uint64_t amount);
+// Times in nanoseconds, sizes in bytes
+void coralRecord(CoralHistogramId histogram, uint64_t value);
+
+// Memory (memory.c)
+#define CORAL_SAMPLE_ALIGNMENT 64
+
+// WavFile.ownership bits
+#define WAV_OWNS_STRUCT 1           // The struct came from coralAlloc
+#define WAV_OWNS_DATA 2             // data came from coralAllocSamples
+#define WAV_IS_VIEW 4               // Borrows another file's samples; nothing to free
+
+// Go through the allocator set by coralSetAllocator. Sample buffers are
+// pooled by size class and aligned to CORAL_SAMPLE_ALIGNMENT.
+void* coralAllocSamples(size_t size);
+void coralFreeSamples(void* samples);
+void* coralAlloc(size_t size);
+void coralFree(void* pointer, size_t size);
+
+// Output devices (device.c)
+typedef struct CoralDevice CoralDevice;
+
+// Opens the platform output for the given PCM format. Writes block until the
+// device has accepted the data; drain blocks until it has been played.
+CoralDevice* coralDeviceOpen(const WavFormat* format);
+bool coralDeviceWrite(CoralDevice* device, const uint8_t* data, size_t size);
+bool coralDeviceDrain(CoralDevice* device);
+void coralDeviceClose(CoralDevice* device);
+// Makes a drained device ready for new writes
+bool coralDeviceReset(CoralDevice* device);
+// Period the backend granted, or 0 when it runs with its default buffering
+uint32_t coralDevicePeriodFrames(const CoralDevice* device);
+// False once an output setting has changed since the device was opened
+bool coralDeviceCurrent(const CoralDevice* device);
+// Records whether the playback thread got realtime priority
+void coralNoteRealtime(bool granted);
+
+// Device pool (pool.c). Release parks a drained device for reuse by the
+// next acquire with the same format; failed devices should be closed instead.
+CoralDevice* coralDeviceAcquire(const WavFormat* format);
+void coralDeviceRelease(CoralDevice* device, const WavFormat* format);
+// Closes every parked device and joins the janitor thread (coralShutdown)
+void coralDevicePoolShutdown(void);
+
+// Offline render targets (offline.c). When one is selected, devices opened
+// by coralDeviceOpen write into it instead of the sound card.
+bool coralOfflineSelected(void);
+bool coralOfflineOpen(const WavFormat* format);
+bool coralOfflineWrite(const WavFormat* format, const uint8_t* data, size_t size);
+bool coralOfflineDrain(void);
+
+// Sample conversion (convert.c). Float samples are normalized to [-1, 1);
+// encoding to integer formats saturates.
+void coralDecodeToFloat(const uint8_t* src, CoralSampleFormat format, float* dst, size_t count);
+void coralEncodeFromFloat(const float* src, uint8_t* dst, CoralSampleFormat format, size_t count);
+// Maps a WAV format to its sample format; false if there is none
+bool coralSampleFormatOf(const WavFormat* format, CoralSampleFormat* sampleFormat);
+
+// Channel matrix (matrix.c). Number of speakers in a layout mask
+uint16_t coralLayoutChannels(uint32_t layout);
+
+// Effect chains (effects.c). A copy shares the bypass flags and stats of
+// the chain it was made from and holds a reference to it, as does the
+// output while the chain is set; the last reference frees the chain.
+// Nodes can only be added while the owner holds the sole reference.
+CoralEffectChain* coralEffectChainCopy(CoralEffectChain* chain, uint32_t sampleRate, uint16_t channels);
+void coralEffectChainRetain(CoralEffectChain* chain);
+void coralEffectChainRelease(CoralEffectChain* chain);
+// Unsets the output chain if it is this one (device.c)
+void coralClearOutputEffectChain(const CoralEffectChain* chain);
+
+// Compressed payloads (codec.c). A decoder reads frames as float straight
+// from the compressed bytes; IMA ADPCM keeps its last decoded block.
+typedef enum {
+    CORAL_CODEC_NONE,
+    CORAL_CODEC_ALAW,
+    CORAL_CODEC_MULAW,
+    CORAL_CODEC_IMA_ADPCM
+} CoralCodec;
+
+typedef struct {
+    CoralCodec codec;
+    const uint8_t* data;
+    uint64_t dataSize;
+    uint64_t frames;
+    uint16_t channels;
+    uint16_t blockAlign;        // Compressed bytes per block
+    uint32_t blockFrames;       // Frames in a whole block
+    int16_t* block;             // Decoded frames of block blockIndex
+    uint64_t blockIndex;
+} CoralDecoder;
+
+CoralCodec coralCodecOf(const WavFormat* format);
+// Frames in dataSize bytes, counting the samples packed in compressed blocks
+uint64_t coralFrameCount(const WavFormat* format, uint64_t dataSize);
+// Validates the frame layout of a format: the block alignment for PCM and
+// float, the block size for compressed data. extra holds the fmt bytes past the first 16.
+bool coralCheckFormat(const WavFormat* format, const uint8_t* extra, size_t extraSize);
+// The PCM format a file plays in: its own, or S16 for compressed files
+bool coralPlaybackFormat(const WavFormat* format, WavFormat* playback, CoralSampleFormat* sampleFormat);
+// A file without a codec leaves the decoder at CORAL_CODEC_NONE
+bool coralDecoderInit(CoralDecoder* decoder, const WavFile* wavFile);
+// Points the decoder at other bytes of the same format, e.g. a block read from disk
+void coralDecoderSetData(CoralDecoder* decoder, const uint8_t* data, uint64_t dataSize);
+void coralDecoderFree(CoralDecoder* decoder);
+void coralDecoderRead(CoralDecoder* decoder, uint64_t frame, float* dst, size_t frames);
+
+// Gain ramps (gain.c). Frame k of a ramp over n frames plays at the start
+// gain moved k/n of the way to the target; after that the target holds.
+typedef struct {
+    float current;
+    float target;
+    float step;                 // Added (linear) or multiplied (exponential) per frame
+    uint32_t remaining;         // Frames left in the ramp
+    CoralRampShape shape;
+} CoralGainRamp;
+
+void coralRampInit(CoralGainRamp* ramp, float gain);
+void coralRampStart(CoralGainRamp* ramp, float target, uint32_t frames, CoralRampShape shape);
+// Multiplies interleaved float frames by the ramp, advancing it
+void coralRampApply(CoralGainRamp* ramp, float* samples, size_t frames, uint16_t channels);
+
+// Mixer (mixer.c). Renders frames in the mixer format and returns how many
+// of them carried voice data; activeVoices receives the voices still playing.
+size_t coralMixerRenderFrames(CoralMixer* mixer, uint8_t* output, size_t frames, uint32_t* activeVoices);
+const WavFormat* coralMixerFormat(const CoralMixer* mixer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,379 @@
+/*
+@file - matrix.c
+@developer - ColorProgrammy
+@brief - Channel matrix.
+@date - 16/10/2026
+@description - Maps frames of one channel count onto another through a
+coefficient matrix: downmix, upmix and reordering between speaker layouts.
+Layout presets follow the WAVE speaker bits. A speaker the output lacks is
+folded into its neighbours 3 dB down, and the matrix is scaled so no output
+can clip. Outputs up to eight wide are computed a frame at a time in SIMD
+registers, each input sample broadcast against its column of coefficients.
+*/
+
+#include "internal.h"
+
+#define MATRIX_FOLD 0.70710678f     // -3 dB
+#define MATRIX_COLUMN 8             // Column stride: the widest SIMD output
+
+struct CoralChannelMatrix {
+    uint16_t inputs;
+    uint16_t outputs;
+    float* rows;                // outputs x inputs
+    float* columns;             // inputs x MATRIX_COLUMN, zero past outputs
+};
+
+uint16_t coralLayoutChannels(uint32_t layout) {
+    uint16_t count = 0;
+
+    for (; layout; layout &= layout - 1) {
+        count++;
+    }
+    return count;
+}
+
+uint32_t coralDefaultChannelLayout(uint16_t channels) {
+    switch (channels) {
+    case 1: return CORAL_LAYOUT_MONO;
+    case 2: return CORAL_LAYOUT_STEREO;
+    case 3: return CORAL_LAYOUT_STEREO | CORAL_SPEAKER_FRONT_CENTER;
+    case 4: return CORAL_LAYOUT_QUAD;
+    case 5: return CORAL_LAYOUT_QUAD | CORAL_SPEAKER_FRONT_CENTER;
+    case 6: return CORAL_LAYOUT_5_1;
+    case 7: return CORAL_LAYOUT_5_1 | CORAL_SPEAKER_BACK_CENTER;
+    case 8: return CORAL_LAYOUT_7_1;
+    default: return 0;
+    }
+}
+
+CoralChannelMatrix* coralChannelMatrixCreate(uint16_t inputs, uint16_t outputs, const float* coefficients) {
+    CoralChannelMatrix* matrix;
+    uint16_t i;
+    uint16_t o;
+
+    if (inputs == 0 || outputs == 0 || !coefficients) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Invalid channel matrix");
+        return NULL;
+    }
+
+    matrix = (CoralChannelMatrix*)malloc(sizeof(CoralChannelMatrix));
+    if (!matrix) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+    matrix->inputs = inputs;
+    matrix->outputs = outputs;
+    matrix->rows = (float*)malloc((size_t)inputs * outputs * sizeof(float));
+    matrix->columns = (float*)calloc((size_t)inputs * MATRIX_COLUMN, sizeof(float));
+    if (!matrix->rows || !matrix->columns) {
+        coralChannelMatrixDestroy(matrix);
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+
+    memcpy(matrix->rows, coefficients, (size_t)inputs * outputs * sizeof(float));
+    for (i = 0; i < inputs && outputs <= MATRIX_COLUMN; ++i) {
+        for (o = 0; o < outputs; ++o) {
+            matrix->columns[i * MATRIX_COLUMN + o] = coefficients[o * inputs + i];
+        }
+    }
+    return matrix;
+}
+
+// Adds gain to the column of each output speaker that stands in for speaker
+static void routeSpeaker(float* column, uint32_t speaker, float gain, uint32_t outputLayout) {
+    uint32_t pair;
+
+    if (outputLayout & speaker) {
+        column[coralLayoutChannels(outputLayout & (speaker - 1))] += gain;
+        return;
+    }
+
+    switch (speaker) {
+    case CORAL_SPEAKER_FRONT_LEFT:
+    case CORAL_SPEAKER_FRONT_RIGHT:
+        if (outputLayout & CORAL_SPEAKER_FRONT_CENTER) {
+            routeSpeaker(column, CORAL_SPEAKER_FRONT_CENTER, gain * MATRIX_FOLD, outputLayout);
+        }
+        return;
+    case CORAL_SPEAKER_FRONT_CENTER:
+        pair = CORAL_SPEAKER_FRONT_LEFT | CORAL_SPEAKER_FRONT_RIGHT;
+        if ((outputLayout & pair) == pair) {
+            routeSpeaker(column, CORAL_SPEAKER_FRONT_LEFT, gain * MATRIX_FOLD, outputLayout);
+            routeSpeaker(column, CORAL_SPEAKER_FRONT_RIGHT, gain * MATRIX_FOLD, outputLayout);
+        }
+        return;
+    case CORAL_SPEAKER_BACK_LEFT:
+    case CORAL_SPEAKER_SIDE_LEFT:
+        // Backs and sides substitute for each other before folding forward
+        pair = speaker == CORAL_SPEAKER_BACK_LEFT ? CORAL_SPEAKER_SIDE_LEFT : CORAL_SPEAKER_BACK_LEFT;
+        if (outputLayout & pair) {
+            routeSpeaker(column, pair, gain * MATRIX_FOLD, outputLayout);
+        }
+        else {
+            routeSpeaker(column, CORAL_SPEAKER_FRONT_LEFT, gain * MATRIX_FOLD, outputLayout);
+        }
+        return;
+    case CORAL_SPEAKER_BACK_RIGHT:
+    case CORAL_SPEAKER_SIDE_RIGHT:
+        pair = speaker == CORAL_SPEAKER_BACK_RIGHT ? CORAL_SPEAKER_SIDE_RIGHT : CORAL_SPEAKER_BACK_RIGHT;
+        if (outputLayout & pair) {
+            routeSpeaker(column, pair, gain * MATRIX_FOLD, outputLayout);
+        }
+        else {
+            routeSpeaker(column, CORAL_SPEAKER_FRONT_RIGHT, gain * MATRIX_FOLD, outputLayout);
+        }
+        return;
+    case CORAL_SPEAKER_BACK_CENTER:
+        routeSpeaker(column, CORAL_SPEAKER_BACK_LEFT, gain * MATRIX_FOLD, outputLayout);
+        routeSpeaker(column, CORAL_SPEAKER_BACK_RIGHT, gain * MATRIX_FOLD, outputLayout);
+        return;
+    case CORAL_SPEAKER_FRONT_LEFT_OF_CENTER:
+        routeSpeaker(column, CORAL_SPEAKER_FRONT_LEFT, gain * MATRIX_FOLD, outputLayout);
+        return;
+    case CORAL_SPEAKER_FRONT_RIGHT_OF_CENTER:
+        routeSpeaker(column, CORAL_SPEAKER_FRONT_RIGHT, gain * MATRIX_FOLD, outputLayout);
+        return;
+    // Height speakers drop to the one below them
+    case CORAL_SPEAKER_TOP_CENTER:
+    case CORAL_SPEAKER_TOP_FRONT_CENTER:
+        routeSpeaker(column, CORAL_SPEAKER_FRONT_CENTER, gain * MATRIX_FOLD, outputLayout);
+        return;
+    case CORAL_SPEAKER_TOP_FRONT_LEFT:
+        routeSpeaker(column, CORAL_SPEAKER_FRONT_LEFT, gain * MATRIX_FOLD, outputLayout);
+        return;
+    case CORAL_SPEAKER_TOP_FRONT_RIGHT:
+        routeSpeaker(column, CORAL_SPEAKER_FRONT_RIGHT, gain * MATRIX_FOLD, outputLayout);
+        return;
+    case CORAL_SPEAKER_TOP_BACK_LEFT:
+        routeSpeaker(column, CORAL_SPEAKER_BACK_LEFT, gain * MATRIX_FOLD, outputLayout);
+        return;
+    case CORAL_SPEAKER_TOP_BACK_CENTER:
+        routeSpeaker(column, CORAL_SPEAKER_BACK_CENTER, gain * MATRIX_FOLD, outputLayout);
+        return;
+    case CORAL_SPEAKER_TOP_BACK_RIGHT:
+        routeSpeaker(column, CORAL_SPEAKER_BACK_RIGHT, gain * MATRIX_FOLD, outputLayout);
+        return;
+    default:
+        // LFE is left out of a downmix, as are positions without a neighbour
+        return;
+    }
+}
+
+CoralChannelMatrix* coralChannelMatrixCreateLayout(uint32_t inputLayout, uint32_t outputLayout) {
+    CoralChannelMatrix* matrix;
+    uint16_t inputs = coralLayoutChannels(inputLayout);
+    uint16_t outputs = coralLayoutChannels(outputLayout);
+    float* coefficients;
+    float column[32];
+    float largest = 0.0f;
+    float sum;
+    uint32_t speaker;
+    uint16_t i = 0;
+    uint16_t o;
+    size_t k;
+
+    if (inputs == 0 || outputs == 0) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Empty channel layout");
+        return NULL;
+    }
+    coefficients = (float*)calloc((size_t)inputs * outputs, sizeof(float));
+    if (!coefficients) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+
+    for (speaker = 1; speaker != 0 && speaker <= inputLayout; speaker <<= 1) {
+        if (!(inputLayout & speaker)) {
+            continue;
+        }
+        memset(column, 0, sizeof(column));
+        routeSpeaker(column, speaker, 1.0f, outputLayout);
+        for (o = 0; o < outputs; ++o) {
+            coefficients[o * inputs + i] = column[o];
+        }
+        i++;
+    }
+
+    // Scale everything by the same amount so the balance between outputs holds
+    for (o = 0; o < outputs; ++o) {
+        sum = 0.0f;
+        for (i = 0; i < inputs; ++i) {
+            sum += coefficients[o * inputs + i];
+        }
+        if (sum > largest) largest = sum;
+    }
+    if (largest > 1.0f) {
+        for (k = 0; k < (size_t)inputs * outputs; ++k) {
+            coefficients[k] /= largest;
+        }
+    }
+
+    matrix = coralChannelMatrixCreate(inputs, outputs, coefficients);
+    free(coefficients);
+    return matrix;
+}
+
+void coralChannelMatrixDestroy(CoralChannelMatrix* matrix) {
+    if (!matrix) {
+        return;
+    }
+    free(matrix->rows);
+    free(matrix->columns);
+    free(matrix);
+}
+
+uint16_t coralChannelMatrixInputs(const CoralChannelMatrix* matrix) {
+    return matrix ? matrix->inputs : 0;
+}
+
+uint16_t coralChannelMatrixOutputs(const CoralChannelMatrix* matrix) {
+    return matrix ? matrix->outputs : 0;
+}
+
+static void processScalar(const CoralChannelMatrix* matrix, const float* src, float* dst, size_t frames) {
+    const float* row;
+    float sum;
+    size_t f;
+    uint16_t i;
+    uint16_t o;
+
+    for (f = 0; f < frames; ++f, src += matrix->inputs, dst += matrix->outputs) {
+        for (o = 0, row = matrix->rows; o < matrix->outputs; ++o, row += matrix->inputs) {
+            sum = 0.0f;
+            for (i = 0; i < matrix->inputs; ++i) {
+                sum += row[i] * src[i];
+            }
+            dst[o] = sum;
+        }
+    }
+}
+
+// The vector kernels store a whole register per frame. Lanes past the
+// outputs spill into the next frame, which overwrites them, so only the
+// frames whose store would run off the end are left to the scalar loop.
+static size_t vectorFrames(const CoralChannelMatrix* matrix, size_t frames, size_t width) {
+    size_t total = frames * matrix->outputs;
+    return total < width ? 0 : (total - width) / matrix->outputs + 1;
+}
+
+#ifdef CORAL_ARCH_X86
+static CORAL_TARGET_SSE2 void processSse2(const CoralChannelMatrix* matrix, const float* src, float* dst, size_t frames) {
+    const float* column;
+    size_t count = vectorFrames(matrix, frames, matrix->outputs <= 4 ? 4 : 8);
+    size_t f;
+    uint16_t i;
+    __m128 s;
+    __m128 lo;
+    __m128 hi;
+
+    for (f = 0; f < count && matrix->outputs <= 4; ++f, src += matrix->inputs, dst += matrix->outputs) {
+        column = matrix->columns;
+        lo = _mm_mul_ps(_mm_set1_ps(src[0]), _mm_loadu_ps(column));
+        for (i = 1; i < matrix->inputs; ++i) {
+            column += MATRIX_COLUMN;
+            lo = _mm_add_ps(lo, _mm_mul_ps(_mm_set1_ps(src[i]), _mm_loadu_ps(column)));
+        }
+        _mm_storeu_ps(dst, lo);
+    }
+    for (; f < count; ++f, src += matrix->inputs, dst += matrix->outputs) {
+        column = matrix->columns;
+        s = _mm_set1_ps(src[0]);
+        lo = _mm_mul_ps(s, _mm_loadu_ps(column));
+        hi = _mm_mul_ps(s, _mm_loadu_ps(column + 4));
+        for (i = 1; i < matrix->inputs; ++i) {
+            column += MATRIX_COLUMN;
+            s = _mm_set1_ps(src[i]);
+            lo = _mm_add_ps(lo, _mm_mul_ps(s, _mm_loadu_ps(column)));
+            hi = _mm_add_ps(hi, _mm_mul_ps(s, _mm_loadu_ps(column + 4)));
+        }
+        _mm_storeu_ps(dst, lo);
+        _mm_storeu_ps(dst + 4, hi);
+    }
+    processScalar(matrix, src, dst, frames - count);
+}
+
+#ifdef CORAL_HAVE_AVX2
+static CORAL_TARGET_AVX2 void processAvx2(const CoralChannelMatrix* matrix, const float* src, float* dst, size_t frames) {
+    const float* column;
+    size_t count = vectorFrames(matrix, frames, 8);
+    size_t f;
+    uint16_t i;
+    __m256 acc;
+
+    for (f = 0; f < count; ++f, src += matrix->inputs, dst += matrix->outputs) {
+        column = matrix->columns;
+        acc = _mm256_mul_ps(_mm256_broadcast_ss(src), _mm256_loadu_ps(column));
+        for (i = 1; i < matrix->inputs; ++i) {
+            column += MATRIX_COLUMN;
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_broadcast_ss(src + i), _mm256_loadu_ps(column)));
+        }
+        _mm256_storeu_ps(dst, acc);
+    }
+    processScalar(matrix, src, dst, frames - count);
+}
+#endif
+#endif
+
+#ifdef CORAL_ARCH_NEON
+static void processNeon(const CoralChannelMatrix* matrix, const float* src, float* dst, size_t frames) {
+    const float* column;
+    size_t count = vectorFrames(matrix, frames, matrix->outputs <= 4 ? 4 : 8);
+    size_t f;
+    uint16_t i;
+    float32x4_t lo;
+    float32x4_t hi;
+
+    for (f = 0; f < count && matrix->outputs <= 4; ++f, src += matrix->inputs, dst += matrix->outputs) {
+        column = matrix->columns;
+        lo = vmulq_n_f32(vld1q_f32(column), src[0]);
+        for (i = 1; i < matrix->inputs; ++i) {
+            column += MATRIX_COLUMN;
+            lo = vmlaq_n_f32(lo, vld1q_f32(column), src[i]);
+        }
+        vst1q_f32(dst, lo);
+    }
+    for (; f < count; ++f, src += matrix->inputs, dst += matrix->outputs) {
+        column = matrix->columns;
+        lo = vmulq_n_f32(vld1q_f32(column), src[0]);
+        hi = vmulq_n_f32(vld1q_f32(column + 4), src[0]);
+        for (i = 1; i < matrix->inputs; ++i) {
+            column += MATRIX_COLUMN;
+            lo = vmlaq_n_f32(lo, vld1q_f32(column), src[i]);
+            hi = vmlaq_n_f32(hi, vld1q_f32(column + 4), src[i]);
+        }
+        vst1q_f32(dst, lo);
+        vst1q_f32(dst + 4, hi);
+    }
+    processScalar(matrix, src, dst, frames - count);
+}
+#endif
+
+void coralChannelMatrixProcess(const CoralChannelMatrix* matrix, const float* input, float* output, size_t frames) {
+    if (!matrix || !input || !output) {
+        return;
+    }
+    if (matrix->outputs > MATRIX_COLUMN) {
+        processScalar(matrix, input, output, frames);
+        return;
+    }
+
+    switch (coralGetSimdLevel()) {
+#ifdef CORAL_ARCH_X86
+#ifdef CORAL_HAVE_AVX2
+    case CORAL_SIMD_AVX2:
+        if (matrix->outputs > 4) {
+            processAvx2(matrix, input, output, frames);
+            return;
+        }
+        processSse2(matrix, input, output, frames);
+        return;
+#endif
+    case CORAL_SIMD_SSE2: processSse2(matrix, input, output, frames); return;
+#endif
+#ifdef CORAL_ARCH_NEON
+    case CORAL_SIMD_NEON: processNeon(matrix, input, output, frames); return;
+#endif
+    default: processScalar(matrix, input, output, frames); return;
+    }
+}
@@ -0,0 +1,255 @@
+/*
+@file - memory.c
+@developer - ColorProgrammy
+@brief - Allocator hook and sample buffer pool.
+@date - 16/10/2026
+@description - WavFile structs and sample buffers come from a replaceable
+allocator. Sample buffers are 64-byte aligned and rounded up to size
+classes four to an octave, so a freed buffer can serve the next load of a
+similar size; freed buffers are kept per class up to a byte budget instead
+of going back to the heap.
+*/
+
+#include "internal.h"
+
+#ifdef PLATFORM_WINDOWS
+#include <malloc.h>
+#endif
+
+#define POOL_MIN_SHIFT 8            // Smallest class is 256 bytes
+#define POOL_MAX_SHIFT 26           // Buffers over 64 MiB are never pooled
+#define POOL_CLASS_COUNT ((POOL_MAX_SHIFT - POOL_MIN_SHIFT) * 4 + 1)
+#define POOL_NO_CLASS 0xFFFFFFFFu
+#define POOL_DEFAULT_BUDGET (32u * 1024 * 1024)
+
+// Sits in the 64 bytes in front of every sample buffer
+typedef struct SampleHeader {
+    size_t capacity;                // Usable bytes after the header
+    uint32_t classIndex;
+    struct SampleHeader* next;      // Free list link while pooled
+} SampleHeader;
+
+static void* defaultAllocate(size_t size, size_t alignment, void* userData) {
+    void* pointer;
+
+    (void)userData;
+#ifdef PLATFORM_WINDOWS
+    pointer = _aligned_malloc(size, alignment);
+#else
+    if (posix_memalign(&pointer, alignment < sizeof(void*) ? sizeof(void*) : alignment, size) != 0) {
+        pointer = NULL;
+    }
+#endif
+    return pointer;
+}
+
+static void defaultRelease(void* pointer, size_t size, void* userData) {
+    (void)size;
+    (void)userData;
+#ifdef PLATFORM_WINDOWS
+    _aligned_free(pointer);
+#else
+    free(pointer);
+#endif
+}
+
+static struct {
+    CoralMutex mutex;
+    CoralAllocator allocator;
+    size_t outstanding;             // Blocks obtained from the allocator and not yet returned
+    SampleHeader* freeLists[POOL_CLASS_COUNT];
+    CoralSamplePoolStats stats;
+} memory;
+
+static CoralOnce memoryOnce = CORAL_ONCE_INIT;
+
+static void memoryInit(void) {
+    coralMutexInit(&memory.mutex);
+    memory.allocator.allocate = defaultAllocate;
+    memory.allocator.release = defaultRelease;
+    memory.stats.budgetBytes = POOL_DEFAULT_BUDGET;
+}
+
+// Called with the mutex held
+static void* allocateBlock(size_t size) {
+    void* pointer = memory.allocator.allocate(size, CORAL_SAMPLE_ALIGNMENT, memory.allocator.userData);
+    if (pointer) {
+        memory.outstanding++;
+    }
+    return pointer;
+}
+
+static void releaseBlock(void* pointer, size_t size) {
+    memory.allocator.release(pointer, size, memory.allocator.userData);
+    memory.outstanding--;
+}
+
+// Maps a size to the smallest class holding it; classes step by a quarter octave
+static uint32_t classFor(size_t size, size_t* capacity) {
+    uint32_t shift = POOL_MIN_SHIFT;
+    size_t sub;
+
+    if (size <= ((size_t)1 << POOL_MIN_SHIFT)) {
+        *capacity = (size_t)1 << POOL_MIN_SHIFT;
+        return 0;
+    }
+    while (shift < POOL_MAX_SHIFT && ((size - 1) >> shift) != 0) {
+        shift++;
+    }
+    if (((size - 1) >> shift) != 0) {
+        // Too big to pool; keep the allocation tight
+        *capacity = (size + CORAL_SAMPLE_ALIGNMENT - 1) & ~(size_t)(CORAL_SAMPLE_ALIGNMENT - 1);
+        return POOL_NO_CLASS;
+    }
+    // size - 1 has its top bit at shift - 1; the next two bits pick the quarter
+    sub = ((size - 1) >> (shift - 3)) & 3;
+    *capacity = (5 + sub) << (shift - 3);
+    return (shift - 1 - POOL_MIN_SHIFT) * 4 + (uint32_t)sub + 1;
+}
+
+void* coralAllocSamples(size_t size) {
+    SampleHeader* header;
+    size_t capacity;
+    uint32_t index;
+
+    coralCallOnce(&memoryOnce, memoryInit);
+    index = classFor(size, &capacity);
+
+    coralMutexLock(&memory.mutex);
+    memory.stats.allocations++;
+    header = index != POOL_NO_CLASS ? memory.freeLists[index] : NULL;
+    if (header) {
+        memory.freeLists[index] = header->next;
+        memory.stats.pooledBytes -= capacity;
+        memory.stats.poolHits++;
+    }
+    else {
+        header = (SampleHeader*)allocateBlock(CORAL_SAMPLE_ALIGNMENT + capacity);
+    }
+    if (header) {
+        memory.stats.liveBytes += capacity;
+    }
+    coralMutexUnlock(&memory.mutex);
+
+    if (!header) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed for audio data");
+        return NULL;
+    }
+    header->capacity = capacity;
+    header->classIndex = index;
+    coralRecord(CORAL_SIZE_ALLOCATION, size);
+    return (uint8_t*)header + CORAL_SAMPLE_ALIGNMENT;
+}
+
+void coralFreeSamples(void* samples) {
+    SampleHeader* header;
+
+    if (!samples) {
+        return;
+    }
+    header = (SampleHeader*)((uint8_t*)samples - CORAL_SAMPLE_ALIGNMENT);
+
+    coralMutexLock(&memory.mutex);
+    memory.stats.liveBytes -= header->capacity;
+    if (header->classIndex != POOL_NO_CLASS &&
+        memory.stats.pooledBytes + header->capacity <= memory.stats.budgetBytes) {
+        header->next = memory.freeLists[header->classIndex];
+        memory.freeLists[header->classIndex] = header;
+        memory.stats.pooledBytes += header->capacity;
+    }
+    else {
+        releaseBlock(header, CORAL_SAMPLE_ALIGNMENT + header->capacity);
+    }
+    coralMutexUnlock(&memory.mutex);
+}
+
+void* coralAlloc(size_t size) {
+    void* pointer;
+
+    coralCallOnce(&memoryOnce, memoryInit);
+    coralMutexLock(&memory.mutex);
+    pointer = allocateBlock(size);
+    coralMutexUnlock(&memory.mutex);
+    if (!pointer) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+    }
+    return pointer;
+}
+
+void coralFree(void* pointer, size_t size) {
+    if (!pointer) {
+        return;
+    }
+    coralMutexLock(&memory.mutex);
+    releaseBlock(pointer, size);
+    coralMutexUnlock(&memory.mutex);
+}
+
+// Empties the free lists until at most keep bytes stay pooled. Called with the mutex held.
+static void trimPool(size_t keep) {
+    SampleHeader* header;
+    uint32_t i;
+
+    // Largest classes first, since they free the most per block
+    for (i = POOL_CLASS_COUNT; i-- > 0 && memory.stats.pooledBytes > keep;) {
+        while (memory.freeLists[i] && memory.stats.pooledBytes > keep) {
+            header = memory.freeLists[i];
+            memory.freeLists[i] = header->next;
+            memory.stats.pooledBytes -= header->capacity;
+            releaseBlock(header, CORAL_SAMPLE_ALIGNMENT + header->capacity);
+        }
+    }
+}
+
+bool coralSetAllocator(const CoralAllocator* allocator) {
+    if (allocator && (!allocator->allocate || !allocator->release)) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Allocator needs both functions");
+        return false;
+    }
+
+    coralCallOnce(&memoryOnce, memoryInit);
+    coralMutexLock(&memory.mutex);
+    trimPool(0);
+    // Blocks must go back to the allocator that made them
+    if (memory.outstanding > 0) {
+        coralMutexUnlock(&memory.mutex);
+        coralSetError(CORAL_ERROR_BUSY, "Cannot change the allocator while %lu blocks are in use",
+            (unsigned long)memory.outstanding);
+        return false;
+    }
+    if (allocator) {
+        memory.allocator = *allocator;
+    }
+    else {
+        memory.allocator.allocate = defaultAllocate;
+        memory.allocator.release = defaultRelease;
+        memory.allocator.userData = NULL;
+    }
+    coralMutexUnlock(&memory.mutex);
+    return true;
+}
+
+void coralSetSamplePoolBudget(size_t bytes) {
+    coralCallOnce(&memoryOnce, memoryInit);
+    coralMutexLock(&memory.mutex);
+    memory.stats.budgetBytes = bytes;
+    trimPool(bytes);
+    coralMutexUnlock(&memory.mutex);
+}
+
+void coralFlushSamplePool(void) {
+    coralCallOnce(&memoryOnce, memoryInit);
+    coralMutexLock(&memory.mutex);
+    trimPool(0);
+    coralMutexUnlock(&memory.mutex);
+}
+
+void coralGetSamplePoolStats(CoralSamplePoolStats* stats) {
+    if (!stats) {
+        return;
+    }
+    coralCallOnce(&memoryOnce, memoryInit);
+    coralMutexLock(&memory.mutex);
+    *stats = memory.stats;
+    coralMutexUnlock(&memory.mutex);
+}
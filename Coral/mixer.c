@@ -0,0 +1,664 @@
+/*
+@file - mixer.c
+@developer - ColorProgrammy
+@brief - Software mixer.
+@date - 16/10/2026
+@description - Sums any number of voices, each with its own gain and pan,
+into one output stream. Voices are accumulated in float and saturated once
+when the block is converted to the output format.
+*/
+
+#include "internal.h"
+#include <math.h>
+
+#define MIXER_BLOCK_FRAMES 1024
+#define MIXER_PI 3.14159265358979f
+
+typedef struct {
+    uint16_t generation;
+    bool active;
+    const uint8_t* data;
+    size_t frames;
+    size_t position;
+    size_t loopStart;           // The file's loop, or the whole file, until coralMixerLoopVoice
+    size_t loopEnd;
+    uint32_t repeats;           // Jumps back to loopStart still to make
+    uint16_t channels;
+    CoralSampleFormat sampleFormat;
+    uint16_t blockAlign;
+    CoralDecoder decoder;       // Compressed voices decode from data as they play
+    float gain;
+    float pan;
+    CoralGainRamp ramp;         // While it runs, gain is applied per frame and left out of the pattern
+    float pattern[8];           // Per-sample gains, repeated to the SIMD width
+    float left;                 // Mono-to-stereo gains
+    float right;
+} MixerVoice;
+
+struct CoralMixer {
+    WavFormat format;
+    CoralSampleFormat sampleFormat;
+    CoralMutex mutex;
+    MixerVoice* voices;
+    uint32_t capacity;
+    uint32_t activeCount;
+    float* accum;
+    float* scratch;
+};
+
+// Adds src * pattern to acc. The pattern period must divide 8, which holds
+// for every layout the mixer builds (uniform gain, or L/R pairs).
+static void accumulateScalar(float* acc, const float* src, size_t count, const float* pattern) {
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        acc[i] += src[i] * pattern[i & 7];
+    }
+}
+
+static void accumulateMonoToStereoScalar(float* acc, const float* src, size_t frames, float left, float right) {
+    size_t i;
+    for (i = 0; i < frames; ++i) {
+        acc[2 * i] += src[i] * left;
+        acc[2 * i + 1] += src[i] * right;
+    }
+}
+
+#ifdef CORAL_ARCH_X86
+static CORAL_TARGET_SSE2 void accumulateSse2(float* acc, const float* src, size_t count, const float* pattern) {
+    __m128 g0 = _mm_loadu_ps(pattern);
+    __m128 g1 = _mm_loadu_ps(pattern + 4);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(src + i), g0)));
+        _mm_storeu_ps(acc + i + 4, _mm_add_ps(_mm_loadu_ps(acc + i + 4), _mm_mul_ps(_mm_loadu_ps(src + i + 4), g1)));
+    }
+    accumulateScalar(acc + i, src + i, count - i, pattern);
+}
+
+static CORAL_TARGET_SSE2 void accumulateMonoToStereoSse2(float* acc, const float* src, size_t frames, float left, float right) {
+    __m128 g = _mm_setr_ps(left, right, left, right);
+    __m128 s;
+    size_t i = 0;
+
+    for (; i + 4 <= frames; i += 4) {
+        s = _mm_loadu_ps(src + i);
+        _mm_storeu_ps(acc + 2 * i, _mm_add_ps(_mm_loadu_ps(acc + 2 * i), _mm_mul_ps(_mm_unpacklo_ps(s, s), g)));
+        _mm_storeu_ps(acc + 2 * i + 4, _mm_add_ps(_mm_loadu_ps(acc + 2 * i + 4), _mm_mul_ps(_mm_unpackhi_ps(s, s), g)));
+    }
+    accumulateMonoToStereoScalar(acc + 2 * i, src + i, frames - i, left, right);
+}
+
+#ifdef CORAL_HAVE_AVX2
+static CORAL_TARGET_AVX2 void accumulateAvx2(float* acc, const float* src, size_t count, const float* pattern) {
+    __m256 g = _mm256_loadu_ps(pattern);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), g)));
+        _mm256_storeu_ps(acc + i + 8, _mm256_add_ps(_mm256_loadu_ps(acc + i + 8), _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), g)));
+    }
+    accumulateScalar(acc + i, src + i, count - i, pattern);
+}
+#endif
+#endif
+
+#ifdef CORAL_ARCH_NEON
+static void accumulateNeon(float* acc, const float* src, size_t count, const float* pattern) {
+    float32x4_t g0 = vld1q_f32(pattern);
+    float32x4_t g1 = vld1q_f32(pattern + 4);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        vst1q_f32(acc + i, vmlaq_f32(vld1q_f32(acc + i), vld1q_f32(src + i), g0));
+        vst1q_f32(acc + i + 4, vmlaq_f32(vld1q_f32(acc + i + 4), vld1q_f32(src + i + 4), g1));
+    }
+    accumulateScalar(acc + i, src + i, count - i, pattern);
+}
+
+static void accumulateMonoToStereoNeon(float* acc, const float* src, size_t frames, float left, float right) {
+    float gains[4];
+    float32x4_t g;
+    float32x4x2_t pairs;
+    float32x4_t s;
+    size_t i = 0;
+
+    gains[0] = left;
+    gains[1] = right;
+    gains[2] = left;
+    gains[3] = right;
+    g = vld1q_f32(gains);
+
+    for (; i + 4 <= frames; i += 4) {
+        s = vld1q_f32(src + i);
+        pairs = vzipq_f32(s, s);
+        vst1q_f32(acc + 2 * i, vmlaq_f32(vld1q_f32(acc + 2 * i), pairs.val[0], g));
+        vst1q_f32(acc + 2 * i + 4, vmlaq_f32(vld1q_f32(acc + 2 * i + 4), pairs.val[1], g));
+    }
+    accumulateMonoToStereoScalar(acc + 2 * i, src + i, frames - i, left, right);
+}
+#endif
+
+static void accumulate(float* acc, const float* src, size_t count, const float* pattern) {
+    switch (coralGetSimdLevel()) {
+#ifdef CORAL_ARCH_X86
+#ifdef CORAL_HAVE_AVX2
+    case CORAL_SIMD_AVX2: accumulateAvx2(acc, src, count, pattern); return;
+#endif
+    case CORAL_SIMD_SSE2: accumulateSse2(acc, src, count, pattern); return;
+#endif
+#ifdef CORAL_ARCH_NEON
+    case CORAL_SIMD_NEON: accumulateNeon(acc, src, count, pattern); return;
+#endif
+    default: accumulateScalar(acc, src, count, pattern); return;
+    }
+}
+
+static void accumulateMonoToStereo(float* acc, const float* src, size_t frames, float left, float right) {
+    switch (coralGetSimdLevel()) {
+#ifdef CORAL_ARCH_X86
+    case CORAL_SIMD_AVX2:
+    case CORAL_SIMD_SSE2: accumulateMonoToStereoSse2(acc, src, frames, left, right); return;
+#endif
+#ifdef CORAL_ARCH_NEON
+    case CORAL_SIMD_NEON: accumulateMonoToStereoNeon(acc, src, frames, left, right); return;
+#endif
+    default: accumulateMonoToStereoScalar(acc, src, frames, left, right); return;
+    }
+}
+
+// Stereo voices use pan as a balance control, so centre is unity on both
+// sides. Mono voices on a stereo mix use a constant-power pan law.
+static void updateVoiceGains(MixerVoice* voice, uint16_t outChannels) {
+    float gain = voice->ramp.remaining > 0 ? 1.0f : voice->gain;
+    float left = gain;
+    float right = gain;
+    float angle;
+    int i;
+
+    if (voice->channels == 1 && outChannels == 2) {
+        angle = (voice->pan + 1.0f) * (MIXER_PI / 4.0f);
+        left = gain * (float)cos(angle);
+        right = gain * (float)sin(angle);
+    }
+    else if (voice->channels == 2) {
+        if (voice->pan > 0.0f) left *= 1.0f - voice->pan;
+        if (voice->pan < 0.0f) right *= 1.0f + voice->pan;
+    }
+
+    voice->left = left;
+    voice->right = right;
+    for (i = 0; i < 8; i += 2) {
+        voice->pattern[i] = left;
+        voice->pattern[i + 1] = voice->channels == 2 ? right : left;
+    }
+}
+
+static MixerVoice* lookupVoice(CoralMixer* mixer, CoralVoice voice) {
+    uint32_t index = (voice & 0xFFFF) - 1;
+
+    if (voice == 0 || index >= mixer->capacity ||
+        mixer->voices[index].generation != (uint16_t)(voice >> 16) ||
+        !mixer->voices[index].active) {
+        return NULL;
+    }
+    return &mixer->voices[index];
+}
+
+CoralMixer* coralMixerCreate(uint32_t sampleRate, uint16_t numChannels, CoralSampleFormat format) {
+    CoralMixer* mixer;
+    uint16_t bytesPerSample;
+
+    if (sampleRate == 0 || numChannels == 0) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Invalid mixer format");
+        return NULL;
+    }
+    bytesPerSample = (uint16_t)coralSampleSize(format);
+    if (bytesPerSample == 0 || format == CORAL_SAMPLE_S24_32) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Unsupported mixer sample format: %d", (int)format);
+        return NULL;
+    }
+
+    mixer = (CoralMixer*)malloc(sizeof(CoralMixer));
+    if (!mixer) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+    memset(mixer, 0, sizeof(CoralMixer));
+
+    memcpy(mixer->format.subChunk1ID, "fmt ", 4);
+    mixer->format.subChunk1Size = 16;
+    mixer->format.audioFormat = format == CORAL_SAMPLE_F32 ? WAV_FORMAT_IEEE_FLOAT : WAV_FORMAT_PCM;
+    mixer->format.numChannels = numChannels;
+    mixer->format.sampleRate = sampleRate;
+    mixer->format.bitsPerSample = (uint16_t)(bytesPerSample * 8);
+    mixer->format.blockAlign = (uint16_t)(numChannels * bytesPerSample);
+    mixer->format.byteRate = sampleRate * mixer->format.blockAlign;
+    mixer->sampleFormat = format;
+
+    mixer->accum = (float*)malloc(MIXER_BLOCK_FRAMES * numChannels * sizeof(float));
+    mixer->scratch = (float*)malloc(MIXER_BLOCK_FRAMES * numChannels * sizeof(float));
+    if (!mixer->accum || !mixer->scratch) {
+        free(mixer->accum);
+        free(mixer->scratch);
+        free(mixer);
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+
+    coralMutexInit(&mixer->mutex);
+    return mixer;
+}
+
+void coralMixerDestroy(CoralMixer* mixer) {
+    uint32_t i;
+
+    if (!mixer) {
+        return;
+    }
+    coralMutexDestroy(&mixer->mutex);
+    for (i = 0; i < mixer->capacity; ++i) {
+        coralDecoderFree(&mixer->voices[i].decoder);
+    }
+    free(mixer->voices);
+    free(mixer->accum);
+    free(mixer->scratch);
+    free(mixer);
+}
+
+const WavFormat* coralMixerFormat(const CoralMixer* mixer) {
+    return &mixer->format;
+}
+
+CoralVoice coralMixerAddVoice(CoralMixer* mixer, const WavFile* wavFile, float gain, float pan) {
+    const WavFormat* format;
+    CoralSampleFormat sampleFormat;
+    CoralDecoder decoder;
+    CoralDecoder retired;
+    WavFormat playback;
+    MixerVoice* voices;
+    MixerVoice* voice = NULL;
+    uint32_t capacity;
+    uint32_t i;
+
+    if (!mixer || !wavFile) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null mixer or WAV file pointer");
+        return 0;
+    }
+    format = &wavFile->wavFormat;
+    if (!coralPlaybackFormat(format, &playback, &sampleFormat)) {
+        return 0;
+    }
+    if (format->sampleRate != mixer->format.sampleRate) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Voice sample rate %u does not match mixer rate %u",
+            (unsigned)format->sampleRate, (unsigned)mixer->format.sampleRate);
+        return 0;
+    }
+    if (format->numChannels != mixer->format.numChannels && format->numChannels != 1) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Voice has %d channels; mixer needs mono or %d",
+            format->numChannels, mixer->format.numChannels);
+        return 0;
+    }
+    if (coralCodecOf(format) == CORAL_CODEC_NONE && format->blockAlign != format->numChannels * (format->bitsPerSample / 8)) {
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Invalid block alignment");
+        return 0;
+    }
+    // Set up outside the lock; a slot's old decoder is freed outside it too
+    if (!coralDecoderInit(&decoder, wavFile)) {
+        return 0;
+    }
+
+    coralMutexLock(&mixer->mutex);
+    for (i = 0; i < mixer->capacity; ++i) {
+        if (!mixer->voices[i].active) {
+            voice = &mixer->voices[i];
+            break;
+        }
+    }
+    if (!voice) {
+        capacity = mixer->capacity ? mixer->capacity * 2 : 16;
+        if (capacity > 0xFFFF) capacity = 0xFFFF;
+        voices = capacity > mixer->capacity ?
+            (MixerVoice*)realloc(mixer->voices, capacity * sizeof(MixerVoice)) : NULL;
+        if (!voices) {
+            coralMutexUnlock(&mixer->mutex);
+            coralDecoderFree(&decoder);
+            coralSetError(CORAL_ERROR_BUSY, "Too many mixer voices");
+            return 0;
+        }
+        memset(voices + mixer->capacity, 0, (capacity - mixer->capacity) * sizeof(MixerVoice));
+        mixer->voices = voices;
+        i = mixer->capacity;
+        mixer->capacity = capacity;
+        voice = &mixer->voices[i];
+    }
+
+    retired = voice->decoder;
+    voice->decoder = decoder;
+    voice->generation++;
+    voice->active = true;
+    voice->data = wavFile->data;
+    voice->frames = (size_t)coralFrameCount(format, coralWavDataSize(wavFile));
+    voice->position = 0;
+    voice->loopStart = 0;
+    voice->loopEnd = voice->frames;
+    if (wavFile->loopEnd > wavFile->loopStart && wavFile->loopEnd <= voice->frames) {
+        voice->loopStart = (size_t)wavFile->loopStart;
+        voice->loopEnd = (size_t)wavFile->loopEnd;
+    }
+    voice->repeats = 0;
+    voice->channels = format->numChannels;
+    voice->sampleFormat = sampleFormat;
+    voice->blockAlign = format->blockAlign;
+    voice->gain = gain;
+    voice->pan = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+    coralRampInit(&voice->ramp, gain);
+    updateVoiceGains(voice, mixer->format.numChannels);
+    mixer->activeCount++;
+    coralMutexUnlock(&mixer->mutex);
+    coralDecoderFree(&retired);
+
+    return ((CoralVoice)voice->generation << 16) | (i + 1);
+}
+
+bool coralMixerSetVoice(CoralMixer* mixer, CoralVoice voice, float gain, float pan) {
+    MixerVoice* v;
+
+    if (!mixer) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null mixer pointer");
+        return false;
+    }
+    coralMutexLock(&mixer->mutex);
+    v = lookupVoice(mixer, voice);
+    if (v) {
+        v->gain = gain;
+        v->pan = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+        coralRampInit(&v->ramp, gain);
+        updateVoiceGains(v, mixer->format.numChannels);
+    }
+    coralMutexUnlock(&mixer->mutex);
+
+    if (!v) {
+        coralSetError(CORAL_ERROR_INVALID_HANDLE, "Voice is not playing");
+    }
+    return v != NULL;
+}
+
+bool coralMixerRampVoice(CoralMixer* mixer, CoralVoice voice, float gain, uint32_t frames, CoralRampShape shape) {
+    MixerVoice* v;
+
+    if (!mixer) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null mixer pointer");
+        return false;
+    }
+    if (shape != CORAL_RAMP_LINEAR && shape != CORAL_RAMP_EXPONENTIAL) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Invalid ramp shape: %d", (int)shape);
+        return false;
+    }
+    coralMutexLock(&mixer->mutex);
+    v = lookupVoice(mixer, voice);
+    if (v) {
+        // A ramp already under way continues from wherever it has got to
+        coralRampStart(&v->ramp, gain, frames, shape);
+        v->gain = gain;
+        updateVoiceGains(v, mixer->format.numChannels);
+    }
+    coralMutexUnlock(&mixer->mutex);
+
+    if (!v) {
+        coralSetError(CORAL_ERROR_INVALID_HANDLE, "Voice is not playing");
+    }
+    return v != NULL;
+}
+
+bool coralMixerLoopVoice(CoralMixer* mixer, CoralVoice voice, uint64_t loopStart, uint64_t loopEnd, uint32_t repeats) {
+    MixerVoice* v;
+
+    if (!mixer) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null mixer pointer");
+        return false;
+    }
+
+    coralMutexLock(&mixer->mutex);
+    v = lookupVoice(mixer, voice);
+    if (!v) {
+        coralMutexUnlock(&mixer->mutex);
+        coralSetError(CORAL_ERROR_INVALID_HANDLE, "Voice is not playing");
+        return false;
+    }
+    if (loopStart != 0 || loopEnd != 0) {
+        if (loopStart >= loopEnd || loopEnd > v->frames) {
+            coralMutexUnlock(&mixer->mutex);
+            coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Loop %llu-%llu does not fit the %llu frames of the voice",
+                (unsigned long long)loopStart, (unsigned long long)loopEnd, (unsigned long long)v->frames);
+            return false;
+        }
+        v->loopStart = (size_t)loopStart;
+        v->loopEnd = (size_t)loopEnd;
+    }
+    else if (v->loopStart >= v->loopEnd) {
+        coralMutexUnlock(&mixer->mutex);
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Voice has no frames to loop");
+        return false;
+    }
+    v->repeats = repeats;
+    coralMutexUnlock(&mixer->mutex);
+    return true;
+}
+
+bool coralMixerRemoveVoice(CoralMixer* mixer, CoralVoice voice) {
+    MixerVoice* v;
+
+    if (!mixer) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null mixer pointer");
+        return false;
+    }
+    coralMutexLock(&mixer->mutex);
+    v = lookupVoice(mixer, voice);
+    if (v) {
+        v->active = false;
+        mixer->activeCount--;
+    }
+    coralMutexUnlock(&mixer->mutex);
+
+    if (!v) {
+        coralSetError(CORAL_ERROR_INVALID_HANDLE, "Voice is not playing");
+    }
+    return v != NULL;
+}
+
+bool coralMixerIsVoiceActive(CoralMixer* mixer, CoralVoice voice) {
+    bool active;
+
+    if (!mixer) {
+        return false;
+    }
+    coralMutexLock(&mixer->mutex);
+    active = lookupVoice(mixer, voice) != NULL;
+    coralMutexUnlock(&mixer->mutex);
+    return active;
+}
+
+// Frames the voice plays before it reaches the loop end or the end of its data
+static size_t voiceSpan(const MixerVoice* voice) {
+    if (voice->repeats > 0 && voice->position < voice->loopEnd) {
+        return voice->loopEnd - voice->position;
+    }
+    return voice->frames - voice->position;
+}
+
+// Moves the voice on after a span, jumping back at the loop end, and retires it at the end
+static void advanceVoice(CoralMixer* mixer, MixerVoice* voice, size_t frames) {
+    voice->position += frames;
+    if (voice->repeats > 0 && voice->position == voice->loopEnd) {
+        voice->position = voice->loopStart;
+        if (voice->repeats != CORAL_LOOP_FOREVER) {
+            voice->repeats--;
+        }
+    }
+    else if (voice->position >= voice->frames) {
+        voice->active = false;
+        mixer->activeCount--;
+    }
+}
+
+// Renders up to MIXER_BLOCK_FRAMES frames. Returns how many frames carried
+// voice data; the rest of the block is silence.
+static size_t renderBlock(CoralMixer* mixer, uint8_t* output, size_t frames) {
+    uint16_t channels = mixer->format.numChannels;
+    size_t produced = 0;
+    size_t done;
+    size_t take;
+    MixerVoice* voice;
+    MixerVoice* lone = NULL;
+    bool ramping;
+    uint32_t i;
+    size_t f;
+    uint16_t c;
+
+    for (i = 0; i < mixer->capacity && mixer->activeCount == 1; ++i) {
+        if (mixer->voices[i].active) {
+            lone = &mixer->voices[i];
+            break;
+        }
+    }
+
+    // A single voice already in the output format at unity gain is copied
+    if (lone && lone->channels == channels && lone->sampleFormat == mixer->sampleFormat &&
+        lone->decoder.codec == CORAL_CODEC_NONE &&
+        lone->ramp.remaining == 0 && lone->left == 1.0f && lone->right == 1.0f) {
+        // A loop wrap splices the loop start straight after the loop end
+        for (done = 0; done < frames && lone->active; done += take) {
+            take = voiceSpan(lone);
+            if (take > frames - done) take = frames - done;
+            memcpy(output + done * lone->blockAlign, lone->data + lone->position * lone->blockAlign, take * lone->blockAlign);
+            advanceVoice(mixer, lone, take);
+        }
+        memset(output + done * lone->blockAlign, mixer->format.bitsPerSample == 8 ? 0x80 : 0,
+            (frames - done) * mixer->format.blockAlign);
+        return done;
+    }
+
+    memset(mixer->accum, 0, frames * channels * sizeof(float));
+    for (i = 0; i < mixer->capacity; ++i) {
+        voice = &mixer->voices[i];
+        if (!voice->active) {
+            continue;
+        }
+
+        for (done = 0; done < frames && voice->active; done += take) {
+            take = voiceSpan(voice);
+            if (take > frames - done) take = frames - done;
+            if (voice->decoder.codec != CORAL_CODEC_NONE) {
+                coralDecoderRead(&voice->decoder, voice->position, mixer->scratch, take);
+            }
+            else {
+                coralDecodeToFloat(voice->data + voice->position * voice->blockAlign, voice->sampleFormat,
+                    mixer->scratch, take * voice->channels);
+            }
+            ramping = voice->ramp.remaining > 0;
+            if (ramping) {
+                coralRampApply(&voice->ramp, mixer->scratch, take, voice->channels);
+            }
+
+            if (voice->channels == channels) {
+                accumulate(mixer->accum + done * channels, mixer->scratch, take * channels, voice->pattern);
+            }
+            else if (channels == 2) {
+                accumulateMonoToStereo(mixer->accum + done * 2, mixer->scratch, take, voice->left, voice->right);
+            }
+            else {
+                for (f = 0; f < take; ++f) {
+                    for (c = 0; c < channels; ++c) {
+                        mixer->accum[(done + f) * channels + c] += mixer->scratch[f] * voice->left;
+                    }
+                }
+            }
+
+            if (ramping && voice->ramp.remaining == 0) {
+                // Fold the settled gain back into the pattern
+                updateVoiceGains(voice, channels);
+            }
+            advanceVoice(mixer, voice, take);
+        }
+        if (done > produced) produced = done;
+    }
+
+    coralEncodeFromFloat(mixer->accum, output, mixer->sampleFormat, frames * channels);
+    return produced;
+}
+
+size_t coralMixerRenderFrames(CoralMixer* mixer, uint8_t* output, size_t frames, uint32_t* activeVoices) {
+    size_t produced = 0;
+    size_t chunk;
+    size_t got;
+
+    coralMutexLock(&mixer->mutex);
+    while (frames > 0) {
+        chunk = frames < MIXER_BLOCK_FRAMES ? frames : MIXER_BLOCK_FRAMES;
+        got = renderBlock(mixer, output, chunk);
+        if (got > 0) {
+            produced += got;
+        }
+        output += chunk * mixer->format.blockAlign;
+        frames -= chunk;
+    }
+    if (activeVoices) {
+        *activeVoices = mixer->activeCount;
+    }
+    coralMutexUnlock(&mixer->mutex);
+    return produced;
+}
+
+uint32_t coralMixerRender(CoralMixer* mixer, uint8_t* output, uint32_t frames) {
+    uint32_t active = 0;
+
+    if (!mixer || !output) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null mixer or output pointer");
+        return 0;
+    }
+    coralMixerRenderFrames(mixer, output, frames, &active);
+    return active;
+}
+
+bool coralMixerPlay(CoralMixer* mixer) {
+    CoralDevice* device;
+    uint8_t* block;
+    uint32_t active = 1;
+    size_t produced;
+    bool ok = true;
+
+    if (!mixer) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null mixer pointer");
+        return false;
+    }
+
+    block = (uint8_t*)malloc(MIXER_BLOCK_FRAMES * mixer->format.blockAlign);
+    if (!block) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return false;
+    }
+    device = coralDeviceAcquire(&mixer->format);
+    if (!device) {
+        free(block);
+        return false;
+    }
+
+    while (ok && active > 0) {
+        produced = coralMixerRenderFrames(mixer, block, MIXER_BLOCK_FRAMES, &active);
+        // Trim the silent tail of the final block
+        ok = coralDeviceWrite(device, block, (active > 0 ? MIXER_BLOCK_FRAMES : produced) * mixer->format.blockAlign);
+    }
+
+    if (ok) {
+        ok = coralDeviceDrain(device);
+    }
+    if (ok) {
+        coralDeviceRelease(device, &mixer->format);
+    }
+    else {
+        coralDeviceClose(device);
+    }
+    free(block);
+    return ok;
+}
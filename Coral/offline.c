@@ -0,0 +1,249 @@
+/*
+@file - offline.c
+@developer - ColorProgrammy
+@brief - Offline render targets.
+@date - 16/10/2026
+@description - Lets the output device layer write into memory, a WAV or
+raw file, or nowhere at all instead of a sound card. Playback runs through
+the usual code path but as fast as the CPU allows, and the frames rendered
+are counted so throughput can be measured on headless machines.
+*/
+
+#include "internal.h"
+
+static struct {
+    CoralMutex mutex;
+    CoralBackend backend;
+    char path[1024];
+    FILE* file;                 // CORAL_BACKEND_RAW_FILE
+    CoralWriter* writer;        // CORAL_BACKEND_WAV_FILE, opened with the first format
+    WavFormat format;           // Format of the first block written to the target
+    bool haveFormat;
+    uint64_t dataBytes;
+
+    uint8_t* buffer;            // CORAL_BACKEND_MEMORY
+    size_t capacity;
+
+    uint64_t startedAt;         // First device open since the stats were reset
+    uint64_t lastWriteAt;
+    CoralRenderStats stats;
+} offline;
+
+static CoralOnce offlineOnce = CORAL_ONCE_INIT;
+
+static void offlineInit(void) {
+    coralMutexInit(&offline.mutex);
+    offline.backend = CORAL_BACKEND_DEVICE;
+}
+
+static void closeTarget(void) {
+    coralWriterClose(offline.writer);
+    offline.writer = NULL;
+    if (offline.file) {
+        fclose(offline.file);
+        offline.file = NULL;
+    }
+    free(offline.buffer);
+    offline.buffer = NULL;
+    offline.capacity = 0;
+    offline.haveFormat = false;
+    offline.dataBytes = 0;
+}
+
+static bool sameFormat(const WavFormat* a, const WavFormat* b) {
+    return a->audioFormat == b->audioFormat &&
+        a->sampleRate == b->sampleRate &&
+        a->numChannels == b->numChannels &&
+        a->bitsPerSample == b->bitsPerSample;
+}
+
+bool coralSetOutputBackend(CoralBackend backend, const char* path) {
+    FILE* file = NULL;
+
+    if (backend < CORAL_BACKEND_DEVICE || backend > CORAL_BACKEND_RAW_FILE) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Unknown output backend: %d", (int)backend);
+        return false;
+    }
+    if (backend == CORAL_BACKEND_WAV_FILE || backend == CORAL_BACKEND_RAW_FILE) {
+        if (!path) {
+            coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "File backends need an output path");
+            return false;
+        }
+        if (strlen(path) >= sizeof(offline.path)) {
+            coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Output path is too long");
+            return false;
+        }
+        file = fopen(path, "wb");
+        if (!file) {
+            coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to open file: %s", path);
+            return false;
+        }
+        // The WAV writer reopens the file once the format is known
+        if (backend == CORAL_BACKEND_WAV_FILE) {
+            fclose(file);
+            file = NULL;
+        }
+    }
+
+    coralCallOnce(&offlineOnce, offlineInit);
+    coralMutexLock(&offline.mutex);
+    closeTarget();
+    offline.backend = backend;
+    offline.file = file;
+    offline.path[0] = '\0';
+    if (path && (backend == CORAL_BACKEND_WAV_FILE || backend == CORAL_BACKEND_RAW_FILE)) {
+        strcpy(offline.path, path);
+    }
+    coralMutexUnlock(&offline.mutex);
+
+    // Parked devices belong to the previous backend
+    coralFlushDevicePool();
+    return true;
+}
+
+CoralBackend coralGetOutputBackend(void) {
+    CoralBackend backend;
+
+    coralCallOnce(&offlineOnce, offlineInit);
+    coralMutexLock(&offline.mutex);
+    backend = offline.backend;
+    coralMutexUnlock(&offline.mutex);
+    return backend;
+}
+
+const uint8_t* coralGetRenderBuffer(size_t* size) {
+    const uint8_t* buffer;
+
+    coralCallOnce(&offlineOnce, offlineInit);
+    coralMutexLock(&offline.mutex);
+    buffer = offline.buffer;
+    if (size) {
+        *size = offline.backend == CORAL_BACKEND_MEMORY ? (size_t)offline.dataBytes : 0;
+    }
+    coralMutexUnlock(&offline.mutex);
+    return buffer;
+}
+
+void coralGetRenderStats(CoralRenderStats* stats) {
+    uint64_t elapsed;
+
+    if (!stats) {
+        return;
+    }
+    coralCallOnce(&offlineOnce, offlineInit);
+    coralMutexLock(&offline.mutex);
+    *stats = offline.stats;
+    elapsed = offline.lastWriteAt > offline.startedAt ? offline.lastWriteAt - offline.startedAt : 0;
+    stats->elapsedNs = elapsed;
+    stats->framesPerSecond = elapsed ? (double)stats->frames * 1e9 / (double)elapsed : 0.0;
+    coralMutexUnlock(&offline.mutex);
+}
+
+void coralResetRenderStats(void) {
+    coralCallOnce(&offlineOnce, offlineInit);
+    coralMutexLock(&offline.mutex);
+    memset(&offline.stats, 0, sizeof(CoralRenderStats));
+    offline.startedAt = 0;
+    offline.lastWriteAt = 0;
+    coralMutexUnlock(&offline.mutex);
+}
+
+bool coralOfflineSelected(void) {
+    return coralGetOutputBackend() != CORAL_BACKEND_DEVICE;
+}
+
+bool coralOfflineOpen(const WavFormat* format) {
+    CoralSampleFormat sampleFormat;
+    bool ok = true;
+
+    coralCallOnce(&offlineOnce, offlineInit);
+    coralMutexLock(&offline.mutex);
+    if (offline.backend != CORAL_BACKEND_NULL && offline.haveFormat && !sameFormat(&offline.format, format)) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Render target already holds %u Hz %d-channel %d-bit audio",
+            (unsigned)offline.format.sampleRate, offline.format.numChannels, offline.format.bitsPerSample);
+        ok = false;
+    }
+    else if (!offline.haveFormat) {
+        offline.format = *format;
+        offline.format.subChunk1Size = 16;
+        memcpy(offline.format.subChunk1ID, "fmt ", 4);
+        offline.haveFormat = true;
+        if (offline.backend == CORAL_BACKEND_WAV_FILE) {
+            // Sizes are patched at every drain, and the file turns RF64 past 4 GiB
+            offline.writer = coralSampleFormatOf(format, &sampleFormat) ?
+                coralWriterOpen(offline.path, format->sampleRate, format->numChannels, sampleFormat, sampleFormat) : NULL;
+            if (!offline.writer) {
+                offline.haveFormat = false;
+                ok = false;
+            }
+        }
+    }
+    if (ok) {
+        offline.stats.opens++;
+        if (offline.startedAt == 0) {
+            offline.startedAt = coralTimeNs();
+        }
+    }
+    coralMutexUnlock(&offline.mutex);
+    return ok;
+}
+
+bool coralOfflineWrite(const WavFormat* format, const uint8_t* data, size_t size) {
+    uint8_t* buffer;
+    size_t capacity;
+    bool ok = true;
+
+    coralMutexLock(&offline.mutex);
+    switch (offline.backend) {
+    case CORAL_BACKEND_MEMORY:
+        if (offline.dataBytes + size > offline.capacity) {
+            capacity = offline.capacity ? offline.capacity : 65536;
+            while (capacity < offline.dataBytes + size) capacity *= 2;
+            buffer = (uint8_t*)realloc(offline.buffer, capacity);
+            if (!buffer) {
+                coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+                ok = false;
+                break;
+            }
+            offline.buffer = buffer;
+            offline.capacity = capacity;
+        }
+        memcpy(offline.buffer + offline.dataBytes, data, size);
+        break;
+    case CORAL_BACKEND_WAV_FILE:
+        ok = coralWriterAppend(offline.writer, data, size / format->blockAlign);
+        break;
+    case CORAL_BACKEND_RAW_FILE:
+        if (fwrite(data, 1, size, offline.file) != size) {
+            coralSetError(CORAL_ERROR_FILE_WRITE, "Failed to write to %s", offline.path);
+            ok = false;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (ok) {
+        offline.dataBytes += size;
+        offline.stats.frames += size / format->blockAlign;
+        offline.stats.bytes += size;
+        offline.stats.writes++;
+        offline.lastWriteAt = coralTimeNs();
+    }
+    coralMutexUnlock(&offline.mutex);
+    return ok;
+}
+
+bool coralOfflineDrain(void) {
+    bool ok;
+
+    coralMutexLock(&offline.mutex);
+    // Patching the sizes leaves a valid file after every drain
+    ok = !offline.writer || coralWriterFlush(offline.writer);
+    if (ok && offline.file && (fflush(offline.file) != 0 || ferror(offline.file))) {
+        coralSetError(CORAL_ERROR_FILE_WRITE, "Failed to write to %s", offline.path);
+        ok = false;
+    }
+    coralMutexUnlock(&offline.mutex);
+    return ok;
+}
@@ -0,0 +1,282 @@
+/*
+@file - pool.c
+@developer - ColorProgrammy
+@brief - Output device pool.
+@date - 16/10/2026
+@description - Keeps recently used output devices open, keyed by format,
+so short sounds skip the open/configure cost. Idle devices are closed by
+a janitor thread after a timeout.
+*/
+
+#include "internal.h"
+
+#define POOL_DEFAULT_TIMEOUT_MS 5000
+#define POOL_MAX_IDLE 8
+
+typedef struct PoolEntry {
+    WavFormat format;
+    CoralDevice* device;
+    uint64_t parkedAt;
+    struct PoolEntry* next;
+} PoolEntry;
+
+static struct {
+    CoralMutex mutex;
+    CoralCond wake;
+    PoolEntry* idle;            // Most recently parked first
+    uint32_t idleCount;
+    uint32_t timeoutMs;
+
+    CoralThread janitor;
+    bool janitorRunning;
+    bool janitorJoinable;       // Exited but not joined yet
+    bool stopping;              // Shutdown is joining the janitor; close instead of parking
+
+    CoralDevicePoolStats stats;
+} pool;
+
+static CoralOnce poolOnce = CORAL_ONCE_INIT;
+
+static void poolInit(void) {
+    coralMutexInit(&pool.mutex);
+    coralCondInit(&pool.wake);
+    pool.timeoutMs = POOL_DEFAULT_TIMEOUT_MS;
+}
+
+static bool sameFormat(const WavFormat* a, const WavFormat* b) {
+    return a->audioFormat == b->audioFormat &&
+        a->sampleRate == b->sampleRate &&
+        a->numChannels == b->numChannels &&
+        a->bitsPerSample == b->bitsPerSample;
+}
+
+// Unlinks idle entries parked before the cutoff (or all of them when
+// cutoff is 0) and returns them as a list. Called with the mutex held.
+static PoolEntry* takeExpired(uint64_t cutoff) {
+    PoolEntry** link = &pool.idle;
+    PoolEntry* expired = NULL;
+    PoolEntry* entry;
+
+    while (*link) {
+        entry = *link;
+        if (cutoff == 0 || entry->parkedAt <= cutoff) {
+            *link = entry->next;
+            entry->next = expired;
+            expired = entry;
+            pool.idleCount--;
+            pool.stats.closes++;
+        }
+        else {
+            link = &entry->next;
+        }
+    }
+    pool.stats.idleDevices = pool.idleCount;
+    return expired;
+}
+
+static void closeEntries(PoolEntry* entries) {
+    PoolEntry* entry;
+
+    while (entries) {
+        entry = entries;
+        entries = entry->next;
+        coralDeviceClose(entry->device);
+        free(entry);
+    }
+}
+
+static void janitorThread(void* arg) {
+    PoolEntry* expired;
+    PoolEntry* entry;
+    uint64_t timeoutNs;
+    uint64_t oldest;
+    uint64_t now;
+    uint64_t waitMs;
+
+    (void)arg;
+
+    coralMutexLock(&pool.mutex);
+    while (pool.idle && !pool.stopping) {
+        timeoutNs = (uint64_t)pool.timeoutMs * 1000000ULL;
+        now = coralTimeNs();
+        expired = now > timeoutNs ? takeExpired(now - timeoutNs) : NULL;
+        if (expired) {
+            coralMutexUnlock(&pool.mutex);
+            closeEntries(expired);
+            coralMutexLock(&pool.mutex);
+            continue;
+        }
+
+        oldest = now;
+        for (entry = pool.idle; entry; entry = entry->next) {
+            if (entry->parkedAt < oldest) oldest = entry->parkedAt;
+        }
+        waitMs = (oldest + timeoutNs - now) / 1000000ULL + 1;
+        coralCondWaitTimeout(&pool.wake, &pool.mutex, (uint32_t)waitMs);
+    }
+    pool.janitorRunning = false;
+    pool.janitorJoinable = true;
+    coralMutexUnlock(&pool.mutex);
+}
+
+CoralDevice* coralDeviceAcquire(const WavFormat* format) {
+    PoolEntry** link;
+    PoolEntry* entry;
+    CoralDevice* device;
+    uint64_t start;
+
+    coralCallOnce(&poolOnce, poolInit);
+    coralMutexLock(&pool.mutex);
+    for (link = &pool.idle; *link; link = &(*link)->next) {
+        entry = *link;
+        if (sameFormat(&entry->format, format)) {
+            *link = entry->next;
+            pool.idleCount--;
+            pool.stats.reuses++;
+            pool.stats.idleDevices = pool.idleCount;
+            coralMutexUnlock(&pool.mutex);
+
+            device = entry->device;
+            free(entry);
+            if (coralDeviceCurrent(device) && coralDeviceReset(device)) {
+                return device;
+            }
+            // Stale or could not restart it; fall back to a fresh open
+            coralDeviceClose(device);
+            coralMutexLock(&pool.mutex);
+            pool.stats.reuses--;
+            break;
+        }
+    }
+    coralMutexUnlock(&pool.mutex);
+
+    start = coralTimeNs();
+    device = coralDeviceOpen(format);
+    if (!device) {
+        return NULL;
+    }
+
+    coralMutexLock(&pool.mutex);
+    pool.stats.opens++;
+    pool.stats.openTimeNs += coralTimeNs() - start;
+    coralMutexUnlock(&pool.mutex);
+    return device;
+}
+
+void coralDeviceRelease(CoralDevice* device, const WavFormat* format) {
+    PoolEntry* entry;
+    PoolEntry* evicted = NULL;
+    PoolEntry** link;
+    bool current;
+
+    if (!device) {
+        return;
+    }
+
+    coralCallOnce(&poolOnce, poolInit);
+    // A device opened while an output setting changed missed the flush
+    current = coralDeviceCurrent(device);
+    entry = (PoolEntry*)malloc(sizeof(PoolEntry));
+    coralMutexLock(&pool.mutex);
+    if (!entry || pool.timeoutMs == 0 || !current || pool.stopping) {
+        coralMutexUnlock(&pool.mutex);
+        free(entry);
+        coralDeviceClose(device);
+        return;
+    }
+
+    entry->format = *format;
+    entry->device = device;
+    entry->parkedAt = coralTimeNs();
+    entry->next = pool.idle;
+    pool.idle = entry;
+    pool.idleCount++;
+
+    // Over capacity: evict the least recently parked device
+    if (pool.idleCount > POOL_MAX_IDLE) {
+        link = &pool.idle;
+        while ((*link)->next) link = &(*link)->next;
+        evicted = *link;
+        *link = NULL;
+        pool.idleCount--;
+        pool.stats.closes++;
+    }
+    pool.stats.idleDevices = pool.idleCount;
+
+    if (!pool.janitorRunning) {
+        if (pool.janitorJoinable) {
+            coralThreadJoin(pool.janitor);
+            pool.janitorJoinable = false;
+        }
+        pool.janitorRunning = coralThreadStart(&pool.janitor, janitorThread, NULL);
+    }
+    coralCondSignal(&pool.wake);
+    coralMutexUnlock(&pool.mutex);
+
+    if (evicted) {
+        coralDeviceClose(evicted->device);
+        free(evicted);
+    }
+}
+
+void coralSetDevicePoolTimeout(uint32_t milliseconds) {
+    PoolEntry* expired = NULL;
+
+    coralCallOnce(&poolOnce, poolInit);
+    coralMutexLock(&pool.mutex);
+    pool.timeoutMs = milliseconds;
+    if (milliseconds == 0) {
+        expired = takeExpired(0);
+    }
+    coralCondSignal(&pool.wake);
+    coralMutexUnlock(&pool.mutex);
+
+    closeEntries(expired);
+}
+
+void coralFlushDevicePool(void) {
+    PoolEntry* expired;
+
+    coralCallOnce(&poolOnce, poolInit);
+    coralMutexLock(&pool.mutex);
+    expired = takeExpired(0);
+    coralCondSignal(&pool.wake);
+    coralMutexUnlock(&pool.mutex);
+
+    closeEntries(expired);
+}
+
+void coralDevicePoolShutdown(void) {
+    PoolEntry* expired;
+    bool join;
+
+    coralCallOnce(&poolOnce, poolInit);
+    coralMutexLock(&pool.mutex);
+    expired = takeExpired(0);
+    pool.stopping = true;
+    join = pool.janitorRunning || pool.janitorJoinable;
+    coralCondSignal(&pool.wake);
+    coralMutexUnlock(&pool.mutex);
+
+    closeEntries(expired);
+    if (join) {
+        coralThreadJoin(pool.janitor);
+    }
+
+    // The pool stays usable; the next release starts a new janitor
+    coralMutexLock(&pool.mutex);
+    pool.janitorRunning = false;
+    pool.janitorJoinable = false;
+    pool.stopping = false;
+    coralMutexUnlock(&pool.mutex);
+}
+
+void coralGetDevicePoolStats(CoralDevicePoolStats* stats) {
+    if (!stats) {
+        return;
+    }
+    coralCallOnce(&poolOnce, poolInit);
+    coralMutexLock(&pool.mutex);
+    *stats = pool.stats;
+    coralMutexUnlock(&pool.mutex);
+}
@@ -0,0 +1,186 @@
+/*
+@file - probe.c
+@developer - ColorProgrammy
+@brief - Header-only WAV inspection.
+@date - 16/10/2026
+@description - Walks the chunk list of RIFF, RF64 and Wave64 files with
+positioned reads and never touches the sample data. The first read covers
+the start of the file, which normally holds every header up to the data
+chunk; chunks past the data (such as a trailing LIST) cost one more small
+read each.
+*/
+
+#include "internal.h"
+
+#ifdef PLATFORM_WINDOWS
+typedef HANDLE ProbeFile;
+#else
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+typedef int ProbeFile;
+#endif
+
+#define PROBE_WINDOW_BYTES 4096
+
+typedef struct {
+    ProbeFile file;
+    uint64_t size;
+    uint8_t window[PROBE_WINDOW_BYTES];     // The first bytes of the file
+    size_t windowSize;
+} Probe;
+
+static bool openProbe(Probe* probe, const char* filename) {
+#ifdef PLATFORM_WINDOWS
+    LARGE_INTEGER fileSize;
+
+    probe->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (probe->file == INVALID_HANDLE_VALUE) {
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to open file: %s", filename);
+        return false;
+    }
+    if (!GetFileSizeEx(probe->file, &fileSize)) {
+        CloseHandle(probe->file);
+        coralSetError(CORAL_ERROR_FILE_READ, "Failed to query file: %s", filename);
+        return false;
+    }
+    probe->size = (uint64_t)fileSize.QuadPart;
+    return true;
+#else
+    struct stat st;
+
+    probe->file = open(filename, O_RDONLY);
+    if (probe->file < 0) {
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to open file: %s", filename);
+        return false;
+    }
+    if (fstat(probe->file, &st) != 0) {
+        close(probe->file);
+        coralSetError(CORAL_ERROR_FILE_READ, "Failed to query file: %s", filename);
+        return false;
+    }
+    probe->size = (uint64_t)st.st_size;
+    return true;
+#endif
+}
+
+static void closeProbe(Probe* probe) {
+#ifdef PLATFORM_WINDOWS
+    CloseHandle(probe->file);
+#else
+    close(probe->file);
+#endif
+}
+
+// Reads size bytes at offset without moving any shared file position
+static bool readAt(Probe* probe, uint64_t offset, void* buffer, size_t size) {
+#ifdef PLATFORM_WINDOWS
+    OVERLAPPED overlapped;
+    DWORD read;
+
+    ZeroMemory(&overlapped, sizeof(overlapped));
+    overlapped.Offset = (DWORD)offset;
+    overlapped.OffsetHigh = (DWORD)(offset >> 32);
+    if (!ReadFile(probe->file, buffer, (DWORD)size, &read, &overlapped) || read != size) {
+        coralSetError(CORAL_ERROR_FILE_READ, "Failed to read WAV headers");
+        return false;
+    }
+    coralCount(CORAL_COUNT_BYTES_READ, size);
+    return true;
+#else
+    ssize_t got;
+    size_t done = 0;
+
+    while (done < size) {
+        got = pread(probe->file, (uint8_t*)buffer + done, size - done, (off_t)(offset + done));
+        if (got <= 0) {
+            coralSetError(CORAL_ERROR_FILE_READ, "Failed to read WAV headers");
+            return false;
+        }
+        done += (size_t)got;
+    }
+    coralCount(CORAL_COUNT_BYTES_READ, size);
+    return true;
+#endif
+}
+
+// Serves reads from the initial window when it covers them
+static bool readHeader(void* source, uint64_t offset, void* buffer, size_t size) {
+    Probe* probe = (Probe*)source;
+
+    if (offset + size <= probe->windowSize) {
+        memcpy(buffer, probe->window + offset, size);
+        return true;
+    }
+    return readAt(probe, offset, buffer, size);
+}
+
+static bool probeChunks(Probe* probe, CoralWavInfo* info) {
+    CoralWavLayout layout;
+    WavFile header;
+
+    memset(&layout, 0, sizeof(layout));
+    memset(&header, 0, sizeof(header));
+    layout.chunks = info->chunks;
+    if (!coralParseWav(readHeader, probe, probe->size, &header, &layout)) {
+        return false;
+    }
+
+    // A short data chunk is reported as far as the file goes
+    info->container = layout.container;
+    info->format = header.wavFormat;
+    info->channelMask = header.channelMask;
+    info->validBitsPerSample = header.validBitsPerSample;
+    info->dataOffset = layout.dataOffset;
+    info->dataSize = layout.dataSize;
+    info->loopStart = header.loopStart;
+    info->loopEnd = header.loopEnd;
+    info->chunkCount = layout.chunkCount;
+    return true;
+}
+
+bool probeWavFile(const char* filename, CoralWavInfo* info) {
+    Probe* probe;
+    uint64_t parseStart;
+    bool ok;
+
+    if (!filename || !info) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null file name or info pointer");
+        return false;
+    }
+    memset(info, 0, sizeof(CoralWavInfo));
+
+    // The window is too large to be comfortable on small thread stacks
+    probe = (Probe*)malloc(sizeof(Probe));
+    if (!probe) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return false;
+    }
+    if (!openProbe(probe, filename)) {
+        free(probe);
+        return false;
+    }
+
+    probe->windowSize = probe->size < PROBE_WINDOW_BYTES ? (size_t)probe->size : PROBE_WINDOW_BYTES;
+    parseStart = coralTimeNs();
+    ok = readAt(probe, 0, probe->window, probe->windowSize) && probeChunks(probe, info);
+    if (ok) {
+        coralRecord(CORAL_TIME_PARSE, coralTimeNs() - parseStart);
+    }
+    info->fileSize = probe->size;
+    closeProbe(probe);
+    free(probe);
+    if (!ok) {
+        return false;
+    }
+
+    info->metadata.sampleRate = (int)info->format.sampleRate;
+    info->metadata.numChannels = info->format.numChannels;
+    info->metadata.bitsPerSample = info->format.bitsPerSample;
+    info->frames = coralFrameCount(&info->format, info->dataSize);
+    if (info->format.sampleRate > 0) {
+        info->metadata.duration = (double)info->frames / info->format.sampleRate;
+    }
+    return true;
+}
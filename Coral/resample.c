@@ -0,0 +1,415 @@
+/*
+@file - resample.c
+@developer - ColorProgrammy
+@brief - Polyphase sample rate converter.
+@date - 16/10/2026
+@description - Converts float audio between sample rates with a windowed
+sinc filter bank computed once per resampler. Rates whose reduced ratio has
+few enough phases use one filter per phase; others interpolate between two
+neighbouring phases of a finer table. The inner dot product runs on the
+widest instruction set available.
+*/
+
+#include "internal.h"
+#include <math.h>
+
+#define RESAMPLE_BLOCK_FRAMES 1024
+#define RESAMPLE_MAX_EXACT_PHASES 1024
+#define RESAMPLE_TABLE_PHASES 256
+#define RESAMPLE_MAX_TAPS 512
+#define RESAMPLE_PI 3.14159265358979323846
+
+typedef float (*DotKernel)(const float* coeffs, const float* samples, uint32_t taps);
+
+struct CoralResampler {
+    uint32_t inputRate;
+    uint32_t outputRate;
+    uint16_t channels;
+    uint32_t step;              // Reduced ratio: input advances step / phases per output frame
+    uint32_t phases;
+    uint32_t stepWhole;         // step / phases and step % phases, to avoid a division per frame
+    uint32_t stepFraction;
+    uint32_t taps;              // Filter length, a multiple of 8
+    uint32_t tablePhases;       // Filters in the table; phases when exact
+    bool interpolate;
+    float* table;               // (tablePhases + 1) filters of taps coefficients
+    float* history;             // Per channel, capacity samples
+    size_t capacity;
+    size_t fill;                // Samples buffered per channel
+    size_t position;            // First tap of the next output frame
+    uint32_t fraction;          // Sub-sample position, in 1 / phases
+    uint64_t inputFrames;       // Totals since the last reset, for flushing
+    uint64_t outputFrames;
+    DotKernel dot;
+};
+
+static float dotScalar(const float* coeffs, const float* samples, uint32_t taps) {
+    float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+    uint32_t i;
+
+    for (i = 0; i < taps; i += 4) {
+        sum0 += coeffs[i] * samples[i];
+        sum1 += coeffs[i + 1] * samples[i + 1];
+        sum2 += coeffs[i + 2] * samples[i + 2];
+        sum3 += coeffs[i + 3] * samples[i + 3];
+    }
+    return (sum0 + sum1) + (sum2 + sum3);
+}
+
+#ifdef CORAL_ARCH_X86
+static CORAL_TARGET_SSE2 float dotSse2(const float* coeffs, const float* samples, uint32_t taps) {
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    float lanes[4];
+    uint32_t i;
+
+    for (i = 0; i < taps; i += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(coeffs + i), _mm_loadu_ps(samples + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(coeffs + i + 4), _mm_loadu_ps(samples + i + 4)));
+    }
+    _mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+#ifdef CORAL_HAVE_AVX2
+static CORAL_TARGET_AVX2 float dotAvx2(const float* coeffs, const float* samples, uint32_t taps) {
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    __m128 sum;
+    float lanes[4];
+    uint32_t i = 0;
+
+    for (; i + 16 <= taps; i += 16) {
+        sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(coeffs + i), _mm256_loadu_ps(samples + i)));
+        sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(coeffs + i + 8), _mm256_loadu_ps(samples + i + 8)));
+    }
+    if (i < taps) {
+        sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(coeffs + i), _mm256_loadu_ps(samples + i)));
+    }
+    sum0 = _mm256_add_ps(sum0, sum1);
+    sum = _mm_add_ps(_mm256_castps256_ps128(sum0), _mm256_extractf128_ps(sum0, 1));
+    _mm_storeu_ps(lanes, sum);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+#endif
+#endif
+
+#ifdef CORAL_ARCH_NEON
+static float dotNeon(const float* coeffs, const float* samples, uint32_t taps) {
+    float32x4_t sum0 = vdupq_n_f32(0.0f);
+    float32x4_t sum1 = vdupq_n_f32(0.0f);
+    float32x2_t pair;
+    uint32_t i;
+
+    for (i = 0; i < taps; i += 8) {
+        sum0 = vmlaq_f32(sum0, vld1q_f32(coeffs + i), vld1q_f32(samples + i));
+        sum1 = vmlaq_f32(sum1, vld1q_f32(coeffs + i + 4), vld1q_f32(samples + i + 4));
+    }
+    sum0 = vaddq_f32(sum0, sum1);
+    pair = vadd_f32(vget_low_f32(sum0), vget_high_f32(sum0));
+    return vget_lane_f32(vpadd_f32(pair, pair), 0);
+}
+#endif
+
+static DotKernel selectDot(void) {
+    switch (coralGetSimdLevel()) {
+#ifdef CORAL_ARCH_X86
+#ifdef CORAL_HAVE_AVX2
+    case CORAL_SIMD_AVX2: return dotAvx2;
+#endif
+    case CORAL_SIMD_SSE2: return dotSse2;
+#endif
+#ifdef CORAL_ARCH_NEON
+    case CORAL_SIMD_NEON: return dotNeon;
+#endif
+    default: return dotScalar;
+    }
+}
+
+static uint32_t greatestCommonDivisor(uint32_t a, uint32_t b) {
+    uint32_t t;
+
+    while (b != 0) {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Zeroth-order modified Bessel function, for the Kaiser window
+static double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    int k;
+
+    for (k = 1; k < 40; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+// Fills phase p of the table: the filter for an output frame p / tablePhases
+// of an input sample past the centre tap. Each phase is normalized to unity
+// gain at DC so the phases do not modulate a constant signal.
+static void designPhase(float* filter, uint32_t taps, uint32_t p, uint32_t tablePhases, double cutoff, double beta) {
+    double offset = (double)p / tablePhases;
+    double half = taps / 2.0;
+    double norm = besselI0(beta);
+    double coeffs[RESAMPLE_MAX_TAPS];
+    double sum = 0.0;
+    double d, u, h;
+    uint32_t k;
+
+    for (k = 0; k < taps; ++k) {
+        d = (double)k - (half - 1.0) - offset;
+        u = d / half;
+        h = d == 0.0 ? cutoff : sin(RESAMPLE_PI * cutoff * d) / (RESAMPLE_PI * d);
+        h *= u * u < 1.0 ? besselI0(beta * sqrt(1.0 - u * u)) / norm : 0.0;
+        coeffs[k] = h;
+        sum += h;
+    }
+    for (k = 0; k < taps; ++k) {
+        filter[k] = (float)(sum != 0.0 ? coeffs[k] / sum : 0.0);
+    }
+}
+
+CoralResampler* coralResamplerCreate(uint32_t inputRate, uint32_t outputRate, uint16_t channels, CoralResampleQuality quality) {
+    // Taps per phase, Kaiser beta and passband edge as a fraction of Nyquist
+    static const uint32_t qualityTaps[] = { 16, 32, 64 };
+    static const double qualityBeta[] = { 5.0, 7.5, 9.5 };
+    static const double qualityRolloff[] = { 0.80, 0.90, 0.945 };
+    CoralResampler* resampler;
+    uint32_t divisor;
+    uint32_t taps;
+    uint32_t p;
+    double cutoff;
+
+    if (inputRate == 0 || outputRate == 0 || channels == 0) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Invalid resampler rates or channel count");
+        return NULL;
+    }
+    if ((int)quality < CORAL_RESAMPLE_FAST || quality > CORAL_RESAMPLE_HIGH) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Invalid resampler quality: %d", (int)quality);
+        return NULL;
+    }
+
+    resampler = (CoralResampler*)malloc(sizeof(CoralResampler));
+    if (!resampler) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+    memset(resampler, 0, sizeof(CoralResampler));
+
+    divisor = greatestCommonDivisor(inputRate, outputRate);
+    resampler->inputRate = inputRate;
+    resampler->outputRate = outputRate;
+    resampler->channels = channels;
+    resampler->phases = outputRate / divisor;
+    resampler->step = inputRate / divisor;
+    resampler->stepWhole = resampler->step / resampler->phases;
+    resampler->stepFraction = resampler->step % resampler->phases;
+    resampler->interpolate = resampler->phases > RESAMPLE_MAX_EXACT_PHASES;
+    resampler->tablePhases = resampler->interpolate ? RESAMPLE_TABLE_PHASES : resampler->phases;
+
+    // Downsampling lowers the cutoff, so the filter widens to keep the
+    // same transition band relative to the output rate
+    taps = qualityTaps[quality];
+    cutoff = qualityRolloff[quality];
+    if (inputRate > outputRate) {
+        cutoff *= (double)outputRate / inputRate;
+        taps = (uint32_t)ceil(taps * (double)inputRate / outputRate);
+    }
+    taps = (taps + 7) & ~7u;
+    resampler->taps = taps < RESAMPLE_MAX_TAPS ? taps : RESAMPLE_MAX_TAPS;
+
+    resampler->capacity = resampler->taps + RESAMPLE_BLOCK_FRAMES;
+    resampler->table = (float*)malloc((size_t)(resampler->tablePhases + 1) * resampler->taps * sizeof(float));
+    resampler->history = (float*)malloc(resampler->capacity * channels * sizeof(float));
+    if (!resampler->table || !resampler->history) {
+        coralResamplerDestroy(resampler);
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+
+    for (p = 0; p <= resampler->tablePhases; ++p) {
+        designPhase(resampler->table + (size_t)p * resampler->taps, resampler->taps, p,
+            resampler->tablePhases, cutoff, qualityBeta[quality]);
+    }
+    resampler->dot = selectDot();
+    coralResamplerReset(resampler);
+    return resampler;
+}
+
+void coralResamplerDestroy(CoralResampler* resampler) {
+    if (!resampler) {
+        return;
+    }
+    free(resampler->table);
+    free(resampler->history);
+    free(resampler);
+}
+
+void coralResamplerReset(CoralResampler* resampler) {
+    if (!resampler) {
+        return;
+    }
+    // Half a filter of silence puts the first input sample on the centre tap
+    resampler->fill = resampler->taps / 2 - 1;
+    memset(resampler->history, 0, resampler->capacity * resampler->channels * sizeof(float));
+    resampler->position = 0;
+    resampler->fraction = 0;
+    resampler->inputFrames = 0;
+    resampler->outputFrames = 0;
+}
+
+uint32_t coralResamplerLatency(const CoralResampler* resampler) {
+    return resampler ? resampler->taps / 2 : 0;
+}
+
+// Computes output frames while the filter has enough history buffered
+static size_t produce(CoralResampler* resampler, float* output, size_t outputFrames, uint64_t limit) {
+    const float* filter;
+    const float* next;
+    float* channelHistory;
+    float a, b, mu;
+    uint64_t scaled;
+    size_t produced = 0;
+    uint16_t c;
+
+    while (produced < outputFrames && resampler->outputFrames < limit &&
+        resampler->position + resampler->taps <= resampler->fill) {
+        if (!resampler->interpolate) {
+            filter = resampler->table + (size_t)resampler->fraction * resampler->taps;
+            for (c = 0; c < resampler->channels; ++c) {
+                channelHistory = resampler->history + c * resampler->capacity;
+                output[c] = resampler->dot(filter, channelHistory + resampler->position, resampler->taps);
+            }
+        }
+        else {
+            scaled = (uint64_t)resampler->fraction * resampler->tablePhases;
+            filter = resampler->table + (size_t)(scaled / resampler->phases) * resampler->taps;
+            next = filter + resampler->taps;
+            mu = (float)(scaled % resampler->phases) / (float)resampler->phases;
+            for (c = 0; c < resampler->channels; ++c) {
+                channelHistory = resampler->history + c * resampler->capacity + resampler->position;
+                a = resampler->dot(filter, channelHistory, resampler->taps);
+                b = resampler->dot(next, channelHistory, resampler->taps);
+                output[c] = a + (b - a) * mu;
+            }
+        }
+
+        output += resampler->channels;
+        produced++;
+        resampler->outputFrames++;
+        resampler->position += resampler->stepWhole;
+        resampler->fraction += resampler->stepFraction;
+        if (resampler->fraction >= resampler->phases) {
+            resampler->fraction -= resampler->phases;
+            resampler->position++;
+        }
+    }
+    return produced;
+}
+
+// Drops history the filter no longer reaches, making room for new input
+static void compact(CoralResampler* resampler) {
+    size_t keep;
+    size_t drop = resampler->position < resampler->fill ? resampler->position : resampler->fill;
+    uint16_t c;
+
+    if (drop == 0) {
+        return;
+    }
+    keep = resampler->fill - drop;
+    for (c = 0; c < resampler->channels; ++c) {
+        memmove(resampler->history + c * resampler->capacity,
+            resampler->history + c * resampler->capacity + drop, keep * sizeof(float));
+    }
+    resampler->fill = keep;
+    resampler->position -= drop;
+}
+
+// Deinterleaves up to frames of input, or silence when input is NULL
+static size_t append(CoralResampler* resampler, const float* input, size_t frames) {
+    size_t room = resampler->capacity - resampler->fill;
+    size_t i;
+    uint16_t c;
+
+    if (frames > room) {
+        frames = room;
+    }
+    for (c = 0; c < resampler->channels; ++c) {
+        float* dst = resampler->history + c * resampler->capacity + resampler->fill;
+        if (!input) {
+            memset(dst, 0, frames * sizeof(float));
+            continue;
+        }
+        for (i = 0; i < frames; ++i) {
+            dst[i] = input[i * resampler->channels + c];
+        }
+    }
+    resampler->fill += frames;
+    return frames;
+}
+
+size_t coralResamplerProcess(CoralResampler* resampler, const float* input, size_t inputFrames,
+    size_t* consumed, float* output, size_t outputFrames) {
+    size_t produced = 0;
+    size_t taken = 0;
+    size_t made;
+    size_t added;
+
+    if (consumed) {
+        *consumed = 0;
+    }
+    if (!resampler || (!input && inputFrames > 0) || (!output && outputFrames > 0)) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null resampler or buffer");
+        return 0;
+    }
+
+    while (1) {
+        made = produce(resampler, output + produced * resampler->channels, outputFrames - produced, UINT64_MAX);
+        produced += made;
+        if (produced == outputFrames || taken == inputFrames) {
+            break;
+        }
+        compact(resampler);
+        added = append(resampler, input + taken * resampler->channels, inputFrames - taken);
+        taken += added;
+        resampler->inputFrames += added;
+        if (made == 0 && added == 0) {
+            break;
+        }
+    }
+
+    if (consumed) {
+        *consumed = taken;
+    }
+    return produced;
+}
+
+size_t coralResamplerFlush(CoralResampler* resampler, float* output, size_t outputFrames) {
+    uint64_t expected;
+    size_t produced = 0;
+
+    if (!resampler || (!output && outputFrames > 0)) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null resampler or buffer");
+        return 0;
+    }
+
+    // Every input frame yields phases / step output frames, rounded up
+    expected = (resampler->inputFrames * resampler->phases + resampler->step - 1) / resampler->step;
+    while (produced < outputFrames && resampler->outputFrames < expected) {
+        produced += produce(resampler, output + produced * resampler->channels, outputFrames - produced, expected);
+        if (produced < outputFrames && resampler->outputFrames < expected) {
+            compact(resampler);
+            append(resampler, NULL, RESAMPLE_BLOCK_FRAMES);
+        }
+    }
+    return produced;
+}
@@ -0,0 +1,346 @@
+/*
+@file - ring.c
+@developer - ColorProgrammy
+@brief - Playback of audio produced while it plays.
+@date - 16/10/2026
+@description - A stream owns a device and an audio thread. In push mode one
+producer thread writes frames into a single-producer, single-consumer ring
+that the audio thread drains; each side only ever stores its own position,
+so neither takes a lock. In pull mode the audio thread asks a callback for
+every block instead.
+*/
+
+#include "internal.h"
+
+#define RING_BLOCK_FRAMES 1024
+#define RING_MIN_CAPACITY 256
+#define RING_IDLE_MS 1
+
+struct CoralStream {
+    WavFormat format;
+    CoralDevice* device;
+    CoralThread thread;
+    bool started;
+
+    CoralStreamCallback callback;
+    void* userData;
+
+    uint8_t* ring;              // capacity frames; NULL in pull mode
+    size_t capacity;            // Power of two, so positions wrap with the mask
+    size_t mask;
+    volatile size_t writePos;   // Frames ever written; stored by the producer only
+    volatile size_t readPos;    // Frames ever consumed; stored by the audio thread only
+    volatile size_t dropped;    // Stored by the producer only
+    volatile size_t underruns;  // Stored by the audio thread only
+
+    volatile size_t finishing;  // No more writes are coming; play out the ring
+    volatile size_t stopping;   // Stop now and discard what is queued
+    volatile size_t ended;      // The audio thread has finished
+    volatile size_t failed;
+
+    uint8_t* block;
+    uint32_t blockFrames;
+};
+
+static size_t nextPowerOfTwo(size_t value) {
+    size_t result = RING_MIN_CAPACITY;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Copies frames out of the ring starting at position pos, across the wrap
+static void readRing(const CoralStream* stream, size_t pos, uint8_t* dst, size_t frames) {
+    size_t start = pos & stream->mask;
+    size_t first = stream->capacity - start < frames ? stream->capacity - start : frames;
+    uint16_t blockAlign = stream->format.blockAlign;
+
+    memcpy(dst, stream->ring + start * blockAlign, first * blockAlign);
+    memcpy(dst + first * blockAlign, stream->ring, (frames - first) * blockAlign);
+}
+
+static void writeRing(CoralStream* stream, size_t pos, const uint8_t* src, size_t frames) {
+    size_t start = pos & stream->mask;
+    size_t first = stream->capacity - start < frames ? stream->capacity - start : frames;
+    uint16_t blockAlign = stream->format.blockAlign;
+
+    memcpy(stream->ring + start * blockAlign, src, first * blockAlign);
+    memcpy(stream->ring, src + first * blockAlign, (frames - first) * blockAlign);
+}
+
+// Returns the frames to play next, 0 when the ring is empty, or -1 at the end
+static long pullFromRing(CoralStream* stream, bool* playing) {
+    size_t readPos = stream->readPos;
+    size_t available = coralAtomicLoad(&stream->writePos) - readPos;
+    size_t frames;
+
+    if (available == 0) {
+        // Finishing is published after the last write, so an empty ring seen
+        // after it is really empty
+        if (coralAtomicLoad(&stream->finishing)) {
+            available = coralAtomicLoad(&stream->writePos) - readPos;
+            if (available == 0) {
+                return -1;
+            }
+        }
+        else {
+            return 0;
+        }
+    }
+
+    frames = available < stream->blockFrames ? available : stream->blockFrames;
+    readRing(stream, readPos, stream->block, frames);
+    coralAtomicStore(&stream->readPos, readPos + frames);
+    *playing = true;
+    return (long)frames;
+}
+
+static void streamThread(void* arg) {
+    CoralStream* stream = (CoralStream*)arg;
+    CoralLatencyConfig config;
+    bool offline = coralOfflineSelected();
+    bool playing = false;
+    bool ok = true;
+    long frames;
+
+    coralGetLatencyConfig(&config);
+    if (config.realtimePriority) {
+        coralNoteRealtime(coralThreadSetRealtime());
+    }
+
+    while (ok && !coralAtomicLoad(&stream->stopping)) {
+        if (stream->callback) {
+            frames = (long)stream->callback(stream->block, stream->blockFrames, stream->userData);
+            if (frames > (long)stream->blockFrames) {
+                frames = (long)stream->blockFrames;
+            }
+            if (frames > 0) {
+                ok = coralDeviceWrite(stream->device, stream->block, (size_t)frames * stream->format.blockAlign);
+                coralAtomicStore(&stream->readPos, stream->readPos + (size_t)frames);
+            }
+            if (frames < (long)stream->blockFrames) {
+                break;
+            }
+            continue;
+        }
+
+        frames = pullFromRing(stream, &playing);
+        if (frames < 0) {
+            break;
+        }
+        if (frames > 0) {
+            ok = coralDeviceWrite(stream->device, stream->block, (size_t)frames * stream->format.blockAlign);
+        }
+        else if (!playing || offline) {
+            // Nothing to play yet, and nothing is waiting on a file backend
+            coralSleepMs(RING_IDLE_MS);
+        }
+        else {
+            // Keep the device fed so the gap is a dropout, not a device error
+            coralAtomicStore(&stream->underruns, stream->underruns + 1);
+            memset(stream->block, stream->format.bitsPerSample == 8 ? 0x80 : 0,
+                (size_t)stream->blockFrames * stream->format.blockAlign);
+            ok = coralDeviceWrite(stream->device, stream->block, (size_t)stream->blockFrames * stream->format.blockAlign);
+        }
+    }
+
+    if (ok && coralAtomicLoad(&stream->stopping)) {
+        ok = coralDeviceReset(stream->device);
+    }
+    else if (ok) {
+        ok = coralDeviceDrain(stream->device);
+    }
+    if (ok) {
+        coralDeviceRelease(stream->device, &stream->format);
+    }
+    else {
+        coralDeviceClose(stream->device);
+        coralAtomicStore(&stream->failed, 1);
+    }
+    stream->device = NULL;
+    coralAtomicStore(&stream->ended, 1);
+}
+
+static CoralStream* createStream(uint32_t sampleRate, uint16_t numChannels, CoralSampleFormat format) {
+    CoralStream* stream;
+    uint16_t bytesPerSample;
+
+    if (sampleRate == 0 || numChannels == 0) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Invalid stream format");
+        return NULL;
+    }
+    bytesPerSample = (uint16_t)coralSampleSize(format);
+    if (bytesPerSample == 0 || format == CORAL_SAMPLE_S24_32) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Unsupported stream sample format: %d", (int)format);
+        return NULL;
+    }
+
+    stream = (CoralStream*)malloc(sizeof(CoralStream));
+    if (!stream) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+    memset(stream, 0, sizeof(CoralStream));
+
+    memcpy(stream->format.subChunk1ID, "fmt ", 4);
+    stream->format.subChunk1Size = 16;
+    stream->format.audioFormat = format == CORAL_SAMPLE_F32 ? WAV_FORMAT_IEEE_FLOAT : WAV_FORMAT_PCM;
+    stream->format.numChannels = numChannels;
+    stream->format.sampleRate = sampleRate;
+    stream->format.bitsPerSample = (uint16_t)(bytesPerSample * 8);
+    stream->format.blockAlign = (uint16_t)(numChannels * bytesPerSample);
+    stream->format.byteRate = sampleRate * stream->format.blockAlign;
+    stream->blockFrames = RING_BLOCK_FRAMES;
+
+    stream->block = (uint8_t*)malloc((size_t)RING_BLOCK_FRAMES * stream->format.blockAlign);
+    if (!stream->block) {
+        free(stream);
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+    return stream;
+}
+
+CoralStream* coralStreamCreate(uint32_t sampleRate, uint16_t numChannels, CoralSampleFormat format, size_t capacityFrames) {
+    CoralStream* stream = createStream(sampleRate, numChannels, format);
+
+    if (!stream) {
+        return NULL;
+    }
+    stream->capacity = nextPowerOfTwo(capacityFrames);
+    stream->mask = stream->capacity - 1;
+    stream->ring = (uint8_t*)malloc(stream->capacity * stream->format.blockAlign);
+    if (!stream->ring) {
+        free(stream->block);
+        free(stream);
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+    return stream;
+}
+
+CoralStream* coralStreamCreateCallback(uint32_t sampleRate, uint16_t numChannels, CoralSampleFormat format,
+    CoralStreamCallback callback, void* userData) {
+    CoralStream* stream;
+
+    if (!callback) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null stream callback");
+        return NULL;
+    }
+    stream = createStream(sampleRate, numChannels, format);
+    if (stream) {
+        stream->callback = callback;
+        stream->userData = userData;
+    }
+    return stream;
+}
+
+bool coralStreamStart(CoralStream* stream) {
+    uint32_t period;
+
+    if (!stream) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null stream pointer");
+        return false;
+    }
+    if (stream->started) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Stream already started");
+        return false;
+    }
+
+    stream->device = coralDeviceAcquire(&stream->format);
+    if (!stream->device) {
+        return false;
+    }
+    // Follow a short configured period so the stream adds no latency of its own
+    period = coralDevicePeriodFrames(stream->device);
+    if (period > 0 && period < RING_BLOCK_FRAMES) {
+        stream->blockFrames = period;
+    }
+
+    if (!coralThreadStart(&stream->thread, streamThread, stream)) {
+        coralDeviceClose(stream->device);
+        stream->device = NULL;
+        return false;
+    }
+    stream->started = true;
+    return true;
+}
+
+size_t coralStreamWrite(CoralStream* stream, const void* frames, size_t frameCount) {
+    size_t writePos;
+    size_t space;
+    size_t accepted;
+
+    if (!stream || (!frames && frameCount > 0)) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null stream or frame pointer");
+        return 0;
+    }
+    if (!stream->ring) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Stream is in pull mode");
+        return 0;
+    }
+
+    writePos = stream->writePos;
+    space = stream->capacity - (writePos - coralAtomicLoad(&stream->readPos));
+    accepted = frameCount < space ? frameCount : space;
+    if (accepted > 0) {
+        writeRing(stream, writePos, (const uint8_t*)frames, accepted);
+        coralAtomicStore(&stream->writePos, writePos + accepted);
+    }
+    if (accepted < frameCount) {
+        coralAtomicStore(&stream->dropped, stream->dropped + (frameCount - accepted));
+    }
+    return accepted;
+}
+
+bool coralStreamFinish(CoralStream* stream) {
+    if (!stream) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null stream pointer");
+        return false;
+    }
+    coralAtomicStore(&stream->finishing, 1);
+    return true;
+}
+
+bool coralStreamIsPlaying(const CoralStream* stream) {
+    return stream && stream->started && !coralAtomicLoad(&stream->ended);
+}
+
+void coralStreamGetCounters(const CoralStream* stream, CoralStreamCounters* counters) {
+    size_t readPos;
+
+    if (!stream || !counters) {
+        return;
+    }
+    readPos = coralAtomicLoad(&stream->readPos);
+    counters->capacityFrames = stream->capacity;
+    counters->fillFrames = stream->ring ? coralAtomicLoad(&stream->writePos) - readPos : 0;
+    counters->framesWritten = stream->ring ? coralAtomicLoad(&stream->writePos) : readPos;
+    counters->framesPlayed = readPos;
+    counters->underruns = coralAtomicLoad(&stream->underruns);
+    counters->droppedFrames = coralAtomicLoad(&stream->dropped);
+}
+
+bool coralStreamDestroy(CoralStream* stream) {
+    bool ok = true;
+
+    if (!stream) {
+        return true;
+    }
+    if (stream->started) {
+        // Without a finish the queued audio is discarded
+        if (!coralAtomicLoad(&stream->finishing)) {
+            coralAtomicStore(&stream->stopping, 1);
+        }
+        coralThreadJoin(stream->thread);
+        if (coralAtomicLoad(&stream->failed)) {
+            coralSetError(CORAL_ERROR_DEVICE, "Stream playback failed");
+            ok = false;
+        }
+    }
+    free(stream->ring);
+    free(stream->block);
+    free(stream);
+    return ok;
+}
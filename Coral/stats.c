@@ -0,0 +1,94 @@
+/*
+@file - stats.c
+@developer - ColorProgrammy
+@brief - Load and playback instrumentation.
+@date - 16/10/2026
+@description - Counters and log2 histograms updated with relaxed atomic
+adds from whichever thread does the work. There is no lock anywhere, so
+recording costs a few uncontended atomic instructions and can stay on in
+release builds.
+*/
+
+#include "internal.h"
+
+typedef struct {
+    volatile uint64_t count;
+    volatile uint64_t total;
+    volatile uint64_t maximum;
+    volatile uint64_t buckets[CORAL_HISTOGRAM_BUCKETS];
+} Histogram;
+
+static struct {
+    volatile uint64_t counters[CORAL_COUNTER_COUNT];
+    Histogram histograms[CORAL_HISTOGRAM_COUNT];
+} stats;
+
+void coralCount(CoralCounter counter, uint64_t amount) {
+    coralAtomicAdd64(&stats.counters[counter], amount);
+}
+
+void coralRecord(CoralHistogramId id, uint64_t value) {
+    Histogram* histogram = &stats.histograms[id];
+    uint64_t units = id == CORAL_SIZE_ALLOCATION ? value >> 10 : value / 1000;
+    uint32_t bucket = 0;
+
+    // Bucket i holds values of 2^(i-1) up to 2^i units
+    while (units != 0 && bucket < CORAL_HISTOGRAM_BUCKETS - 1) {
+        units >>= 1;
+        bucket++;
+    }
+    coralAtomicAdd64(&histogram->count, 1);
+    coralAtomicAdd64(&histogram->total, value);
+    coralAtomicMax64(&histogram->maximum, value);
+    coralAtomicAdd64(&histogram->buckets[bucket], 1);
+}
+
+static void readHistogram(CoralHistogramId id, CoralHistogram* out) {
+    const Histogram* histogram = &stats.histograms[id];
+    uint32_t i;
+
+    out->count = coralAtomicLoad64(&histogram->count);
+    out->total = coralAtomicLoad64(&histogram->total);
+    out->maximum = coralAtomicLoad64(&histogram->maximum);
+    for (i = 0; i < CORAL_HISTOGRAM_BUCKETS; ++i) {
+        out->buckets[i] = coralAtomicLoad64(&histogram->buckets[i]);
+    }
+}
+
+void coralGetStats(CoralStats* out) {
+    if (!out) {
+        return;
+    }
+    out->filesLoaded = coralAtomicLoad64(&stats.counters[CORAL_COUNT_FILES_LOADED]);
+    out->loadFailures = coralAtomicLoad64(&stats.counters[CORAL_COUNT_LOAD_FAILURES]);
+    out->bytesRead = coralAtomicLoad64(&stats.counters[CORAL_COUNT_BYTES_READ]);
+    out->bytesMapped = coralAtomicLoad64(&stats.counters[CORAL_COUNT_BYTES_MAPPED]);
+    out->bytesWritten = coralAtomicLoad64(&stats.counters[CORAL_COUNT_BYTES_WRITTEN]);
+    out->xruns = coralAtomicLoad64(&stats.counters[CORAL_COUNT_XRUNS]);
+    out->recoveries = coralAtomicLoad64(&stats.counters[CORAL_COUNT_RECOVERIES]);
+    readHistogram(CORAL_TIME_LOAD, &out->loadTime);
+    readHistogram(CORAL_TIME_PARSE, &out->parseTime);
+    readHistogram(CORAL_TIME_DEVICE_OPEN, &out->deviceOpenTime);
+    readHistogram(CORAL_TIME_WRITE, &out->writeTime);
+    readHistogram(CORAL_TIME_DRAIN, &out->drainTime);
+    readHistogram(CORAL_SIZE_ALLOCATION, &out->allocationSize);
+}
+
+void coralResetStats(void) {
+    Histogram* histogram;
+    uint32_t i;
+    uint32_t j;
+
+    for (i = 0; i < CORAL_COUNTER_COUNT; ++i) {
+        coralAtomicStore64(&stats.counters[i], 0);
+    }
+    for (i = 0; i < CORAL_HISTOGRAM_COUNT; ++i) {
+        histogram = &stats.histograms[i];
+        coralAtomicStore64(&histogram->count, 0);
+        coralAtomicStore64(&histogram->total, 0);
+        coralAtomicStore64(&histogram->maximum, 0);
+        for (j = 0; j < CORAL_HISTOGRAM_BUCKETS; ++j) {
+            coralAtomicStore64(&histogram->buckets[j], 0);
+        }
+    }
+}
@@ -0,0 +1,260 @@
+/*
+@file - stream.c
+@developer - ColorProgrammy
+@brief - Constant-memory playback from disk.
+@date - 16/10/2026
+@description - A reader thread fills a small ring of blocks ahead of the
+device writer, so memory use does not depend on the length of the file.
+Compressed blocks are decoded to 16-bit PCM on their way to the device.
+*/
+
+#include "internal.h"
+
+#define STREAM_BUFFER_COUNT 3
+#define STREAM_BLOCK_BYTES 65536
+#define STREAM_DECODE_FRAMES 4096
+
+typedef struct {
+    FILE* file;
+    uint64_t remaining;         // PCM bytes not yet read from the file
+    uint32_t blockSize;
+
+    uint8_t* blocks[STREAM_BUFFER_COUNT];
+    uint32_t sizes[STREAM_BUFFER_COUNT];
+    int readIndex;              // Next block for the writer
+    int writeIndex;             // Next block for the reader
+    int filled;
+
+    bool finished;              // Reader hit the end of the data chunk
+    bool failed;                // Reader hit an I/O error
+    bool cancelled;             // Writer gave up; reader should exit
+
+    CoralMutex mutex;
+    CoralCond cond;
+} StreamRing;
+
+static void streamReader(void* arg) {
+    StreamRing* ring = (StreamRing*)arg;
+    uint32_t size;
+    uint8_t* block;
+
+    while (1) {
+        coralMutexLock(&ring->mutex);
+        while (ring->filled == STREAM_BUFFER_COUNT && !ring->cancelled) {
+            coralCondWait(&ring->cond, &ring->mutex);
+        }
+        if (ring->cancelled || ring->remaining == 0) {
+            ring->finished = true;
+            coralCondBroadcast(&ring->cond);
+            coralMutexUnlock(&ring->mutex);
+            return;
+        }
+        block = ring->blocks[ring->writeIndex];
+        coralMutexUnlock(&ring->mutex);
+
+        // The block at writeIndex is owned by the reader until it is published
+        size = ring->remaining < ring->blockSize ? (uint32_t)ring->remaining : ring->blockSize;
+        if (fread(block, size, 1, ring->file) != 1) {
+            coralMutexLock(&ring->mutex);
+            ring->failed = true;
+            ring->finished = true;
+            coralCondBroadcast(&ring->cond);
+            coralMutexUnlock(&ring->mutex);
+            return;
+        }
+        ring->remaining -= size;
+        coralCount(CORAL_COUNT_BYTES_READ, size);
+
+        coralMutexLock(&ring->mutex);
+        ring->sizes[ring->writeIndex] = size;
+        ring->writeIndex = (ring->writeIndex + 1) % STREAM_BUFFER_COUNT;
+        ring->filled++;
+        if (ring->remaining == 0) {
+            ring->finished = true;
+        }
+        coralCondBroadcast(&ring->cond);
+        coralMutexUnlock(&ring->mutex);
+    }
+}
+
+bool playWavFileStreamed(const char* filename, CoralStreamStats* stats) {
+    StreamRing ring;
+    WavFile header;
+    WavFormat playback;
+    CoralSampleFormat sampleFormat;
+    CoralDecoder decoder;
+    CoralStreamStats local;
+    CoralThread reader;
+    CoralDevice* device = NULL;
+    uint64_t fillSum = 0;
+    uint64_t frame;
+    size_t take;
+    uint32_t size;
+    uint8_t* block;
+    uint8_t* decoded = NULL;
+    float* samples = NULL;
+    bool started = false;
+    bool ok = true;
+    int i;
+
+    memset(&local, 0, sizeof(local));
+    memset(&ring, 0, sizeof(ring));
+    memset(&header, 0, sizeof(header));
+
+    ring.file = fopen(filename, "rb");
+    if (!ring.file) {
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to open file: %s", filename);
+        return false;
+    }
+    if (!coralReadWavHeaders(ring.file, &header)) {
+        fclose(ring.file);
+        return false;
+    }
+    if (header.wavFormat.blockAlign == 0) {
+        fclose(ring.file);
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Invalid block alignment");
+        return false;
+    }
+    if (!coralPlaybackFormat(&header.wavFormat, &playback, &sampleFormat) || !coralDecoderInit(&decoder, &header)) {
+        fclose(ring.file);
+        return false;
+    }
+
+    ring.remaining = header.dataSize;
+    ring.blockSize = STREAM_BLOCK_BYTES - STREAM_BLOCK_BYTES % header.wavFormat.blockAlign;
+    if (ring.blockSize == 0) {
+        ring.blockSize = header.wavFormat.blockAlign;
+    }
+    // Blocks hold whole compressed blocks, so each decodes on its own
+    if (decoder.codec != CORAL_CODEC_NONE) {
+        decoded = (uint8_t*)malloc((size_t)coralFrameCount(&header.wavFormat, ring.blockSize) * playback.blockAlign);
+        samples = (float*)malloc((size_t)STREAM_DECODE_FRAMES * playback.numChannels * sizeof(float));
+        if (!decoded || !samples) {
+            free(decoded);
+            free(samples);
+            coralDecoderFree(&decoder);
+            fclose(ring.file);
+            coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+            return false;
+        }
+    }
+    for (i = 0; i < STREAM_BUFFER_COUNT; ++i) {
+        ring.blocks[i] = (uint8_t*)malloc(ring.blockSize);
+        if (!ring.blocks[i]) {
+            while (i-- > 0) free(ring.blocks[i]);
+            free(decoded);
+            free(samples);
+            coralDecoderFree(&decoder);
+            fclose(ring.file);
+            coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+            return false;
+        }
+    }
+    coralMutexInit(&ring.mutex);
+    coralCondInit(&ring.cond);
+
+    if (!coralThreadStart(&reader, streamReader, &ring)) {
+        ok = false;
+        goto cleanup;
+    }
+
+    // The device opens while the reader fetches the first block
+    device = coralDeviceAcquire(&playback);
+    if (!device) {
+        ok = false;
+    }
+
+    local.minFillLevel = STREAM_BUFFER_COUNT;
+    while (ok) {
+        coralMutexLock(&ring.mutex);
+        if (ring.filled == 0 && !ring.finished && started) {
+            local.underruns++;
+        }
+        while (ring.filled == 0 && !ring.finished) {
+            coralCondWait(&ring.cond, &ring.mutex);
+        }
+        if (ring.filled == 0) {
+            coralMutexUnlock(&ring.mutex);
+            break;
+        }
+        if (started) {
+            if ((uint32_t)ring.filled < local.minFillLevel) {
+                local.minFillLevel = (uint32_t)ring.filled;
+            }
+            fillSum += (uint32_t)ring.filled;
+        }
+        block = ring.blocks[ring.readIndex];
+        size = ring.sizes[ring.readIndex];
+        coralMutexUnlock(&ring.mutex);
+
+        if (decoder.codec != CORAL_CODEC_NONE) {
+            coralDecoderSetData(&decoder, block, size);
+            for (frame = 0; frame < decoder.frames; frame += take) {
+                take = decoder.frames - frame < STREAM_DECODE_FRAMES ? (size_t)(decoder.frames - frame) : STREAM_DECODE_FRAMES;
+                coralDecoderRead(&decoder, frame, samples, take);
+                coralEncodeFromFloat(samples, decoded + (size_t)frame * playback.blockAlign, CORAL_SAMPLE_S16,
+                    take * playback.numChannels);
+            }
+            block = decoded;
+            size = (uint32_t)(decoder.frames * playback.blockAlign);
+        }
+        if (!coralDeviceWrite(device, block, size)) {
+            ok = false;
+            break;
+        }
+        local.blocksRead++;
+        local.bytesPlayed += size;
+        started = true;
+
+        coralMutexLock(&ring.mutex);
+        ring.readIndex = (ring.readIndex + 1) % STREAM_BUFFER_COUNT;
+        ring.filled--;
+        coralCondBroadcast(&ring.cond);
+        coralMutexUnlock(&ring.mutex);
+    }
+
+    coralMutexLock(&ring.mutex);
+    ring.cancelled = true;
+    if (ring.failed && ok) {
+        coralSetError(CORAL_ERROR_FILE_READ, "Failed to read audio data");
+        ok = false;
+    }
+    coralCondBroadcast(&ring.cond);
+    coralMutexUnlock(&ring.mutex);
+    coralThreadJoin(reader);
+
+    if (ok) {
+        ok = coralDeviceDrain(device);
+    }
+    if (ok) {
+        coralDeviceRelease(device, &playback);
+    }
+    else {
+        coralDeviceClose(device);
+    }
+
+cleanup:
+    coralCondDestroy(&ring.cond);
+    coralMutexDestroy(&ring.mutex);
+    for (i = 0; i < STREAM_BUFFER_COUNT; ++i) {
+        free(ring.blocks[i]);
+    }
+    free(decoded);
+    free(samples);
+    coralDecoderFree(&decoder);
+    fclose(ring.file);
+
+    if (stats) {
+        local.bufferCount = STREAM_BUFFER_COUNT;
+        local.blockSize = ring.blockSize;
+        if (local.blocksRead == 0) {
+            local.minFillLevel = 0;
+        }
+        // The first block is excluded; the writer always waits for it
+        if (local.blocksRead > 1) {
+            local.averageFillLevel = (double)fillSum / (local.blocksRead - 1);
+        }
+        *stats = local;
+    }
+    return ok;
+}
@@ -0,0 +1,296 @@
+/*
+@file - thread.c
+@developer - ColorProgrammy
+@brief - Threading primitives.
+@date - 16/10/2026
+@description - Thin wrappers over Win32 threads and pthreads used by the
+streaming and background playback code.
+*/
+
+#include "internal.h"
+
+#ifndef PLATFORM_WINDOWS
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+typedef struct {
+    CoralThreadFunc func;
+    void* arg;
+} ThreadStart;
+
+#ifdef PLATFORM_WINDOWS
+static DWORD WINAPI threadTrampoline(LPVOID param) {
+#else
+static void* threadTrampoline(void* param) {
+#endif
+    ThreadStart start = *(ThreadStart*)param;
+    free(param);
+    start.func(start.arg);
+    return 0;
+}
+
+bool coralThreadStart(CoralThread* thread, CoralThreadFunc func, void* arg) {
+    ThreadStart* start = (ThreadStart*)malloc(sizeof(ThreadStart));
+    if (!start) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return false;
+    }
+    start->func = func;
+    start->arg = arg;
+
+#ifdef PLATFORM_WINDOWS
+    *thread = CreateThread(NULL, 0, threadTrampoline, start, 0, NULL);
+    if (!*thread) {
+        free(start);
+        coralSetError(CORAL_ERROR_SYSTEM, "Failed to create thread (Error %lu)", GetLastError());
+        return false;
+    }
+#else
+    if (pthread_create(thread, NULL, threadTrampoline, start) != 0) {
+        free(start);
+        coralSetError(CORAL_ERROR_SYSTEM, "Failed to create thread");
+        return false;
+    }
+#endif
+    return true;
+}
+
+void coralThreadJoin(CoralThread thread) {
+#ifdef PLATFORM_WINDOWS
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+bool coralThreadSetRealtime(void) {
+#ifdef PLATFORM_WINDOWS
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+        coralSetError(CORAL_ERROR_SYSTEM, "Failed to raise thread priority (Error %lu)", GetLastError());
+        return false;
+    }
+    return true;
+#else
+    struct sched_param param;
+    int min = sched_get_priority_min(SCHED_FIFO);
+    int max = sched_get_priority_max(SCHED_FIFO);
+
+    // Below the top of the range, which the kernel's own threads use
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = max - min > 10 ? max - 10 : max;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+        coralSetError(CORAL_ERROR_SYSTEM, "Realtime scheduling not permitted");
+        return false;
+    }
+    return true;
+#endif
+}
+
+void coralMutexInit(CoralMutex* mutex) {
+#ifdef PLATFORM_WINDOWS
+    InitializeCriticalSection(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+void coralMutexDestroy(CoralMutex* mutex) {
+#ifdef PLATFORM_WINDOWS
+    DeleteCriticalSection(mutex);
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+void coralMutexLock(CoralMutex* mutex) {
+#ifdef PLATFORM_WINDOWS
+    EnterCriticalSection(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+void coralMutexUnlock(CoralMutex* mutex) {
+#ifdef PLATFORM_WINDOWS
+    LeaveCriticalSection(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+void coralCondInit(CoralCond* cond) {
+#ifdef PLATFORM_WINDOWS
+    InitializeConditionVariable(cond);
+#else
+    pthread_cond_init(cond, NULL);
+#endif
+}
+
+void coralCondDestroy(CoralCond* cond) {
+#ifdef PLATFORM_WINDOWS
+    (void)cond;
+#else
+    pthread_cond_destroy(cond);
+#endif
+}
+
+void coralCondWait(CoralCond* cond, CoralMutex* mutex) {
+#ifdef PLATFORM_WINDOWS
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+#else
+    pthread_cond_wait(cond, mutex);
+#endif
+}
+
+void coralCondSignal(CoralCond* cond) {
+#ifdef PLATFORM_WINDOWS
+    WakeConditionVariable(cond);
+#else
+    pthread_cond_signal(cond);
+#endif
+}
+
+void coralCondBroadcast(CoralCond* cond) {
+#ifdef PLATFORM_WINDOWS
+    WakeAllConditionVariable(cond);
+#else
+    pthread_cond_broadcast(cond);
+#endif
+}
+
+bool coralCondWaitTimeout(CoralCond* cond, CoralMutex* mutex, uint32_t milliseconds) {
+#ifdef PLATFORM_WINDOWS
+    return SleepConditionVariableCS(cond, mutex, milliseconds) != 0;
+#else
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += milliseconds / 1000;
+    deadline.tv_nsec += (long)(milliseconds % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return pthread_cond_timedwait(cond, mutex, &deadline) != ETIMEDOUT;
+#endif
+}
+
+#ifdef PLATFORM_WINDOWS
+static BOOL CALLBACK onceTrampoline(PINIT_ONCE once, PVOID param, PVOID* context) {
+    (void)once;
+    (void)context;
+    ((void (*)(void))param)();
+    return TRUE;
+}
+#endif
+
+void coralCallOnce(CoralOnce* once, void (*func)(void)) {
+#ifdef PLATFORM_WINDOWS
+    InitOnceExecuteOnce(once, onceTrampoline, (PVOID)func, NULL);
+#else
+    pthread_once(once, func);
+#endif
+}
+
+uint64_t coralTimeNs(void) {
+#ifdef PLATFORM_WINDOWS
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+        (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+#endif
+}
+
+void coralSleepMs(uint32_t milliseconds) {
+#ifdef PLATFORM_WINDOWS
+    Sleep(milliseconds);
+#else
+    struct timespec delay;
+
+    delay.tv_sec = milliseconds / 1000;
+    delay.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
+    while (nanosleep(&delay, &delay) != 0 && errno == EINTR) {
+    }
+#endif
+}
+
+size_t coralAtomicLoad(const volatile size_t* value) {
+#ifdef _MSC_VER
+    return (size_t)InterlockedCompareExchangePointer((PVOID volatile*)value, NULL, NULL);
+#else
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void coralAtomicStore(volatile size_t* value, size_t newValue) {
+#ifdef _MSC_VER
+    InterlockedExchangePointer((PVOID volatile*)value, (PVOID)newValue);
+#else
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+#endif
+}
+
+size_t coralAtomicAdd(volatile size_t* value, size_t amount) {
+#if defined(_MSC_VER) && defined(_WIN64)
+    return (size_t)InterlockedExchangeAdd64((volatile LONG64*)value, (LONG64)amount) + amount;
+#elif defined(_MSC_VER)
+    return (size_t)InterlockedExchangeAdd((volatile LONG*)value, (LONG)amount) + amount;
+#else
+    return __atomic_add_fetch(value, amount, __ATOMIC_ACQ_REL);
+#endif
+}
+
+void coralAtomicAdd64(volatile uint64_t* value, uint64_t amount) {
+#ifdef _MSC_VER
+    InterlockedExchangeAdd64((volatile LONG64*)value, (LONG64)amount);
+#else
+    __atomic_fetch_add(value, amount, __ATOMIC_RELAXED);
+#endif
+}
+
+uint64_t coralAtomicLoad64(const volatile uint64_t* value) {
+#ifdef _MSC_VER
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64*)value, 0, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
+#endif
+}
+
+void coralAtomicStore64(volatile uint64_t* value, uint64_t newValue) {
+#ifdef _MSC_VER
+    InterlockedExchange64((volatile LONG64*)value, (LONG64)newValue);
+#else
+    __atomic_store_n(value, newValue, __ATOMIC_RELAXED);
+#endif
+}
+
+void coralAtomicMax64(volatile uint64_t* value, uint64_t candidate) {
+    uint64_t current = coralAtomicLoad64(value);
+
+    while (candidate > current) {
+#ifdef _MSC_VER
+        LONG64 seen = InterlockedCompareExchange64((volatile LONG64*)value, (LONG64)candidate, (LONG64)current);
+        if ((uint64_t)seen == current) {
+            return;
+        }
+        current = (uint64_t)seen;
+#else
+        if (__atomic_compare_exchange_n(value, &current, candidate, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return;
+        }
+#endif
+    }
+}
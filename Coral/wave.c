@@ -6,139 +6,46 @@
 @description - The main code for playing .wav files.
 */
 
-#define _CRT_SECURE_NO_WARNINGS
-#define CORAL_DLL_EXPORTS
-
-#if defined(_MSC_VER) && _MSC_VER < 1900
-#define snprintf _snprintf
-#endif
-
-#include "wave.h"
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-// Platform detection
-#if defined(_WIN32)
-#define PLATFORM_WINDOWS
-#include <windows.h>
-#include <mmsystem.h>
-#pragma comment(lib, "winmm.lib")
-#elif defined(__linux__)
-#define PLATFORM_LINUX
-#elif defined(__APPLE__)
-#define PLATFORM_MACOS
-#include <CoreAudio/CoreAudio.h>
-#include <AudioToolbox/AudioToolbox.h>
-#endif
-
-// Linux audio backend selection
-#ifdef PLATFORM_LINUX
-#define TRY_PULSE_AUDIO
-
-#define TRY_ALSA
-#if !defined(TRY_PULSE_AUDIO) && !defined(TRY_ALSA)
-#error "Please define either TRY_PULSE_AUDIO or TRY_ALSA for Linux"
+#include "internal.h"
+#include <stdarg.h>
+
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
-#ifdef TRY_PULSE_AUDIO
-#include <pulse/simple.h>
-#include <pulse/error.h>
-#endif
+// loadWavFile maps data larger than this, and reads the rest in slices of LOAD_READ_BYTES
+#define LOAD_MAP_BYTES ((uint64_t)1 << 30)
+#define LOAD_READ_BYTES ((size_t)1 << 26)
+#define EXPAND_BLOCK_FRAMES 4096
 
-#ifdef TRY_ALSA
-#include <alsa/asoundlib.h>
-#endif
+#ifdef _MSC_VER
+#define CORAL_THREAD_LOCAL __declspec(thread)
+#else
+#define CORAL_THREAD_LOCAL __thread
 #endif
 
-static char lastError[256] = { 0 };
+// Each thread sees only its own failures
+static CORAL_THREAD_LOCAL char lastError[256];
+static CORAL_THREAD_LOCAL CoralError lastErrorCode;
 
 const char* getAudioError() {
     return lastError;
 }
 
-bool adjustVolume(WavFile* wavFile, float volumeFactor) {
-    uint16_t bitsPerSample;
-    uint32_t dataSize;
-    uint8_t* data;
-    uint32_t bytesPerSample;
-    uint32_t numSamples;
-    uint32_t i;
-    uint8_t* samplePtr;
-    uint8_t sample8;
-    int16_t sample16;
-    int32_t sample32;
-    int16_t adjusted16;
-    int32_t adjusted32;
-    int64_t adjusted64;
-
-    if (!wavFile) {
-        snprintf(lastError, sizeof(lastError), "Null WAV file pointer");
-        return false;
-    }
-    if (wavFile->wavFormat.audioFormat != 1) {
-        snprintf(lastError, sizeof(lastError), "Volume adjustment only supports PCM format");
-        return false;
-    }
-
-    bitsPerSample = wavFile->wavFormat.bitsPerSample;
-    dataSize = wavFile->wavData.subChunk2Size;
-    data = wavFile->data;
-
-    if (bitsPerSample % 8 != 0) {
-        snprintf(lastError, sizeof(lastError), "Unsupported bits per sample: %d", bitsPerSample);
-        return false;
-    }
-
-    bytesPerSample = bitsPerSample / 8;
-    numSamples = dataSize / bytesPerSample;
-
-    for (i = 0; i < numSamples; ++i) {
-        samplePtr = data + i * bytesPerSample;
-
-        switch (bitsPerSample) {
-        case 8:
-            sample8 = *samplePtr;
-            adjusted16 = (int16_t)((sample8 - 128) * volumeFactor) + 128;
-            if (adjusted16 < 0) adjusted16 = 0;
-            else if (adjusted16 > 255) adjusted16 = 255;
-            *samplePtr = (uint8_t)adjusted16;
-            break;
-        case 16:
-            sample16 = *(int16_t*)samplePtr;
-            adjusted32 = (int32_t)(sample16 * volumeFactor);
-            if (adjusted32 > INT16_MAX) adjusted32 = INT16_MAX;
-            else if (adjusted32 < INT16_MIN) adjusted32 = INT16_MIN;
-            *(int16_t*)samplePtr = (int16_t)adjusted32;
-            break;
-        case 24:
-            sample32 = 0;
-            memcpy(&sample32, samplePtr, 3);
-            if (sample32 & 0x00800000) {
-                sample32 |= 0xFF000000;
-            }
-            else {
-                sample32 &= 0x00FFFFFF;
-            }
-            sample32 = (int32_t)(sample32 * volumeFactor);
-            if (sample32 > 0x007FFFFF) sample32 = 0x007FFFFF;
-            else if (sample32 < (int32_t)0xFF800000) sample32 = (int32_t)0xFF800000;
-            memcpy(samplePtr, &sample32, 3);
-            break;
-        case 32:
-            sample32 = *(int32_t*)samplePtr;
-            adjusted64 = (int64_t)(sample32 * volumeFactor);
-            if (adjusted64 > INT32_MAX) adjusted64 = INT32_MAX;
-            else if (adjusted64 < INT32_MIN) adjusted64 = INT32_MIN;
-            *(int32_t*)samplePtr = (int32_t)adjusted64;
-            break;
-        default:
-            snprintf(lastError, sizeof(lastError), "Unsupported bits per sample: %d", bitsPerSample);
-            return false;
-        }
-    }
+CoralError coralGetLastError(void) {
+    return lastErrorCode;
+}
 
-    return true;
+void coralSetError(CoralError code, const char* format, ...) {
+    va_list args;
+    lastErrorCode = code;
+    va_start(args, format);
+    vsnprintf(lastError, sizeof(lastError), format, args);
+    va_end(args);
+    lastError[sizeof(lastError) - 1] = '\0';
 }
 
 WavMetadata getWavMetadata(const WavFile* wavFile) {
@@ -153,117 +60,191 @@ WavMetadata getWavMetadata(const WavFile* wavFile) {
     metadata.numChannels = wavFile->wavFormat.numChannels;
     metadata.bitsPerSample = wavFile->wavFormat.bitsPerSample;
 
-    if (metadata.sampleRate > 0 && 
-        metadata.numChannels > 0 && 
-        metadata.bitsPerSample >= 8 && 
-        wavFile->wavData.subChunk2Size > 0) {
-        
-        double bytesPerSample = metadata.bitsPerSample / 8.0;
-        double bytesPerSecond = metadata.sampleRate * metadata.numChannels * bytesPerSample;
-        
-        if (bytesPerSecond > 0) {
-            metadata.duration = (double)wavFile->wavData.subChunk2Size / bytesPerSecond;
-        }
+    if (metadata.sampleRate > 0 && metadata.numChannels > 0) {
+        metadata.duration = (double)coralFrameCount(&wavFile->wavFormat, coralWavDataSize(wavFile)) / metadata.sampleRate;
     }
     
     return metadata;
 }
 
-WavFile* loadWavFile(const char* filename) {
+// Size of the WAVE_FORMAT_EXTENSIBLE extension including its cbSize field
+#define FORMAT_EXTENSION_SIZE 24
+
+// Resolves the fmt chunk extension. WAVE_FORMAT_EXTENSIBLE is reduced to the
+// PCM or float tag of its subformat so the rest of the library only ever sees
+// plain format tags; the valid bit count and channel mask are kept aside.
+bool coralApplyFormatExtension(WavFile* wavFile, const uint8_t* extra, size_t extraSize) {
+    // KSDATAFORMAT_SUBTYPE_* GUIDs share everything but the leading format tag
+    static const uint8_t subformatBase[14] = {
+        0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+    };
+    WavFormat* format = &wavFile->wavFormat;
+    uint16_t validBits;
+    uint16_t subformat;
+
+    wavFile->channelMask = 0;
+    wavFile->validBitsPerSample = format->bitsPerSample;
+    if (format->audioFormat != WAV_FORMAT_EXTENSIBLE) {
+        return coralCheckFormat(format, extra, extraSize);
+    }
+
+    if (extraSize < FORMAT_EXTENSION_SIZE || (extra[0] | extra[1] << 8) < FORMAT_EXTENSION_SIZE - 2) {
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Truncated WAVE_FORMAT_EXTENSIBLE chunk");
+        return false;
+    }
+    validBits = (uint16_t)(extra[2] | extra[3] << 8);
+    subformat = (uint16_t)(extra[8] | extra[9] << 8);
+    if (memcmp(extra + 10, subformatBase, sizeof(subformatBase)) != 0 ||
+        (subformat != WAV_FORMAT_PCM && subformat != WAV_FORMAT_IEEE_FLOAT)) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Unsupported WAVE_FORMAT_EXTENSIBLE subformat");
+        return false;
+    }
+
+    format->audioFormat = subformat;
+    if (validBits > 0 && validBits <= format->bitsPerSample) {
+        wavFile->validBitsPerSample = validBits;
+    }
+    wavFile->channelMask = (uint32_t)extra[4] | (uint32_t)extra[5] << 8 |
+        (uint32_t)extra[6] << 16 | (uint32_t)extra[7] << 24;
+    return coralCheckFormat(format, NULL, 0);
+}
+
+void coralApplySamplerChunk(WavFile* wavFile, const uint8_t* payload, size_t size) {
+    uint32_t loopCount;
+    uint32_t start;
+    uint32_t end;
+
+    // 36 bytes of sampler fields, then 24 bytes per loop
+    if (size < SAMPLER_CHUNK_BYTES) {
+        return;
+    }
+    memcpy(&loopCount, payload + 28, 4);
+    memcpy(&start, payload + 44, 4);
+    memcpy(&end, payload + 48, 4);
+    if (loopCount > 0 && end >= start) {
+        wavFile->loopStart = start;
+        wavFile->loopEnd = (uint64_t)end + 1;     // smpl loop ends are inclusive
+    }
+}
+
+void coralCheckLoop(WavFile* wavFile) {
+    uint64_t frames = coralFrameCount(&wavFile->wavFormat, coralWavDataSize(wavFile));
+
+    if (wavFile->loopStart >= wavFile->loopEnd || wavFile->loopEnd > frames) {
+        wavFile->loopStart = 0;
+        wavFile->loopEnd = 0;
+    }
+}
+
+uint64_t coralWavDataSize(const WavFile* wavFile) {
+    return wavFile->dataSize > 0 ? wavFile->dataSize : wavFile->wavData.subChunk2Size;
+}
+
+static bool readFileAt(void* source, uint64_t offset, void* buffer, size_t size) {
+    FILE* file = (FILE*)source;
+    return coralSeek(file, (int64_t)offset, SEEK_SET) == 0 && fread(buffer, 1, size, file) == size;
+}
+
+bool coralReadWavHeaders(FILE* file, WavFile* wavFile) {
+    CoralWavLayout layout;
+    int64_t fileSize;
+
+    memset(&layout, 0, sizeof(layout));
+    if (coralSeek(file, 0, SEEK_END) != 0 || (fileSize = (int64_t)coralTell(file)) < 0) {
+        coralSetError(CORAL_ERROR_FILE_READ, "Failed to read WAV headers");
+        return false;
+    }
+    if (!coralParseWav(readFileAt, file, (uint64_t)fileSize, wavFile, &layout)) {
+        return false;
+    }
+    if (layout.truncated) {
+        coralSetError(CORAL_ERROR_FILE_READ, "Failed to read audio data");
+        return false;
+    }
+    if (coralSeek(file, (int64_t)layout.dataOffset, SEEK_SET) != 0) {
+        coralSetError(CORAL_ERROR_FILE_READ, "Failed to read audio data");
+        return false;
+    }
+    return true;
+}
+
+static WavFile* allocWavFile(void) {
+    WavFile* wavFile = (WavFile*)coralAlloc(sizeof(WavFile));
+
+    if (wavFile) {
+        memset(wavFile, 0, sizeof(WavFile));
+        wavFile->ownership = WAV_OWNS_STRUCT;
+    }
+    return wavFile;
+}
+
+static void noteLoad(uint64_t start, const WavFile* wavFile) {
+    if (wavFile) {
+        coralCount(CORAL_COUNT_FILES_LOADED, 1);
+        coralRecord(CORAL_TIME_LOAD, coralTimeNs() - start);
+    }
+    else {
+        coralCount(CORAL_COUNT_LOAD_FAILURES, 1);
+    }
+}
+
+static bool attachMapping(WavFile* wavFile, const char* filename, uint64_t dataOffset);
+
+static WavFile* readWavFile(const char* filename) {
     FILE* file = NULL;
     WavFile* wavFile = NULL;
-    size_t readResult;
-    int memcmpResult1, memcmpResult2, memcmpResult3;
-    uint32_t chunkSize;
-    char chunkID[4];
-    long dataStartPos;
+    uint64_t parseStart;
+    uint64_t dataOffset;
+    uint64_t dataSize;
+    size_t done;
+    size_t size;
 
     file = fopen(filename, "rb");
     if (!file) {
-        snprintf(lastError, sizeof(lastError), "Failed to open file: %s", filename);
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to open file: %s", filename);
         return NULL;
     }
 
-    wavFile = (WavFile*)malloc(sizeof(WavFile));
+    wavFile = allocWavFile();
     if (!wavFile) {
         fclose(file);
-        snprintf(lastError, sizeof(lastError), "Memory allocation failed");
         return NULL;
     }
-    memset(wavFile, 0, sizeof(WavFile));  // Initialize to zero
-
-    // Read RIFF header
-    readResult = fread(&wavFile->riffHeader, sizeof(RiffHeader), 1, file);
-    if (readResult != 1) {
-        snprintf(lastError, sizeof(lastError), "Invalid WAV file header");
-        goto error;
-    }
 
-    // Validate RIFF header
-    memcmpResult1 = memcmp(wavFile->riffHeader.chunkID, "RIFF", 4);
-    memcmpResult2 = memcmp(wavFile->riffHeader.format, "WAVE", 4);
-    if (memcmpResult1 != 0 || memcmpResult2 != 0) {
-        snprintf(lastError, sizeof(lastError), "Not a valid WAV file");
+    parseStart = coralTimeNs();
+    if (!coralReadWavHeaders(file, wavFile)) {
         goto error;
     }
+    coralRecord(CORAL_TIME_PARSE, coralTimeNs() - parseStart);
+    dataOffset = (uint64_t)coralTell(file);
+    dataSize = wavFile->dataSize;
 
-    // Read format chunk
-    readResult = fread(&wavFile->wavFormat, sizeof(WavFormat), 1, file);
-    if (readResult != 1) {
-        snprintf(lastError, sizeof(lastError), "Invalid format chunk");
-        goto error;
-    }
-
-    // Validate format chunk
-    memcmpResult3 = memcmp(wavFile->wavFormat.subChunk1ID, "fmt ", 4);
-    if (memcmpResult3 != 0) {
-        snprintf(lastError, sizeof(lastError), "Format chunk missing");
-        goto error;
-    }
-
-    // Skip any extra format bytes
-    if (wavFile->wavFormat.subChunk1Size > 16) {
-        uint32_t extraBytes = wavFile->wavFormat.subChunk1Size - 16;
-        fseek(file, extraBytes, SEEK_CUR);
-    }
-
-    // Find the data chunk
-    while (1) {
-        readResult = fread(chunkID, 4, 1, file);
-        readResult += fread(&chunkSize, 4, 1, file);
-        
-        if (readResult != 2) {
-            snprintf(lastError, sizeof(lastError), "Failed to find data chunk");
+    // Big recordings are mapped instead of copied into one huge allocation;
+    // the headers just read stay in place
+    if (dataSize > LOAD_MAP_BYTES) {
+        fclose(file);
+        file = NULL;
+        if (!attachMapping(wavFile, filename, dataOffset)) {
             goto error;
         }
-
-        if (memcmp(chunkID, "data", 4) == 0) {
-            wavFile->wavData.subChunk2ID[0] = 'd';
-            wavFile->wavData.subChunk2ID[1] = 'a';
-            wavFile->wavData.subChunk2ID[2] = 't';
-            wavFile->wavData.subChunk2ID[3] = 'a';
-            wavFile->wavData.subChunk2Size = chunkSize;
-            dataStartPos = ftell(file);
-            break;
-        }
-        
-        // Skip unknown chunks
-        fseek(file, chunkSize, SEEK_CUR);
+        return wavFile;
     }
 
     // Allocate and read audio data
-    wavFile->data = (uint8_t*)malloc(wavFile->wavData.subChunk2Size);
+    wavFile->data = (uint8_t*)coralAllocSamples((size_t)dataSize);
     if (!wavFile->data) {
-        snprintf(lastError, sizeof(lastError), "Memory allocation failed for audio data");
         goto error;
     }
+    wavFile->ownership |= WAV_OWNS_DATA;
 
-    fseek(file, dataStartPos, SEEK_SET);
-    readResult = fread(wavFile->data, wavFile->wavData.subChunk2Size, 1, file);
-    if (readResult != 1) {
-        snprintf(lastError, sizeof(lastError), "Failed to read audio data");
-        goto error;
+    for (done = 0; done < dataSize; done += size) {
+        size = (size_t)(dataSize - done < LOAD_READ_BYTES ? dataSize - done : LOAD_READ_BYTES);
+        if (fread(wavFile->data + done, 1, size, file) != size) {
+            coralSetError(CORAL_ERROR_FILE_READ, "Failed to read audio data");
+            goto error;
+        }
     }
+    coralCount(CORAL_COUNT_BYTES_READ, dataOffset + dataSize);
 
     fclose(file);
     return wavFile;
@@ -274,248 +255,620 @@ error:
     return NULL;
 }
 
-bool playWavFile(WavFile* wavFile) {
-#ifdef PLATFORM_WINDOWS
-    HWAVEOUT hWaveOut;
-    WAVEFORMATEX wfx;
-    WAVEHDR waveHdr;
-    MMRESULT result;
-#elif defined(PLATFORM_MACOS)
-    AudioComponentInstance audioUnit;
-    OSStatus status;
-    AudioStreamBasicDescription audioFormat;
-    AudioBufferList bufferList;
-    AudioComponentDescription desc;
-#elif defined(PLATFORM_LINUX) && defined(TRY_PULSE_AUDIO)
-    pa_simple *s;
-    int error;
-    pa_sample_spec ss;
-#elif defined(PLATFORM_LINUX) && defined(TRY_ALSA)
-    snd_pcm_t *pcm_handle;
-    int err;
-    snd_pcm_hw_params_t *hw_params;
-    snd_pcm_uframes_t frames;
-    const uint8_t *data_ptr;
-    int frames_written;
-    snd_pcm_format_t format;
-    unsigned int sample_rate;
-#endif
+WavFile* loadWavFile(const char* filename) {
+    uint64_t start = coralTimeNs();
+    WavFile* wavFile = readWavFile(filename);
 
-    if (!wavFile) {
-        snprintf(lastError, sizeof(lastError), "Null WAV file pointer");
+    noteLoad(start, wavFile);
+    return wavFile;
+}
+
+typedef struct {
+    const uint8_t* bytes;
+    size_t size;
+} WavImage;
+
+static bool readImageAt(void* source, uint64_t offset, void* buffer, size_t size) {
+    const WavImage* image = (const WavImage*)source;
+
+    if (offset > image->size || image->size - offset < size) {
         return false;
     }
+    memcpy(buffer, image->bytes + offset, size);
+    return true;
+}
 
+// Parses the headers of a WAV image held in memory. On success *dataOffset
+// is the offset of the PCM payload inside the image.
+static bool parseWavImage(WavFile* wavFile, const uint8_t* bytes, size_t imageSize, size_t* dataOffset) {
+    CoralWavLayout layout;
+    WavImage image;
+
+    memset(&layout, 0, sizeof(layout));
+    image.bytes = bytes;
+    image.size = imageSize;
+    if (!coralParseWav(readImageAt, &image, imageSize, wavFile, &layout)) {
+        return false;
+    }
+    if (layout.truncated) {
+        coralSetError(CORAL_ERROR_FILE_READ, "Failed to read audio data");
+        return false;
+    }
+    *dataOffset = (size_t)layout.dataOffset;
+    return true;
+}
+
+// Maps a whole file copy-on-write, so in-place edits such as adjustVolume
+// never reach the file and untouched pages stay shared with other processes.
+static void* mapWholeFile(const char* filename, size_t* mappedSize) {
 #ifdef PLATFORM_WINDOWS
-    ZeroMemory(&wfx, sizeof(WAVEFORMATEX));
-    wfx.wFormatTag = WAVE_FORMAT_PCM;
-    wfx.nChannels = wavFile->wavFormat.numChannels;
-    wfx.nSamplesPerSec = wavFile->wavFormat.sampleRate;
-    wfx.nAvgBytesPerSec = wavFile->wavFormat.byteRate;
-    wfx.nBlockAlign = wavFile->wavFormat.blockAlign;
-    wfx.wBitsPerSample = wavFile->wavFormat.bitsPerSample;
-    wfx.cbSize = 0;
+    HANDLE file;
+    HANDLE mapping;
+    LARGE_INTEGER fileSize;
+    void* base;
+
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to open file: %s", filename);
+        return NULL;
+    }
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Invalid WAV file header");
+        return NULL;
+    }
+    if ((unsigned long long)fileSize.QuadPart > (size_t)-1) {
+        CloseHandle(file);
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "File is too large for this address space; use playWavFileStreamed");
+        return NULL;
+    }
 
-    ZeroMemory(&waveHdr, sizeof(WAVEHDR));
-    waveHdr.lpData = (LPSTR)wavFile->data;
-    waveHdr.dwBufferLength = wavFile->wavData.subChunk2Size;
-    waveHdr.dwFlags = 0;
+    mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) {
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to map file: %s (Error %lu)", filename, GetLastError());
+        return NULL;
+    }
 
-    result = waveOutOpen(&hWaveOut, WAVE_MAPPER, &wfx, 0, 0, CALLBACK_NULL);
-    if (result != MMSYSERR_NOERROR) {
-        snprintf(lastError, sizeof(lastError), "Failed to open audio device (Error %d)", result);
-        return false;
+    // The view keeps the mapping object alive after the handle is closed
+    base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!base) {
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to map file: %s (Error %lu)", filename, GetLastError());
+        return NULL;
     }
 
-    result = waveOutPrepareHeader(hWaveOut, &waveHdr, sizeof(WAVEHDR));
-    if (result != MMSYSERR_NOERROR) {
-        waveOutClose(hWaveOut);
-        snprintf(lastError, sizeof(lastError), "Failed to prepare header (Error %d)", result);
-        return false;
+    *mappedSize = (size_t)fileSize.QuadPart;
+    return base;
+
+#elif defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)
+    int fd;
+    struct stat st;
+    void* base;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to open file: %s", filename);
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        coralSetError(CORAL_ERROR_INVALID_FORMAT, "Invalid WAV file header");
+        return NULL;
+    }
+    if ((unsigned long long)st.st_size > (size_t)-1) {
+        close(fd);
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "File is too large for this address space; use playWavFileStreamed");
+        return NULL;
     }
 
-    result = waveOutWrite(hWaveOut, &waveHdr, sizeof(WAVEHDR));
-    if (result != MMSYSERR_NOERROR) {
-        waveOutUnprepareHeader(hWaveOut, &waveHdr, sizeof(WAVEHDR));
-        waveOutClose(hWaveOut);
-        snprintf(lastError, sizeof(lastError), "Failed to play audio (Error %d)", result);
-        return false;
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to map file: %s", filename);
+        return NULL;
     }
 
-    // Wait for playback to complete
-    while ((waveHdr.dwFlags & WHDR_DONE) == 0) {
-        Sleep(100);
+#ifdef MADV_SEQUENTIAL
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+
+    *mappedSize = (size_t)st.st_size;
+    return base;
+
+#else
+    (void)filename;
+    (void)mappedSize;
+    coralSetError(CORAL_ERROR_UNSUPPORTED, "Memory-mapped loading is not supported on this platform");
+    return NULL;
+#endif
+}
+
+static void unmapWholeFile(void* base, size_t mappedSize) {
+#ifdef PLATFORM_WINDOWS
+    (void)mappedSize;
+    UnmapViewOfFile(base);
+#elif defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)
+    munmap(base, mappedSize);
+#else
+    (void)base;
+    (void)mappedSize;
+#endif
+}
+
+// Frees or unmaps the samples the way they were obtained. Files built by
+// hand with malloc keep working, since they leave ownership at 0.
+static void releaseSampleData(WavFile* wavFile) {
+    if (wavFile->mappedBase) {
+        unmapWholeFile(wavFile->mappedBase, wavFile->mappedSize);
+        wavFile->mappedBase = NULL;
+        wavFile->mappedSize = 0;
     }
+    else if (wavFile->ownership & WAV_OWNS_DATA) {
+        coralFreeSamples(wavFile->data);
+    }
+    else {
+        free(wavFile->data);
+    }
+    wavFile->data = NULL;
+    wavFile->ownership &= (uint8_t)~WAV_OWNS_DATA;
+}
 
-    result = waveOutUnprepareHeader(hWaveOut, &waveHdr, sizeof(WAVEHDR));
-    if (result != MMSYSERR_NOERROR) {
-        waveOutClose(hWaveOut);
-        snprintf(lastError, sizeof(lastError), "Failed to unprepare header (Error %d)", result);
+// Starts asynchronous readahead of the PCM payload so the first
+// playback pass does not fault on every page.
+static void prefetchMappedRange(void* base, size_t offset, size_t length) {
+#if (defined(PLATFORM_LINUX) || defined(PLATFORM_MACOS)) && defined(MADV_WILLNEED)
+    long pageSize = sysconf(_SC_PAGESIZE);
+    size_t pageOffset;
+
+    if (pageSize <= 0 || length == 0) {
+        return;
+    }
+    pageOffset = offset - offset % (size_t)pageSize;
+    madvise((uint8_t*)base + pageOffset, length + (offset - pageOffset), MADV_WILLNEED);
+#else
+    (void)base;
+    (void)offset;
+    (void)length;
+#endif
+}
+
+// Points the samples into the mapping, counting it and starting readahead
+static void useMappedData(WavFile* wavFile, size_t dataOffset) {
+    coralCount(CORAL_COUNT_BYTES_MAPPED, wavFile->mappedSize);
+    wavFile->data = (uint8_t*)wavFile->mappedBase + dataOffset;
+    prefetchMappedRange(wavFile->mappedBase, dataOffset, (size_t)wavFile->dataSize);
+}
+
+// Maps a file whose headers were already read from dataOffset on
+static bool attachMapping(WavFile* wavFile, const char* filename, uint64_t dataOffset) {
+    wavFile->mappedBase = mapWholeFile(filename, &wavFile->mappedSize);
+    if (!wavFile->mappedBase) {
         return false;
     }
-
-    waveOutClose(hWaveOut);
+    // The file may have shrunk since its headers were read
+    if (dataOffset > wavFile->mappedSize || wavFile->dataSize > wavFile->mappedSize - dataOffset) {
+        coralSetError(CORAL_ERROR_FILE_READ, "Failed to read audio data");
+        return false;
+    }
+    useMappedData(wavFile, (size_t)dataOffset);
     return true;
+}
 
-#elif defined(PLATFORM_MACOS)
-    desc.componentType = kAudioUnitType_Output;
-    desc.componentSubType = kAudioUnitSubType_DefaultOutput;
-    desc.componentManufacturer = kAudioUnitManufacturer_Apple;
-    desc.componentFlags = 0;
-    desc.componentFlagsMask = 0;
+static WavFile* mapWavFile(const char* filename) {
+    WavFile* wavFile = NULL;
+    void* base;
+    size_t mappedSize = 0;
+    size_t dataOffset = 0;
+    uint64_t parseStart;
 
-    status = AudioComponentInstanceNew(AudioComponentFindNext(NULL, &desc), &audioUnit);
-    if (status != noErr) {
-        snprintf(lastError, sizeof(lastError), "Failed to create audio unit (Error %d)", (int)status);
-        return false;
+    base = mapWholeFile(filename, &mappedSize);
+    if (!base) {
+        return NULL;
     }
 
-    audioFormat.mSampleRate = wavFile->wavFormat.sampleRate;
-    audioFormat.mFormatID = kAudioFormatLinearPCM;
-    audioFormat.mFormatFlags = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked;
-    audioFormat.mBytesPerPacket = wavFile->wavFormat.blockAlign;
-    audioFormat.mFramesPerPacket = 1;
-    audioFormat.mBytesPerFrame = wavFile->wavFormat.blockAlign;
-    audioFormat.mChannelsPerFrame = wavFile->wavFormat.numChannels;
-    audioFormat.mBitsPerChannel = wavFile->wavFormat.bitsPerSample;
+    wavFile = allocWavFile();
+    if (!wavFile) {
+        unmapWholeFile(base, mappedSize);
+        return NULL;
+    }
+    wavFile->mappedBase = base;
+    wavFile->mappedSize = mappedSize;
 
-    status = AudioUnitSetProperty(audioUnit,
-        kAudioUnitProperty_StreamFormat,
-        kAudioUnitScope_Input,
-        0,
-        &audioFormat,
-        sizeof(audioFormat));
-    if (status != noErr) {
-        AudioComponentInstanceDispose(audioUnit);
-        snprintf(lastError, sizeof(lastError), "Failed to set audio format (Error %d)", (int)status);
-        return false;
+    parseStart = coralTimeNs();
+    if (!parseWavImage(wavFile, (const uint8_t*)base, mappedSize, &dataOffset)) {
+        freeWavFile(wavFile);
+        return NULL;
     }
+    coralRecord(CORAL_TIME_PARSE, coralTimeNs() - parseStart);
+    useMappedData(wavFile, dataOffset);
+    return wavFile;
+}
 
-    bufferList.mNumberBuffers = 1;
-    bufferList.mBuffers[0].mNumberChannels = audioFormat.mChannelsPerFrame;
-    bufferList.mBuffers[0].mDataByteSize = wavFile->wavData.subChunk2Size;
-    bufferList.mBuffers[0].mData = wavFile->data;
+WavFile* loadWavFileMapped(const char* filename) {
+    uint64_t start = coralTimeNs();
+    WavFile* wavFile = mapWavFile(filename);
 
-    status = AudioUnitRender(audioUnit, NULL, kAudioUnitRenderAction_OutputData, 0, 0, &bufferList);
-    AudioComponentInstanceDispose(audioUnit);
+    noteLoad(start, wavFile);
+    return wavFile;
+}
 
-    if (status != noErr) {
-        snprintf(lastError, sizeof(lastError), "Failed to render audio (Error %d)", (int)status);
+// Decodes a compressed payload into dst, a block of frames at a time
+static bool expandSamples(const WavFile* wavFile, uint8_t* dst, CoralSampleFormat format) {
+    CoralDecoder decoder;
+    uint16_t channels = wavFile->wavFormat.numChannels;
+    size_t stride = channels * coralSampleSize(format);
+    uint64_t frame;
+    size_t take;
+    float* block;
+
+    if (!coralDecoderInit(&decoder, wavFile)) {
         return false;
     }
-
+    block = (float*)malloc((size_t)EXPAND_BLOCK_FRAMES * channels * sizeof(float));
+    if (!block) {
+        coralDecoderFree(&decoder);
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return false;
+    }
+    for (frame = 0; frame < decoder.frames; frame += take) {
+        take = decoder.frames - frame < EXPAND_BLOCK_FRAMES ? (size_t)(decoder.frames - frame) : EXPAND_BLOCK_FRAMES;
+        coralDecoderRead(&decoder, frame, block, take);
+        coralEncodeFromFloat(block, dst + (size_t)frame * stride, format, take * channels);
+    }
+    free(block);
+    coralDecoderFree(&decoder);
     return true;
+}
 
-#elif defined(PLATFORM_LINUX) && defined(TRY_PULSE_AUDIO)
-    ss.format = PA_SAMPLE_S16LE;
-    ss.rate = wavFile->wavFormat.sampleRate;
-    ss.channels = wavFile->wavFormat.numChannels;
+bool coralConvertWavFile(WavFile* wavFile, CoralSampleFormat format) {
+    WavFormat* wavFormat;
+    CoralSampleFormat current;
+    CoralCodec codec;
+    uint32_t sampleSize;
+    uint64_t samples;
+    size_t count;
+    size_t bytes;
+    uint8_t* converted;
 
-    s = pa_simple_new(NULL, "WAV Player", PA_STREAM_PLAYBACK, NULL, "Playback", &ss, NULL, NULL, &error);
-    if (!s) {
-        snprintf(lastError, sizeof(lastError), "PulseAudio error: %s", pa_strerror(error));
+    if (!wavFile || !wavFile->data) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null WAV file pointer");
         return false;
     }
-
-    if (pa_simple_write(s, wavFile->data, wavFile->wavData.subChunk2Size, &error) < 0) {
-        pa_simple_free(s);
-        snprintf(lastError, sizeof(lastError), "PulseAudio write error: %s", pa_strerror(error));
+    if (wavFile->ownership & WAV_IS_VIEW) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Cannot convert a view; convert its source");
         return false;
     }
+    wavFormat = &wavFile->wavFormat;
+    codec = coralCodecOf(wavFormat);
+    if (codec == CORAL_CODEC_NONE && !coralSampleFormatOf(wavFormat, &current)) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Unsupported sample format: %d-bit, format tag %d",
+            wavFormat->bitsPerSample, wavFormat->audioFormat);
+        return false;
+    }
+    sampleSize = coralSampleSize(format);
+    if (sampleSize == 0 || format == CORAL_SAMPLE_S24_32) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "No WAV layout for sample format %d", (int)format);
+        return false;
+    }
+    if (codec == CORAL_CODEC_NONE && format == current) {
+        return true;
+    }
 
-    if (pa_simple_drain(s, &error) < 0) {
-        pa_simple_free(s);
-        snprintf(lastError, sizeof(lastError), "PulseAudio drain error: %s", pa_strerror(error));
+    // Compressed files expand to as many samples as they decode to
+    samples = codec != CORAL_CODEC_NONE ?
+        coralFrameCount(wavFormat, coralWavDataSize(wavFile)) * wavFormat->numChannels :
+        coralWavDataSize(wavFile) / (wavFormat->bitsPerSample / 8);
+    if (samples > (size_t)-1 / sampleSize) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Converted audio does not fit in memory");
         return false;
     }
+    count = (size_t)samples;
+    bytes = count * sampleSize;
+    converted = (uint8_t*)coralAllocSamples(bytes);
+    if (!converted) {
+        return false;
+    }
+    if (codec != CORAL_CODEC_NONE) {
+        if (!expandSamples(wavFile, converted, format)) {
+            coralFreeSamples(converted);
+            return false;
+        }
+    }
+    else {
+        coralConvertSamples(wavFile->data, current, converted, format, count);
+    }
+
+    // The converted copy replaces either the heap buffer or the mapping
+    releaseSampleData(wavFile);
+    wavFile->data = converted;
+    wavFile->ownership |= WAV_OWNS_DATA;
 
-    pa_simple_free(s);
+    wavFormat->subChunk1Size = 16;
+    wavFormat->audioFormat = format == CORAL_SAMPLE_F32 ? WAV_FORMAT_IEEE_FLOAT : WAV_FORMAT_PCM;
+    wavFormat->bitsPerSample = (uint16_t)(sampleSize * 8);
+    wavFormat->blockAlign = (uint16_t)(wavFormat->numChannels * sampleSize);
+    wavFormat->byteRate = wavFormat->sampleRate * wavFormat->blockAlign;
+    wavFile->wavData.subChunk2Size = bytes > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)bytes;
+    wavFile->dataSize = bytes;
+    wavFile->validBitsPerSample = wavFormat->bitsPerSample;
     return true;
+}
+
+bool coralRemixWavFile(WavFile* wavFile, const CoralChannelMatrix* matrix, uint32_t outputLayout) {
+    WavFormat* wavFormat;
+    WavFormat playback;
+    CoralSampleFormat format;
+    CoralDecoder decoder;
+    CoralChannelMatrix* preset = NULL;
+    uint32_t inputLayout;
+    uint32_t sampleSize;
+    uint16_t outputs;
+    uint64_t frames;
+    uint64_t frame;
+    size_t take;
+    size_t bytes;
+    uint8_t* remixed;
+    float* input;
+    float* output;
 
-#elif defined(PLATFORM_LINUX) && defined(TRY_ALSA)
-    if ((err = snd_pcm_open(&pcm_handle, "default", SND_PCM_STREAM_PLAYBACK, 0)) < 0) {
-        snprintf(lastError, sizeof(lastError), "ALSA open error: %s", snd_strerror(err));
+    if (!wavFile || !wavFile->data) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null WAV file pointer");
         return false;
     }
-
-    snd_pcm_hw_params_alloca(&hw_params);
-
-    if ((err = snd_pcm_hw_params_any(pcm_handle, hw_params)) < 0) {
-        snd_pcm_close(pcm_handle);
-        snprintf(lastError, sizeof(lastError), "ALSA init error: %s", snd_strerror(err));
+    if (wavFile->ownership & WAV_IS_VIEW) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Cannot remix a view; remix its source");
+        return false;
+    }
+    wavFormat = &wavFile->wavFormat;
+    // Compressed files are remixed into the 16-bit PCM they play as
+    if (!coralPlaybackFormat(wavFormat, &playback, &format)) {
+        return false;
+    }
+    if (format == CORAL_SAMPLE_S24_32) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Unsupported sample format: %d-bit, format tag %d",
+            wavFormat->bitsPerSample, wavFormat->audioFormat);
+        return false;
+    }
+    // Blocks are stepped through by blockAlign but decoded by channel count
+    if (!coralCheckFormat(wavFormat, NULL, 0)) {
         return false;
     }
 
-    if ((err = snd_pcm_hw_params_set_access(pcm_handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
-        snd_pcm_close(pcm_handle);
-        snprintf(lastError, sizeof(lastError), "ALSA access error: %s", snd_strerror(err));
+    if (!matrix) {
+        inputLayout = wavFile->channelMask != 0 ? wavFile->channelMask : coralDefaultChannelLayout(wavFormat->numChannels);
+        if (inputLayout == 0 || outputLayout == 0) {
+            coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "No speaker layout for %d channels; pass a matrix",
+                wavFormat->numChannels);
+            return false;
+        }
+        preset = coralChannelMatrixCreateLayout(inputLayout, outputLayout);
+        if (!preset) {
+            return false;
+        }
+        matrix = preset;
+    }
+    outputs = coralChannelMatrixOutputs(matrix);
+    if (coralChannelMatrixInputs(matrix) != wavFormat->numChannels) {
+        coralChannelMatrixDestroy(preset);
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Matrix takes %d channels; the file has %d",
+            coralChannelMatrixInputs(matrix), wavFormat->numChannels);
+        return false;
+    }
+    if (outputLayout != 0 && coralLayoutChannels(outputLayout) != outputs) {
+        coralChannelMatrixDestroy(preset);
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Layout 0x%x does not name %d channels", (unsigned)outputLayout, outputs);
         return false;
     }
 
-    switch (wavFile->wavFormat.bitsPerSample) {
-    case 8:  format = SND_PCM_FORMAT_U8; break;
-    case 16: format = SND_PCM_FORMAT_S16_LE; break;
-    case 24: format = SND_PCM_FORMAT_S24_LE; break;
-    case 32: format = SND_PCM_FORMAT_S32_LE; break;
-    default:
-        snd_pcm_close(pcm_handle);
-        snprintf(lastError, sizeof(lastError), "Unsupported bit depth: %d", wavFile->wavFormat.bitsPerSample);
+    sampleSize = coralSampleSize(format);
+    frames = coralFrameCount(wavFormat, coralWavDataSize(wavFile));
+    if (frames > (size_t)-1 / ((size_t)outputs * sampleSize)) {
+        coralChannelMatrixDestroy(preset);
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Remixed audio does not fit in memory");
+        return false;
+    }
+    if (!coralDecoderInit(&decoder, wavFile)) {
+        coralChannelMatrixDestroy(preset);
+        return false;
+    }
+    bytes = (size_t)frames * outputs * sampleSize;
+    remixed = (uint8_t*)coralAllocSamples(bytes);
+    input = (float*)malloc((size_t)EXPAND_BLOCK_FRAMES * wavFormat->numChannels * sizeof(float));
+    output = (float*)malloc((size_t)EXPAND_BLOCK_FRAMES * outputs * sizeof(float));
+    if (!remixed || !input || !output) {
+        coralFreeSamples(remixed);
+        free(input);
+        free(output);
+        coralDecoderFree(&decoder);
+        coralChannelMatrixDestroy(preset);
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
         return false;
     }
 
-    if ((err = snd_pcm_hw_params_set_format(pcm_handle, hw_params, format)) < 0) {
-        snd_pcm_close(pcm_handle);
-        snprintf(lastError, sizeof(lastError), "ALSA format error: %s", snd_strerror(err));
+    // One cache-sized block at a time: decode, remix, encode
+    for (frame = 0; frame < frames; frame += take) {
+        take = frames - frame < EXPAND_BLOCK_FRAMES ? (size_t)(frames - frame) : EXPAND_BLOCK_FRAMES;
+        if (decoder.codec != CORAL_CODEC_NONE) {
+            coralDecoderRead(&decoder, frame, input, take);
+        }
+        else {
+            coralDecodeToFloat(wavFile->data + (size_t)frame * wavFormat->blockAlign, format, input, take * wavFormat->numChannels);
+        }
+        coralChannelMatrixProcess(matrix, input, output, take);
+        coralEncodeFromFloat(output, remixed + (size_t)frame * outputs * sampleSize, format, take * outputs);
+    }
+    free(input);
+    free(output);
+    coralDecoderFree(&decoder);
+    coralChannelMatrixDestroy(preset);
+
+    releaseSampleData(wavFile);
+    wavFile->data = remixed;
+    wavFile->ownership |= WAV_OWNS_DATA;
+    if (coralCodecOf(wavFormat) != CORAL_CODEC_NONE) {
+        wavFormat->subChunk1Size = 16;
+        wavFormat->audioFormat = WAV_FORMAT_PCM;
+        wavFormat->bitsPerSample = 16;
+        wavFile->validBitsPerSample = 16;
+    }
+    wavFormat->numChannels = outputs;
+    wavFormat->blockAlign = (uint16_t)(outputs * sampleSize);
+    wavFormat->byteRate = wavFormat->sampleRate * wavFormat->blockAlign;
+    wavFile->wavData.subChunk2Size = bytes > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)bytes;
+    wavFile->dataSize = bytes;
+    wavFile->channelMask = outputLayout;
+    return true;
+}
+
+bool playWavFile(WavFile* wavFile) {
+    CoralDevice* device;
+    bool ok;
+
+    if (!wavFile) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null WAV file pointer");
         return false;
     }
+    if (coralCodecOf(&wavFile->wavFormat) != CORAL_CODEC_NONE) {
+        // The mixer decodes block by block; the file stays compressed
+        return playWavFileWithGain(wavFile, 1.0f);
+    }
 
-    sample_rate = wavFile->wavFormat.sampleRate;
-    if ((err = snd_pcm_hw_params_set_rate_near(pcm_handle, hw_params, &sample_rate, 0)) < 0) {
-        snd_pcm_close(pcm_handle);
-        snprintf(lastError, sizeof(lastError), "ALSA rate error: %s", snd_strerror(err));
+    device = coralDeviceAcquire(&wavFile->wavFormat);
+    if (!device) {
         return false;
     }
 
-    if ((err = snd_pcm_hw_params_set_channels(pcm_handle, hw_params, wavFile->wavFormat.numChannels)) < 0) {
-        snd_pcm_close(pcm_handle);
-        snprintf(lastError, sizeof(lastError), "ALSA channels error: %s", snd_strerror(err));
+    ok = coralDeviceWrite(device, wavFile->data, (size_t)coralWavDataSize(wavFile)) &&
+        coralDeviceDrain(device);
+    if (ok) {
+        coralDeviceRelease(device, &wavFile->wavFormat);
+    }
+    else {
+        coralDeviceClose(device);
+    }
+    return ok;
+}
+
+bool playWavFileWithGain(const WavFile* wavFile, float gain) {
+    CoralSampleFormat sampleFormat;
+    WavFormat playback;
+    CoralMixer* mixer;
+    bool ok;
+
+    if (!wavFile) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null WAV file pointer");
+        return false;
+    }
+    if (!coralPlaybackFormat(&wavFile->wavFormat, &playback, &sampleFormat)) {
         return false;
     }
 
-    if ((err = snd_pcm_hw_params(pcm_handle, hw_params)) < 0) {
-        snd_pcm_close(pcm_handle);
-        snprintf(lastError, sizeof(lastError), "ALSA apply params error: %s", snd_strerror(err));
+    // A one-voice mix applies the gain block by block on the way to the device
+    mixer = coralMixerCreate(wavFile->wavFormat.sampleRate, wavFile->wavFormat.numChannels, sampleFormat);
+    if (!mixer) {
         return false;
     }
+    ok = coralMixerAddVoice(mixer, wavFile, gain, 0.0f) != 0 && coralMixerPlay(mixer);
+    coralMixerDestroy(mixer);
+    return ok;
+}
 
-    frames = snd_pcm_bytes_to_frames(pcm_handle, wavFile->wavData.subChunk2Size);
-    data_ptr = wavFile->data;
+bool coralWavView(const WavFile* wavFile, uint64_t firstFrame, uint64_t frameCount, WavFile* view) {
+    uint64_t frames;
+    uint64_t blockFrames;
+    uint64_t offset;
+    uint64_t size;
+    uint16_t blockAlign;
 
-    while (frames > 0) {
-        frames_written = snd_pcm_writei(pcm_handle, data_ptr, frames);
-        if (frames_written < 0) {
-            snd_pcm_recover(pcm_handle, frames_written, 0);
-            continue;
-        }
-        data_ptr += frames_written * wavFile->wavFormat.blockAlign;
-        frames -= frames_written;
+    if (!wavFile || !wavFile->data || !view) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null WAV file or view pointer");
+        return false;
+    }
+    blockAlign = wavFile->wavFormat.blockAlign;
+    frames = coralFrameCount(&wavFile->wavFormat, coralWavDataSize(wavFile));
+    if (firstFrame > frames || frameCount > frames - firstFrame) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Frame range %llu+%llu is outside the %llu frames of the file",
+            (unsigned long long)firstFrame, (unsigned long long)frameCount, (unsigned long long)frames);
+        return false;
     }
 
-    snd_pcm_drain(pcm_handle);
-    snd_pcm_close(pcm_handle);
+    // IMA ADPCM frames are only reachable from the start of their block, so
+    // a view takes whole blocks, ending on a block boundary or with the file
+    blockFrames = coralFrameCount(&wavFile->wavFormat, blockAlign);
+    if (coralCodecOf(&wavFile->wavFormat) == CORAL_CODEC_IMA_ADPCM) {
+        if (firstFrame % blockFrames != 0 || (frameCount % blockFrames != 0 && firstFrame + frameCount != frames)) {
+            coralSetError(CORAL_ERROR_UNSUPPORTED,
+                "IMA ADPCM views must cover whole blocks of %llu frames; expand the file with coralConvertWavFile",
+                (unsigned long long)blockFrames);
+            return false;
+        }
+        offset = firstFrame / blockFrames * blockAlign;
+        size = firstFrame + frameCount == frames ? coralWavDataSize(wavFile) - offset : frameCount / blockFrames * blockAlign;
+    }
+    else {
+        offset = firstFrame * blockAlign;
+        size = frameCount * blockAlign;
+    }
+
+    *view = *wavFile;
+    view->data = wavFile->data + (size_t)offset;
+    view->dataSize = size;
+    view->wavData.subChunk2Size = view->dataSize > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)view->dataSize;
+    view->mappedBase = NULL;
+    view->mappedSize = 0;
+    view->ownership = WAV_IS_VIEW;
+    if (wavFile->loopEnd > wavFile->loopStart && wavFile->loopStart >= firstFrame &&
+        wavFile->loopEnd <= firstFrame + frameCount) {
+        view->loopStart = wavFile->loopStart - firstFrame;
+        view->loopEnd = wavFile->loopEnd - firstFrame;
+    }
+    else {
+        view->loopStart = 0;
+        view->loopEnd = 0;
+    }
     return true;
-#endif
+}
+
+bool playWavFileLooped(const WavFile* wavFile, uint64_t loopStart, uint64_t loopEnd, uint32_t repeats) {
+    CoralSampleFormat sampleFormat;
+    WavFormat playback;
+    CoralMixer* mixer;
+    CoralVoice voice;
+    bool ok;
+
+    if (!wavFile) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null WAV file pointer");
+        return false;
+    }
+    if (repeats == CORAL_LOOP_FOREVER) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Blocking playback needs a finite loop count");
+        return false;
+    }
+    if (!coralPlaybackFormat(&wavFile->wavFormat, &playback, &sampleFormat)) {
+        return false;
+    }
 
-    snprintf(lastError, sizeof(lastError), "Unsupported platform");
-    return false;
+    // The mixer stitches the wrap into whole blocks, so the device never sees a short write
+    mixer = coralMixerCreate(wavFile->wavFormat.sampleRate, wavFile->wavFormat.numChannels, sampleFormat);
+    if (!mixer) {
+        return false;
+    }
+    voice = coralMixerAddVoice(mixer, wavFile, 1.0f, 0.0f);
+    ok = voice != 0 && coralMixerLoopVoice(mixer, voice, loopStart, loopEnd, repeats) && coralMixerPlay(mixer);
+    coralMixerDestroy(mixer);
+    return ok;
 }
 
 void freeWavFile(WavFile* wavFile) {
-    if (wavFile) {
-        if (wavFile->data) {
-            free(wavFile->data);
-            wavFile->data = NULL;
+    if (wavFile && !(wavFile->ownership & WAV_IS_VIEW)) {
+        releaseSampleData(wavFile);
+        if (wavFile->ownership & WAV_OWNS_STRUCT) {
+            coralFree(wavFile, sizeof(WavFile));
+        }
+        else {
+            free(wavFile);
         }
-        free(wavFile);
     }
 }
\ No newline at end of file
@@ -9,6 +9,7 @@ typedef signed char int8_t;
 typedef signed short int16_t;
 typedef signed long int32_t;
 typedef signed __int64 int64_t;
+typedef unsigned __int64 uint64_t;
 #define INT16_MIN (-32768)
 #define INT16_MAX 32767
 #define INT32_MIN (-2147483647-1)
@@ -16,6 +17,7 @@ typedef signed __int64 int64_t;
 #else
 #include <stdint.h>
 #endif
+#include <stddef.h>
 
 #ifndef __cplusplus
 #if !defined(__STDC_VERSION__) || __STDC_VERSION__ < 199901L
@@ -67,6 +69,14 @@ typedef struct {
     WavFormat wavFormat;
     WavData wavData;
     uint8_t* data;
+    void* mappedBase;               // Set by loadWavFileMapped; data points into this mapping
+    size_t mappedSize;
+    uint32_t channelMask;           // Speaker positions from WAVE_FORMAT_EXTENSIBLE, 0 if not given
+    uint16_t validBitsPerSample;    // Significant bits per sample; equals bitsPerSample unless EXTENSIBLE says otherwise
+    uint8_t ownership;              // Which parts freeWavFile returns to the Coral allocator; 0 for plain malloc
+    uint64_t loopStart;             // First loop of the smpl chunk in frames, end exclusive; both 0 when there is none
+    uint64_t loopEnd;
+    uint64_t dataSize;              // Bytes in data. The 32-bit header sizes saturate for RF64 and Wave64 files past 4 GiB
 } WavFile;
 
 typedef struct {
@@ -76,16 +86,611 @@ typedef struct {
     double duration;
 } WavMetadata;
 
+#define CORAL_MAX_CHUNKS 32
+
+// File layouts Coral reads
+typedef enum {
+    CORAL_CONTAINER_RIFF = 0,   // Classic WAV, up to 4 GiB
+    CORAL_CONTAINER_RF64,       // RF64 or BW64, with 64-bit sizes in a ds64 chunk
+    CORAL_CONTAINER_WAVE64      // Sony Wave64; chunk ids are the first four bytes of their GUIDs
+} CoralContainer;
+
+typedef struct {
+    char id[4];                 // e.g. "fmt ", "data", "LIST", "cue ", "smpl"
+    uint64_t offset;            // File offset of the chunk payload, past its 8-byte header
+    uint64_t size;              // Payload size, clamped to the end of the file
+} CoralChunkInfo;
+
+// Everything probeWavFile learns from the headers alone
+typedef struct {
+    WavMetadata metadata;
+    CoralContainer container;
+    WavFormat format;           // Format tag already resolved from WAVE_FORMAT_EXTENSIBLE
+    uint32_t channelMask;
+    uint16_t validBitsPerSample;
+    uint64_t fileSize;
+    uint64_t dataOffset;        // Where the first PCM byte is
+    uint64_t dataSize;
+    uint64_t frames;
+    uint64_t loopStart;         // As in WavFile
+    uint64_t loopEnd;
+    uint32_t chunkCount;        // Chunks in the file; only the first CORAL_MAX_CHUNKS are listed
+    CoralChunkInfo chunks[CORAL_MAX_CHUNKS];
+} CoralWavInfo;
+
+typedef struct {
+    uint64_t bytesPlayed;
+    uint32_t blocksRead;
+    uint32_t bufferCount;       // Blocks in the read-ahead ring
+    uint32_t blockSize;         // Bytes per block
+    uint32_t underruns;         // Times the writer had to wait for the reader
+    uint32_t minFillLevel;      // Fewest filled blocks seen by the writer
+    double averageFillLevel;    // Mean filled blocks seen by the writer
+} CoralStreamStats;
+
+typedef struct {
+    uint64_t opens;             // Devices opened from scratch
+    uint64_t reuses;            // Requests served by an already open device
+    uint64_t closes;            // Idle devices closed by timeout, flush or eviction
+    uint64_t openTimeNs;        // Total time spent opening devices
+    uint32_t idleDevices;       // Devices currently parked in the pool
+} CoralDevicePoolStats;
+
+// Identifies a sound started with playWavFileAsync. 0 is never a valid handle.
+typedef uint32_t CoralHandle;
+
+// Called on the audio thread once the last block of a sound has been handed
+// to the device (completed = true) or the sound was stopped or failed.
+typedef void (*CoralCompletionCallback)(CoralHandle handle, bool completed, void* userData);
+
+typedef enum {
+    CORAL_OK = 0,
+    CORAL_ERROR_INVALID_ARGUMENT,
+    CORAL_ERROR_OUT_OF_MEMORY,
+    CORAL_ERROR_FILE_OPEN,
+    CORAL_ERROR_FILE_READ,
+    CORAL_ERROR_FILE_WRITE,
+    CORAL_ERROR_INVALID_FORMAT,     // Malformed or not a WAV file
+    CORAL_ERROR_UNSUPPORTED,        // Valid input the library cannot handle
+    CORAL_ERROR_DEVICE,             // Audio output failure
+    CORAL_ERROR_SYSTEM,             // Thread or event creation failed
+    CORAL_ERROR_BUSY,               // A limit was reached, the engine is shutting down or the object is in use
+    CORAL_ERROR_INVALID_HANDLE      // Sound, voice or bank entry not known
+} CoralError;
+
+typedef struct {
+    uint64_t hits;              // Acquires served from the bank
+    uint64_t misses;            // Acquires that had to load the file
+    uint64_t evictions;         // Unreferenced entries dropped for the budget
+    size_t residentBytes;       // Memory held by cached files
+    size_t budgetBytes;
+    uint32_t entries;
+} CoralBankStats;
+
+typedef enum {
+    CORAL_SAMPLE_U8 = 0,
+    CORAL_SAMPLE_S16,
+    CORAL_SAMPLE_S24,           // Packed, three bytes per sample
+    CORAL_SAMPLE_S24_32,        // 24 bits in the low bytes of a 32-bit word
+    CORAL_SAMPLE_S32,
+    CORAL_SAMPLE_F32,           // IEEE float, nominally [-1, 1]
+    CORAL_SAMPLE_FORMAT_COUNT
+} CoralSampleFormat;
+
+// Where output devices send their audio. Everything but CORAL_BACKEND_DEVICE
+// renders faster than real time.
+typedef enum {
+    CORAL_BACKEND_DEVICE = 0,   // Platform audio output
+    CORAL_BACKEND_NULL,         // Discards the audio
+    CORAL_BACKEND_MEMORY,       // Appends to a buffer, see coralGetRenderBuffer
+    CORAL_BACKEND_WAV_FILE,     // Writes a WAV file
+    CORAL_BACKEND_RAW_FILE      // Writes headerless PCM
+} CoralBackend;
+
+typedef struct {
+    uint64_t frames;            // Frames written since the stats were reset
+    uint64_t bytes;
+    uint64_t writes;            // Blocks handed to the backend
+    uint64_t opens;             // Devices opened on the backend
+    uint64_t elapsedNs;         // From the first device open to the last write
+    double framesPerSecond;
+} CoralRenderStats;
+
+#define CORAL_HISTOGRAM_BUCKETS 32
+
+// Times are in nanoseconds and sizes in bytes. Bucket 0 counts values under
+// one microsecond (one KiB for sizes), bucket i values from 2^(i-1) up to
+// 2^i of those units, and the last bucket everything larger.
+typedef struct {
+    uint64_t count;
+    uint64_t total;
+    uint64_t maximum;
+    uint64_t buckets[CORAL_HISTOGRAM_BUCKETS];
+} CoralHistogram;
+
+typedef struct {
+    uint64_t filesLoaded;
+    uint64_t loadFailures;
+    uint64_t bytesRead;             // By loads, probes and streamed playback
+    uint64_t bytesMapped;           // Files opened with loadWavFileMapped
+    CoralHistogram loadTime;        // Whole load calls
+    CoralHistogram parseTime;       // Header parsing within loads and probes
+    CoralHistogram allocationSize;  // Sample buffers
+    CoralHistogram deviceOpenTime;
+    CoralHistogram writeTime;       // Each write to an output device
+    uint64_t bytesWritten;
+    uint64_t xruns;                 // Device underruns reported by the backend
+    uint64_t recoveries;            // Underruns and suspends recovered from
+    CoralHistogram drainTime;
+} CoralStats;
+
+#define CORAL_ANALYSIS_CHANNELS 8
+
+typedef struct {
+    float peak;                 // Largest absolute sample, 1.0 = full scale
+    float rms;
+    float dcOffset;             // Mean sample value
+    uint64_t clippedSamples;    // Samples at full scale
+} CoralChannelAnalysis;
+
+typedef struct {
+    float peak;                 // Over all channels
+    float rms;
+    float dcOffset;
+    uint64_t clippedSamples;
+    uint64_t soundStart;        // First frame with a sample above the silence threshold
+    uint64_t soundEnd;          // One past the last such frame; 0 when the file is silent
+    uint64_t frames;
+    uint16_t channelCount;      // Entries filled in channels
+    CoralChannelAnalysis channels[CORAL_ANALYSIS_CHANNELS];
+} CoralAnalysis;
+
+// Min/max overview of a file at power-of-two zoom levels
+typedef struct CoralWaveform CoralWaveform;
+
+typedef struct {
+    uint64_t frames;
+    uint32_t sampleRate;
+    uint16_t channels;
+    uint32_t baseFrames;        // Frames per bucket at the finest level
+    uint32_t levels;
+} CoralWaveformInfo;
+
+// Memory for WavFile structs and sample data. allocate must return memory
+// aligned to at least alignment bytes; release gets the size that was asked for.
+typedef struct {
+    void* (*allocate)(size_t size, size_t alignment, void* userData);
+    void (*release)(void* pointer, size_t size, void* userData);
+    void* userData;
+} CoralAllocator;
+
+typedef struct {
+    uint64_t allocations;       // Sample buffers handed out
+    uint64_t poolHits;          // Of those, served by a recycled buffer
+    size_t liveBytes;           // In sample buffers currently handed out
+    size_t pooledBytes;         // In freed buffers kept for reuse
+    size_t budgetBytes;
+} CoralSamplePoolStats;
+
+// Loop repeats that never run out; stop the sound or change the loop to end it
+#define CORAL_LOOP_FOREVER 0xFFFFFFFFu
+
+// Software mixer. Voices are identified by CoralVoice; 0 is never valid.
+typedef struct CoralMixer CoralMixer;
+typedef uint32_t CoralVoice;
+
+// Streaming sample rate converter for interleaved float audio
+typedef struct CoralResampler CoralResampler;
+
+// Speaker positions: the bits of a WAVE_FORMAT_EXTENSIBLE channel mask,
+// which also fix the order of the channels in a frame
+#define CORAL_SPEAKER_FRONT_LEFT 0x1u
+#define CORAL_SPEAKER_FRONT_RIGHT 0x2u
+#define CORAL_SPEAKER_FRONT_CENTER 0x4u
+#define CORAL_SPEAKER_LOW_FREQUENCY 0x8u
+#define CORAL_SPEAKER_BACK_LEFT 0x10u
+#define CORAL_SPEAKER_BACK_RIGHT 0x20u
+#define CORAL_SPEAKER_FRONT_LEFT_OF_CENTER 0x40u
+#define CORAL_SPEAKER_FRONT_RIGHT_OF_CENTER 0x80u
+#define CORAL_SPEAKER_BACK_CENTER 0x100u
+#define CORAL_SPEAKER_SIDE_LEFT 0x200u
+#define CORAL_SPEAKER_SIDE_RIGHT 0x400u
+#define CORAL_SPEAKER_TOP_CENTER 0x800u
+#define CORAL_SPEAKER_TOP_FRONT_LEFT 0x1000u
+#define CORAL_SPEAKER_TOP_FRONT_CENTER 0x2000u
+#define CORAL_SPEAKER_TOP_FRONT_RIGHT 0x4000u
+#define CORAL_SPEAKER_TOP_BACK_LEFT 0x8000u
+#define CORAL_SPEAKER_TOP_BACK_CENTER 0x10000u
+#define CORAL_SPEAKER_TOP_BACK_RIGHT 0x20000u
+
+#define CORAL_LAYOUT_MONO CORAL_SPEAKER_FRONT_CENTER
+#define CORAL_LAYOUT_STEREO (CORAL_SPEAKER_FRONT_LEFT | CORAL_SPEAKER_FRONT_RIGHT)
+#define CORAL_LAYOUT_QUAD (CORAL_LAYOUT_STEREO | CORAL_SPEAKER_BACK_LEFT | CORAL_SPEAKER_BACK_RIGHT)
+#define CORAL_LAYOUT_5_1 (CORAL_LAYOUT_QUAD | CORAL_SPEAKER_FRONT_CENTER | CORAL_SPEAKER_LOW_FREQUENCY)
+#define CORAL_LAYOUT_7_1 (CORAL_LAYOUT_5_1 | CORAL_SPEAKER_SIDE_LEFT | CORAL_SPEAKER_SIDE_RIGHT)
+
+// Channel matrix for interleaved float frames
+typedef struct CoralChannelMatrix CoralChannelMatrix;
+
+// Effect chain for interleaved float frames. Nodes run in the order they
+// were added, numbered from 0, over blocks of CORAL_EFFECT_BLOCK_FRAMES.
+typedef struct CoralEffectChain CoralEffectChain;
+
+#define CORAL_EFFECT_BLOCK_FRAMES 256
+
+typedef enum {
+    CORAL_BIQUAD_LOWPASS = 0,
+    CORAL_BIQUAD_HIGHPASS,
+    CORAL_BIQUAD_BANDPASS,      // 0 dB at the centre
+    CORAL_BIQUAD_NOTCH,
+    CORAL_BIQUAD_PEAK,
+    CORAL_BIQUAD_LOW_SHELF,
+    CORAL_BIQUAD_HIGH_SHELF
+} CoralBiquadType;
+
+typedef struct {
+    CoralBiquadType type;
+    float frequency;            // Hz; cutoff, centre or shelf midpoint
+    float q;                    // 0.7071 gives a Butterworth response
+    float gainDb;               // Peak and shelf bands only
+} CoralBiquadBand;
+
+typedef struct {
+    float thresholdDb;
+    float ratio;                // 4 = 4:1; at least 1
+    float kneeDb;               // Width of the soft knee; 0 = hard
+    float attackMs;
+    float releaseMs;
+    float makeupDb;
+} CoralCompressorConfig;
+
+typedef struct {
+    float ceilingDb;            // No output sample goes above it; at most 0
+    float lookaheadMs;          // Delay that lets the gain fall before a peak arrives
+    float releaseMs;
+} CoralLimiterConfig;
+
+typedef struct {
+    uint64_t blocks;            // Blocks the node processed
+    uint64_t frames;
+    uint64_t totalNs;           // Time spent inside the node
+    uint64_t maxBlockNs;        // Slowest single block
+} CoralEffectStats;
+
+typedef enum {
+    CORAL_RESAMPLE_FAST = 0,    // 16 taps, for previews and voice
+    CORAL_RESAMPLE_MEDIUM,      // 32 taps, transparent for most material
+    CORAL_RESAMPLE_HIGH         // 64 taps, for mastering
+} CoralResampleQuality;
+
+// Output buffering. Fields left 0 keep the backend default; a target
+// latency alone is split into two periods.
+typedef struct {
+    uint32_t targetLatencyUs;   // Audio queued ahead of the speaker
+    uint32_t periodFrames;      // Frames the device takes per wakeup
+    uint32_t periodCount;       // Periods in the device buffer
+    bool realtimePriority;      // Run the asynchronous playback thread at realtime priority
+} CoralLatencyConfig;
+
+typedef struct {
+    uint32_t sampleRate;        // Of the device last measured
+    uint32_t periodFrames;      // Granted by the backend; 0 if unknown
+    uint32_t bufferFrames;
+    uint64_t measuredLatencyUs; // Last reading of the queued audio from the backend
+    bool realtimeGranted;
+} CoralLatencyInfo;
+
+// Plays audio as it is produced. Fill level is the frames queued in the
+// ring; an underrun is a block of silence played because the ring was empty.
+typedef struct CoralStream CoralStream;
+
+// Writes a WAV file a block at a time, see coralWriterOpen
+typedef struct CoralWriter CoralWriter;
+
+// Fills output with up to frames frames on the audio thread and returns the
+// number written. Returning fewer ends the stream after they have played.
+typedef size_t (*CoralStreamCallback)(void* output, size_t frames, void* userData);
+
+typedef struct {
+    size_t capacityFrames;
+    size_t fillFrames;
+    size_t framesWritten;
+    size_t framesPlayed;        // Handed to the device
+    size_t underruns;
+    size_t droppedFrames;       // Refused by coralStreamWrite because the ring was full
+} CoralStreamCounters;
+
+// How a gain change moves from the old to the new value. Exponential ramps
+// change by the same number of decibels per frame, bottoming out at -80 dB.
+typedef enum {
+    CORAL_RAMP_LINEAR = 0,
+    CORAL_RAMP_EXPONENTIAL
+} CoralRampShape;
+
+typedef enum {
+    CORAL_SIMD_SCALAR = 0,
+    CORAL_SIMD_SSE2,
+    CORAL_SIMD_AVX2,
+    CORAL_SIMD_NEON
+} CoralSimdLevel;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+    // Files may hold IMA ADPCM, A-law or mu-law as well as PCM and float.
+    // Compressed files load and play compressed; playback decodes them a
+    // block at a time.
     CORAL_API WavFile* loadWavFile(const char* filename);
+    CORAL_API WavFile* loadWavFileMapped(const char* filename);
     CORAL_API bool playWavFile(WavFile* wavFile);
+    // Plays at the given gain without touching the samples
+    CORAL_API bool playWavFileWithGain(const WavFile* wavFile, float gain);
+    CORAL_API bool playWavFileStreamed(const char* filename, CoralStreamStats* stats);
     CORAL_API void freeWavFile(WavFile* wavFile);
+
+    // Fills view with a WavFile over a frame range of another, sharing its
+    // samples. A view works wherever a WavFile does (play, mix, analyze,
+    // adjustVolume, which writes through to the source), needs no freeing
+    // and is valid while the source is. Loop points inside the range carry over.
+    // IMA ADPCM views cover whole blocks: they start on a block boundary and
+    // end on one or at the end of the file.
+    CORAL_API bool coralWavView(const WavFile* wavFile, uint64_t firstFrame, uint64_t frameCount, WavFile* view);
+
+    // Plays up to loopEnd, jumps back to loopStart repeats times, then plays
+    // on to the end. Frames are exact and the wrap adds no gap. A loop of
+    // 0, 0 takes the file's smpl loop, or the whole file when it has none.
+    CORAL_API bool playWavFileLooped(const WavFile* wavFile, uint64_t loopStart, uint64_t loopEnd, uint32_t repeats);
+
+    // Non-blocking playback on a shared audio thread. The WavFile must stay
+    // alive until the sound has finished. Do not call coralWait from a callback.
+    CORAL_API CoralHandle playWavFileAsync(const WavFile* wavFile, CoralCompletionCallback callback, void* userData);
+    CORAL_API CoralHandle playWavFileAsyncWithGain(const WavFile* wavFile, float gain, CoralCompletionCallback callback, void* userData);
+    // Changes the gain of a playing sound over rampFrames frames (0 = at once)
+    CORAL_API bool coralSetGain(CoralHandle handle, float gain, uint32_t rampFrames, CoralRampShape shape);
+    // Looping as in playWavFileLooped; repeats may be CORAL_LOOP_FOREVER.
+    // coralSetLoop replaces the remaining repeats, so 0 lets a looping sound
+    // play out its tail.
+    CORAL_API CoralHandle playWavFileAsyncLooped(const WavFile* wavFile, uint64_t loopStart, uint64_t loopEnd, uint32_t repeats,
+        CoralCompletionCallback callback, void* userData);
+    CORAL_API bool coralSetLoop(CoralHandle handle, uint64_t loopStart, uint64_t loopEnd, uint32_t repeats);
+    // True once the sound has played to the end. False if it was stopped or
+    // the handle was never issued; a sound whose slot was since reused counts as finished.
+    CORAL_API bool coralWait(CoralHandle handle);
+    CORAL_API bool coralStop(CoralHandle handle);
+    CORAL_API bool coralIsPlaying(CoralHandle handle);
+    // Stops every sound, joins the audio thread and the device pool's
+    // janitor, and closes pooled devices. Call it before unloading the
+    // library; playback afterwards starts the threads again.
+    CORAL_API void coralShutdown(void);
+
+    // Mixes any number of voices into one output format. Voices must share
+    // the mixer's sample rate and be mono or have the mixer's channel count.
+    // Pan runs from -1 (left) to 1 (right): mono voices use a constant-power
+    // law, stereo voices a balance control. Voice data must outlive the voice.
+    // Any WAV sample format may be mixed into any output format; mixing runs
+    // in float and quantizes once on output.
+    CORAL_API CoralMixer* coralMixerCreate(uint32_t sampleRate, uint16_t numChannels, CoralSampleFormat format);
+    CORAL_API void coralMixerDestroy(CoralMixer* mixer);
+    CORAL_API CoralVoice coralMixerAddVoice(CoralMixer* mixer, const WavFile* wavFile, float gain, float pan);
+    CORAL_API bool coralMixerSetVoice(CoralMixer* mixer, CoralVoice voice, float gain, float pan);
+    // Moves the voice gain to the target over the next frames rendered
+    CORAL_API bool coralMixerRampVoice(CoralMixer* mixer, CoralVoice voice, float gain, uint32_t frames, CoralRampShape shape);
+    // Loops the voice as in playWavFileLooped, taking effect mid-block
+    CORAL_API bool coralMixerLoopVoice(CoralMixer* mixer, CoralVoice voice, uint64_t loopStart, uint64_t loopEnd, uint32_t repeats);
+    CORAL_API bool coralMixerRemoveVoice(CoralMixer* mixer, CoralVoice voice);
+    CORAL_API bool coralMixerIsVoiceActive(CoralMixer* mixer, CoralVoice voice);
+    // Fills output with frames of mixed audio; returns the voices still playing
+    CORAL_API uint32_t coralMixerRender(CoralMixer* mixer, uint8_t* output, uint32_t frames);
+    // Plays the mix on a device until every voice has finished
+    CORAL_API bool coralMixerPlay(CoralMixer* mixer);
+
+    // Push mode: one producer thread writes interleaved frames, which never
+    // blocks and returns the frames that fitted. Pull mode: the callback
+    // renders each block. Playback starts with the first data after Start.
+    // Finish marks the end of the writes, and Destroy then waits for the
+    // queued audio to play; without Finish, Destroy stops at once.
+    CORAL_API CoralStream* coralStreamCreate(uint32_t sampleRate, uint16_t numChannels, CoralSampleFormat format, size_t capacityFrames);
+    CORAL_API CoralStream* coralStreamCreateCallback(uint32_t sampleRate, uint16_t numChannels, CoralSampleFormat format,
+        CoralStreamCallback callback, void* userData);
+    CORAL_API bool coralStreamStart(CoralStream* stream);
+    CORAL_API size_t coralStreamWrite(CoralStream* stream, const void* frames, size_t frameCount);
+    CORAL_API bool coralStreamFinish(CoralStream* stream);
+    CORAL_API bool coralStreamIsPlaying(const CoralStream* stream);
+    CORAL_API void coralStreamGetCounters(const CoralStream* stream, CoralStreamCounters* counters);
+    CORAL_API bool coralStreamDestroy(CoralStream* stream);
+
+    // Sample format conversion. Integer targets saturate; float targets keep
+    // values outside [-1, 1]. Planar buffers take one pointer per channel,
+    // interleaved buffers a single pointer in element 0.
+    CORAL_API uint32_t coralSampleSize(CoralSampleFormat format);
+    CORAL_API bool coralConvertSamples(const void* src, CoralSampleFormat srcFormat, void* dst, CoralSampleFormat dstFormat, size_t count);
+    CORAL_API bool coralConvertFrames(const void* const* src, CoralSampleFormat srcFormat, bool srcPlanar,
+        void* const* dst, CoralSampleFormat dstFormat, bool dstPlanar, uint16_t channels, size_t frames);
+    // Converts a loaded file's samples in place, e.g. to CORAL_SAMPLE_F32 so
+    // repeated gain changes or effects do not requantize the audio each time.
+    // Compressed files are expanded. CORAL_SAMPLE_S24_32 has no WAV layout and is rejected.
+    CORAL_API bool coralConvertWavFile(WavFile* wavFile, CoralSampleFormat format);
+
+    // Writes a loaded file, as is or converted to format. The header is
+    // WAVE_FORMAT_EXTENSIBLE when the file has a channel mask or more than
+    // two channels, and RF64 when the data passes 4 GiB. saveWavFile keeps
+    // compressed data compressed; saveWavFileAs decodes it.
+    CORAL_API bool saveWavFile(const WavFile* wavFile, const char* path);
+    CORAL_API bool saveWavFileAs(const WavFile* wavFile, const char* path, CoralSampleFormat format);
+
+    // Incremental writer. Frames are appended in inputFormat and stored in
+    // fileFormat, converted on the way out when the two differ. Writes are
+    // buffered into large aligned blocks and the header sizes are patched at
+    // Close, which switches the file to RF64 once it has grown past 4 GiB.
+    // Flush writes what is buffered and patches the header, leaving a valid
+    // file behind if the process dies later. Close frees the writer even
+    // when it fails.
+    CORAL_API CoralWriter* coralWriterOpen(const char* path, uint32_t sampleRate, uint16_t numChannels,
+        CoralSampleFormat inputFormat, CoralSampleFormat fileFormat);
+    CORAL_API bool coralWriterAppend(CoralWriter* writer, const void* frames, size_t frameCount);
+    CORAL_API bool coralWriterFlush(CoralWriter* writer);
+    CORAL_API bool coralWriterClose(CoralWriter* writer);
+
+    // Converts between any two rates. Process consumes what fits and returns
+    // the frames written; Flush emits the filter tail once input has ended,
+    // returning 0 when done. Latency is in input frames.
+    CORAL_API CoralResampler* coralResamplerCreate(uint32_t inputRate, uint32_t outputRate, uint16_t channels, CoralResampleQuality quality);
+    CORAL_API void coralResamplerDestroy(CoralResampler* resampler);
+    CORAL_API size_t coralResamplerProcess(CoralResampler* resampler, const float* input, size_t inputFrames,
+        size_t* consumed, float* output, size_t outputFrames);
+    CORAL_API size_t coralResamplerFlush(CoralResampler* resampler, float* output, size_t outputFrames);
+    CORAL_API void coralResamplerReset(CoralResampler* resampler);
+    CORAL_API uint32_t coralResamplerLatency(const CoralResampler* resampler);
+
+    // Runs output devices at a fixed rate (0, the default, uses each sound's
+    // own rate) and resamples in the library instead of the sound server.
+    // A device that cannot run at the requested rate is resampled as well.
+    CORAL_API void coralSetOutputSampleRate(uint32_t rate);
+    CORAL_API uint32_t coralGetOutputSampleRate(void);
+
+    // Output channel o of a frame is the sum over input channels i of
+    // coefficients[o * inputs + i] times input i. The layout form builds the
+    // standard matrix between two speaker masks: shared speakers pass
+    // through in the order of the output mask, missing ones fold into their
+    // neighbours 3 dB down, LFE is dropped, and the result is scaled so no
+    // output can clip. Process needs separate input and output buffers.
+    CORAL_API CoralChannelMatrix* coralChannelMatrixCreate(uint16_t inputs, uint16_t outputs, const float* coefficients);
+    CORAL_API CoralChannelMatrix* coralChannelMatrixCreateLayout(uint32_t inputLayout, uint32_t outputLayout);
+    CORAL_API void coralChannelMatrixDestroy(CoralChannelMatrix* matrix);
+    CORAL_API uint16_t coralChannelMatrixInputs(const CoralChannelMatrix* matrix);
+    CORAL_API uint16_t coralChannelMatrixOutputs(const CoralChannelMatrix* matrix);
+    CORAL_API void coralChannelMatrixProcess(const CoralChannelMatrix* matrix, const float* input, float* output, size_t frames);
+    // The speaker mask WAVE assumes for a channel count without one; 0 past 8 channels
+    CORAL_API uint32_t coralDefaultChannelLayout(uint16_t channels);
+
+    // Remixes a loaded file in place, keeping its sample format. A NULL
+    // matrix uses the layout preset from the file's channel mask, or the
+    // default layout for its channel count, to outputLayout. With a matrix,
+    // outputLayout names its outputs or is 0 to leave them unnamed.
+    // Compressed files come out as 16-bit PCM.
+    CORAL_API bool coralRemixWavFile(WavFile* wavFile, const CoralChannelMatrix* matrix, uint32_t outputLayout);
+
+    // Effect chains run EQ cascades, compressors and look-ahead limiters
+    // over float frames in place, a block at a time through every node.
+    // Limiters delay the audio by their look-ahead, reported by Latency.
+    // Bypass can be toggled while audio is running; a bypassed limiter keeps
+    // delaying. Stats count every block a node processed, including those
+    // run by the output devices on the chain's behalf. Nodes cannot be added
+    // while the chain is set as the output chain or devices still run copies.
+    CORAL_API CoralEffectChain* coralEffectChainCreate(uint32_t sampleRate, uint16_t channels);
+    CORAL_API void coralEffectChainDestroy(CoralEffectChain* chain);
+    CORAL_API bool coralEffectChainAddEq(CoralEffectChain* chain, const CoralBiquadBand* bands, uint32_t count);
+    CORAL_API bool coralEffectChainAddCompressor(CoralEffectChain* chain, const CoralCompressorConfig* config);
+    CORAL_API bool coralEffectChainAddLimiter(CoralEffectChain* chain, const CoralLimiterConfig* config);
+    CORAL_API uint32_t coralEffectChainNodeCount(const CoralEffectChain* chain);
+    CORAL_API bool coralEffectChainSetBypass(CoralEffectChain* chain, uint32_t node, bool bypass);
+    CORAL_API void coralEffectChainProcess(CoralEffectChain* chain, float* samples, size_t frames);
+    // Clears the filter, envelope and delay state
+    CORAL_API void coralEffectChainReset(CoralEffectChain* chain);
+    CORAL_API uint32_t coralEffectChainLatency(const CoralEffectChain* chain);
+    CORAL_API bool coralEffectChainGetStats(const CoralEffectChain* chain, uint32_t node, CoralEffectStats* stats);
+    CORAL_API void coralEffectChainResetStats(CoralEffectChain* chain);
+
+    // Runs every output device, offline targets included, through a copy of
+    // the chain made at open, at the device's rate and channel count, after
+    // remixing and resampling; build the chain before setting it. Bypass
+    // flags reach the copies. Draining plays out the look-ahead tail. NULL
+    // (the default) turns effects off. Destroying the chain turns it off as
+    // well; devices still playing keep their copies, and its memory is
+    // released after the last of them closes.
+    CORAL_API void coralSetOutputEffectChain(CoralEffectChain* chain);
+    CORAL_API CoralEffectChain* coralGetOutputEffectChain(void);
+
+    // Runs output devices in a fixed speaker layout (0, the default, uses
+    // each sound's own channels). Sounds are taken to be in the default
+    // layout for their channel count and are remixed block by block.
+    CORAL_API void coralSetOutputChannelLayout(uint32_t layout);
+    CORAL_API uint32_t coralGetOutputChannelLayout(void);
+    CORAL_API bool coralSetResampleQuality(CoralResampleQuality quality);
+
+    // Applies to devices opened afterwards; pooled devices are closed. NULL
+    // restores the defaults. Latency is measured while playing, so the info
+    // describes the most recently active device.
+    CORAL_API bool coralSetLatencyConfig(const CoralLatencyConfig* config);
+    CORAL_API void coralGetLatencyConfig(CoralLatencyConfig* config);
+    CORAL_API void coralGetLatencyInfo(CoralLatencyInfo* info);
+
+    // Library-wide counters since start-up or the last reset. Fields are
+    // read one at a time while other threads keep recording.
+    CORAL_API void coralGetStats(CoralStats* stats);
+    CORAL_API void coralResetStats(void);
+
+    // Peak, RMS, DC offset, clipping and silence bounds in one pass. A
+    // threshold of 0 means -60 dBFS. When waveform is not NULL it receives an
+    // overview to free with coralWaveformDestroy.
+    CORAL_API bool coralAnalyze(const WavFile* wavFile, float silenceThreshold, CoralAnalysis* analysis, CoralWaveform** waveform);
+    // Fills pixels min/max pairs (full scale 32767) for the frame range,
+    // touching a few buckets per pixel whatever the zoom. Below baseFrames
+    // frames per pixel neighbouring pixels repeat a bucket.
+    CORAL_API bool coralWaveformRead(const CoralWaveform* waveform, uint16_t channel, uint64_t firstFrame, uint64_t frameCount,
+        uint32_t pixels, int16_t* minMax);
+    CORAL_API void coralWaveformGetInfo(const CoralWaveform* waveform, CoralWaveformInfo* info);
+    CORAL_API bool coralWaveformSave(const CoralWaveform* waveform, const char* path);
+    CORAL_API CoralWaveform* coralWaveformLoad(const char* path);
+    CORAL_API void coralWaveformDestroy(CoralWaveform* waveform);
+
+    // Sample data is 64-byte aligned. Freed buffers are recycled for loads
+    // of a similar size while the pool stays under its budget (32 MiB by
+    // default; 0 disables pooling). The allocator can only be replaced while
+    // no WavFile is loaded; NULL restores the C runtime.
+    CORAL_API bool coralSetAllocator(const CoralAllocator* allocator);
+    CORAL_API void coralSetSamplePoolBudget(size_t bytes);
+    CORAL_API void coralFlushSamplePool(void);
+    CORAL_API void coralGetSamplePoolStats(CoralSamplePoolStats* stats);
+
+    // Shared, read-only loads. Acquiring a file that is already in the bank
+    // (same file contents, whatever the path spelling) returns the same
+    // WavFile. Release each acquire once; never pass the result to freeWavFile.
+    // Unreferenced files stay cached until the budget (64 MiB by default)
+    // evicts the least recently used.
+    CORAL_API const WavFile* coralBankAcquire(const char* path);
+    CORAL_API void coralBankRelease(const WavFile* wavFile);
+    CORAL_API void coralBankSetBudget(size_t bytes);
+    CORAL_API void coralBankGetStats(CoralBankStats* stats);
+
+    // Selects the output backend for devices opened afterwards; select it
+    // before starting playback. path names the file for the file backends.
+    // The memory, WAV and raw targets hold one format; the null target any.
+    CORAL_API bool coralSetOutputBackend(CoralBackend backend, const char* path);
+    CORAL_API CoralBackend coralGetOutputBackend(void);
+    // Valid until the next write or backend change
+    CORAL_API const uint8_t* coralGetRenderBuffer(size_t* size);
+    CORAL_API void coralGetRenderStats(CoralRenderStats* stats);
+    CORAL_API void coralResetRenderStats(void);
+
+    // Output devices are kept open for reuse until idle for the timeout
+    // (5000 ms by default). A timeout of 0 disables pooling.
+    CORAL_API void coralSetDevicePoolTimeout(uint32_t milliseconds);
+    CORAL_API void coralFlushDevicePool(void);
+    CORAL_API void coralGetDevicePoolStats(CoralDevicePoolStats* stats);
+
+    // Loads every path across a pool of worker threads (0 = one per CPU).
+    // results[i] is NULL on failure, with the reason in errors[i] when errors
+    // is not NULL. Returns the number of files loaded.
+    CORAL_API size_t loadWavFiles(const char* const* paths, size_t count, WavFile** results, CoralError* errors, uint32_t threads);
+
+    // Errors are kept per thread: both calls describe the last failure on
+    // the calling thread and are not cleared by later successful calls.
     CORAL_API const char* getAudioError();
+    CORAL_API CoralError coralGetLastError(void);
+    // Rewrites the samples in place. To play at another volume without losing
+    // precision, use playWavFileWithGain or coralSetGain instead.
     CORAL_API bool adjustVolume(WavFile* wavFile, float volumeFactor);
+    CORAL_API bool adjustVolumeFixed(WavFile* wavFile, int16_t gain);   // 8.8 fixed point, 256 = unity
     CORAL_API WavMetadata getWavMetadata(const WavFile* wavFile);
+    // Reads only the RIFF headers, usually in a single 4 KiB read
+    CORAL_API bool probeWavFile(const char* filename, CoralWavInfo* info);
+
+    // Kernels are picked from the best instruction set the CPU supports.
+    // coralSetSimdLevel can lower it (e.g. to compare against the scalar path).
+    CORAL_API CoralSimdLevel coralGetSimdLevel(void);
+    CORAL_API bool coralSetSimdLevel(CoralSimdLevel level);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,559 @@
+/*
+@file - writer.c
+@developer - ColorProgrammy
+@brief - WAV file writing.
+@date - 16/10/2026
+@description - Frames are gathered in a 64-byte aligned block and written
+with one system call per block, bypassing stdio so the data is copied once.
+Appends larger than the block go out directly, together with what was
+already buffered, in a single vectored write of whole blocks. The header
+reserves room for an RF64 ds64 chunk in a JUNK chunk, so a file that grows
+past 4 GiB becomes RF64 at close without moving any data.
+*/
+
+#include "internal.h"
+
+#ifdef PLATFORM_WINDOWS
+typedef HANDLE WriterFile;
+#else
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+typedef int WriterFile;
+#endif
+
+#define WRITER_BLOCK_BYTES ((size_t)1 << 20)
+#define WRITER_HEADER_BYTES 104     // RIFF, ds64 or JUNK, extensible fmt and data headers
+#define DS64_PAYLOAD_BYTES 28       // RIFF size, data size, sample count and an empty table
+#define RIFF_LIMIT 0xFFFFFFFFu
+#define COMPRESSED_HEADER_BYTES 60  // RIFF, fmt with wSamplesPerBlock, fact and data headers
+#define WRITER_DECODE_FRAMES 4096
+
+struct CoralWriter {
+    WriterFile file;
+    char* path;
+    WavFormat format;               // As stored in the file
+    uint32_t channelMask;
+    uint16_t validBits;
+    CoralSampleFormat inputFormat;
+    CoralSampleFormat fileFormat;
+    bool reserved;                  // A JUNK chunk holds room for ds64
+    bool failed;
+
+    uint32_t headerBytes;           // Offset of the first sample
+    uint64_t dataBytes;             // Sample bytes written, buffered included
+    uint8_t* block;
+    size_t buffered;
+};
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+} WriterSlice;
+
+static bool openFile(WriterFile* file, const char* path) {
+#ifdef PLATFORM_WINDOWS
+    *file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    return *file != INVALID_HANDLE_VALUE;
+#else
+    *file = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    return *file >= 0;
+#endif
+}
+
+static void closeFile(WriterFile file) {
+#ifdef PLATFORM_WINDOWS
+    CloseHandle(file);
+#else
+    close(file);
+#endif
+}
+
+// Writes the slices in order at the file position, retrying short writes
+static bool writeSlices(WriterFile file, WriterSlice* slices, int count) {
+#ifdef PLATFORM_WINDOWS
+    DWORD written;
+    DWORD chunk;
+    int i;
+
+    for (i = 0; i < count; ++i) {
+        while (slices[i].size > 0) {
+            chunk = slices[i].size > 0x40000000 ? 0x40000000 : (DWORD)slices[i].size;
+            if (!WriteFile(file, slices[i].data, chunk, &written, NULL) || written == 0) {
+                return false;
+            }
+            slices[i].data += written;
+            slices[i].size -= written;
+        }
+    }
+    return true;
+#else
+    struct iovec vectors[2];
+    ssize_t written;
+    int first = 0;
+    int used;
+    int i;
+
+    while (first < count) {
+        used = 0;
+        for (i = first; i < count && used < 2; ++i) {
+            if (slices[i].size > 0) {
+                vectors[used].iov_base = (void*)slices[i].data;
+                vectors[used].iov_len = slices[i].size;
+                used++;
+            }
+        }
+        if (used == 0) {
+            return true;
+        }
+        written = writev(file, vectors, used);
+        if (written <= 0) {
+            return false;
+        }
+        for (; first < count && (size_t)written >= slices[first].size; ++first) {
+            written -= (ssize_t)slices[first].size;
+            slices[first].size = 0;
+        }
+        if (first < count) {
+            slices[first].data += written;
+            slices[first].size -= (size_t)written;
+        }
+    }
+    return true;
+#endif
+}
+
+// Writes at an offset without moving the position appends continue from
+static bool writeAt(WriterFile file, uint64_t offset, const void* data, size_t size) {
+#ifdef PLATFORM_WINDOWS
+    LARGE_INTEGER position;
+    LARGE_INTEGER target;
+    LARGE_INTEGER zero;
+    DWORD written;
+    bool ok;
+
+    zero.QuadPart = 0;
+    target.QuadPart = (LONGLONG)offset;
+    if (!SetFilePointerEx(file, zero, &position, FILE_CURRENT) || !SetFilePointerEx(file, target, NULL, FILE_BEGIN)) {
+        return false;
+    }
+    ok = WriteFile(file, data, (DWORD)size, &written, NULL) && written == size;
+    return SetFilePointerEx(file, position, NULL, FILE_BEGIN) && ok;
+#else
+    return pwrite(file, data, size, (off_t)offset) == (ssize_t)size;
+#endif
+}
+
+static void put16(uint8_t* bytes, uint16_t value) {
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t* bytes, uint32_t value) {
+    put16(bytes, (uint16_t)value);
+    put16(bytes + 2, (uint16_t)(value >> 16));
+}
+
+static void put64(uint8_t* bytes, uint64_t value) {
+    put32(bytes, (uint32_t)value);
+    put32(bytes + 4, (uint32_t)(value >> 32));
+}
+
+// Lays out the header for the data written so far and returns its size
+static uint32_t buildHeader(const CoralWriter* writer, uint8_t* header, bool rf64) {
+    static const uint8_t subformatTail[14] = {
+        0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+    };
+    bool extensible = writer->channelMask != 0 || writer->format.numChannels > 2 ||
+        writer->validBits != writer->format.bitsPerSample;
+    uint32_t formatBytes = extensible ? 40 : 16;
+    uint32_t size = 12 + (writer->reserved ? 8 + DS64_PAYLOAD_BYTES : 0) + 8 + formatBytes + 8;
+    uint64_t riffSize = size - 8 + writer->dataBytes + (writer->dataBytes & 1);
+    uint8_t* pos = header;
+
+    memcpy(pos, rf64 ? "RF64" : "RIFF", 4);
+    put32(pos + 4, rf64 ? RIFF_LIMIT : (uint32_t)riffSize);
+    memcpy(pos + 8, "WAVE", 4);
+    pos += 12;
+
+    if (writer->reserved) {
+        memset(pos, 0, 8 + DS64_PAYLOAD_BYTES);
+        memcpy(pos, rf64 ? "ds64" : "JUNK", 4);
+        put32(pos + 4, DS64_PAYLOAD_BYTES);
+        if (rf64) {
+            put64(pos + 8, riffSize);
+            put64(pos + 16, writer->dataBytes);
+            put64(pos + 24, writer->dataBytes / writer->format.blockAlign);
+        }
+        pos += 8 + DS64_PAYLOAD_BYTES;
+    }
+
+    memcpy(pos, "fmt ", 4);
+    put32(pos + 4, formatBytes);
+    put16(pos + 8, extensible ? WAV_FORMAT_EXTENSIBLE : writer->format.audioFormat);
+    put16(pos + 10, writer->format.numChannels);
+    put32(pos + 12, writer->format.sampleRate);
+    put32(pos + 16, writer->format.byteRate);
+    put16(pos + 20, writer->format.blockAlign);
+    put16(pos + 22, writer->format.bitsPerSample);
+    if (extensible) {
+        put16(pos + 24, 22);
+        put16(pos + 26, writer->validBits);
+        put32(pos + 28, writer->channelMask);
+        put16(pos + 32, writer->format.audioFormat);
+        memcpy(pos + 34, subformatTail, sizeof(subformatTail));
+    }
+    pos += 8 + formatBytes;
+
+    memcpy(pos, "data", 4);
+    put32(pos + 4, rf64 ? RIFF_LIMIT : (uint32_t)writer->dataBytes);
+    return size;
+}
+
+static bool failWrite(CoralWriter* writer) {
+    writer->failed = true;
+    coralSetError(CORAL_ERROR_FILE_WRITE, "Failed to write to %s", writer->path);
+    return false;
+}
+
+static bool flushBlock(CoralWriter* writer) {
+    WriterSlice slice;
+
+    slice.data = writer->block;
+    slice.size = writer->buffered;
+    if (!writeSlices(writer->file, &slice, 1)) {
+        return failWrite(writer);
+    }
+    writer->buffered = 0;
+    return true;
+}
+
+// channelMask and validBits fix the header layout, so they are set here;
+// validBits of 0 means every bit is significant
+static CoralWriter* openWriter(const char* path, uint32_t sampleRate, uint16_t numChannels,
+    CoralSampleFormat inputFormat, CoralSampleFormat fileFormat, uint32_t channelMask, uint16_t validBits, bool reserve) {
+    CoralWriter* writer;
+    uint32_t sampleSize = coralSampleSize(fileFormat);
+
+    if (!path || sampleRate == 0 || numChannels == 0) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null path or invalid writer format");
+        return NULL;
+    }
+    if (coralSampleSize(inputFormat) == 0 || sampleSize == 0 || fileFormat == CORAL_SAMPLE_S24_32) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "No WAV layout for sample format %d", (int)fileFormat);
+        return NULL;
+    }
+
+    writer = (CoralWriter*)malloc(sizeof(CoralWriter));
+    if (!writer) {
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+    memset(writer, 0, sizeof(CoralWriter));
+    writer->path = (char*)malloc(strlen(path) + 1);
+    writer->block = (uint8_t*)coralAllocSamples(WRITER_BLOCK_BYTES);
+    if (!writer->path || !writer->block) {
+        coralFreeSamples(writer->block);
+        free(writer->path);
+        free(writer);
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return NULL;
+    }
+    strcpy(writer->path, path);
+
+    writer->format.audioFormat = fileFormat == CORAL_SAMPLE_F32 ? WAV_FORMAT_IEEE_FLOAT : WAV_FORMAT_PCM;
+    writer->format.numChannels = numChannels;
+    writer->format.sampleRate = sampleRate;
+    writer->format.bitsPerSample = (uint16_t)(sampleSize * 8);
+    writer->format.blockAlign = (uint16_t)(numChannels * sampleSize);
+    writer->format.byteRate = sampleRate * writer->format.blockAlign;
+    writer->channelMask = channelMask;
+    writer->validBits = validBits > 0 && validBits < writer->format.bitsPerSample ? validBits : writer->format.bitsPerSample;
+    writer->inputFormat = inputFormat;
+    writer->fileFormat = fileFormat;
+    writer->reserved = reserve;
+
+    if (!openFile(&writer->file, path)) {
+        coralFreeSamples(writer->block);
+        free(writer->path);
+        free(writer);
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to open file: %s", path);
+        return NULL;
+    }
+
+    // The header is buffered as the start of the first block and goes out
+    // with the first data written
+    writer->headerBytes = buildHeader(writer, writer->block, false);
+    writer->buffered = writer->headerBytes;
+    return writer;
+}
+
+CoralWriter* coralWriterOpen(const char* path, uint32_t sampleRate, uint16_t numChannels,
+    CoralSampleFormat inputFormat, CoralSampleFormat fileFormat) {
+    // The length is not known yet, so keep room for ds64
+    return openWriter(path, sampleRate, numChannels, inputFormat, fileFormat, 0, 0, true);
+}
+
+bool coralWriterAppend(CoralWriter* writer, const void* frames, size_t frameCount) {
+    const uint8_t* input = (const uint8_t*)frames;
+    uint32_t inputSize;
+    uint32_t outputSize;
+    WriterSlice slices[2];
+    size_t bytes;
+    size_t direct;
+    size_t count;
+    size_t samples;
+
+    if (!writer || (!frames && frameCount > 0)) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null writer or frame pointer");
+        return false;
+    }
+    if (writer->failed) {
+        coralSetError(CORAL_ERROR_FILE_WRITE, "Earlier write to %s failed", writer->path);
+        return false;
+    }
+
+    if (writer->inputFormat == writer->fileFormat) {
+        bytes = frameCount * writer->format.blockAlign;
+        if (writer->buffered + bytes >= WRITER_BLOCK_BYTES) {
+            // Send the buffered bytes and whole blocks of the input in one
+            // call, keeping later writes block-sized; the rest is buffered
+            direct = bytes - (writer->buffered + bytes) % WRITER_BLOCK_BYTES;
+            slices[0].data = writer->block;
+            slices[0].size = writer->buffered;
+            slices[1].data = input;
+            slices[1].size = direct;
+            if (!writeSlices(writer->file, slices, 2)) {
+                return failWrite(writer);
+            }
+            writer->buffered = 0;
+            input += direct;
+            bytes -= direct;
+            writer->dataBytes += direct;
+        }
+        memcpy(writer->block + writer->buffered, input, bytes);
+        writer->buffered += bytes;
+        writer->dataBytes += bytes;
+        return true;
+    }
+
+    // Convert straight into the block, a block at a time
+    inputSize = coralSampleSize(writer->inputFormat);
+    outputSize = coralSampleSize(writer->fileFormat);
+    samples = frameCount * writer->format.numChannels;
+    while (samples > 0) {
+        count = (WRITER_BLOCK_BYTES - writer->buffered) / outputSize;
+        if (count > samples) {
+            count = samples;
+        }
+        coralConvertSamples(input, writer->inputFormat, writer->block + writer->buffered, writer->fileFormat, count);
+        input += count * inputSize;
+        samples -= count;
+        writer->buffered += count * outputSize;
+        writer->dataBytes += count * outputSize;
+        if (WRITER_BLOCK_BYTES - writer->buffered < outputSize && !flushBlock(writer)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rewrites the header for the data so far, with the pad byte an odd
+// data size needs. The next append overwrites the pad.
+static bool patchHeader(CoralWriter* writer) {
+    uint8_t header[WRITER_HEADER_BYTES];
+    uint8_t pad = 0;
+    uint64_t riffSize = writer->headerBytes - 8 + writer->dataBytes + (writer->dataBytes & 1);
+    bool rf64 = riffSize > RIFF_LIMIT;
+
+    if (rf64 && !writer->reserved) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "No room for an RF64 header in %s", writer->path);
+        writer->failed = true;
+        return false;
+    }
+    buildHeader(writer, header, rf64);
+    if ((writer->dataBytes & 1) && !writeAt(writer->file, writer->headerBytes + writer->dataBytes, &pad, 1)) {
+        return failWrite(writer);
+    }
+    if (!writeAt(writer->file, 0, header, writer->headerBytes)) {
+        return failWrite(writer);
+    }
+    return true;
+}
+
+bool coralWriterFlush(CoralWriter* writer) {
+    if (!writer) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null writer pointer");
+        return false;
+    }
+    if (writer->failed) {
+        coralSetError(CORAL_ERROR_FILE_WRITE, "Earlier write to %s failed", writer->path);
+        return false;
+    }
+    return flushBlock(writer) && patchHeader(writer);
+}
+
+bool coralWriterClose(CoralWriter* writer) {
+    bool ok;
+
+    if (!writer) {
+        return true;
+    }
+    ok = coralWriterFlush(writer);
+    closeFile(writer->file);
+    coralFreeSamples(writer->block);
+    free(writer->path);
+    free(writer);
+    return ok;
+}
+
+// Decodes a compressed file block by block and appends it as float
+static bool appendDecoded(CoralWriter* writer, const WavFile* wavFile, uint64_t frames) {
+    CoralDecoder decoder;
+    uint64_t frame;
+    size_t take;
+    float* block;
+    bool ok = true;
+
+    if (!coralDecoderInit(&decoder, wavFile)) {
+        return false;
+    }
+    block = (float*)malloc((size_t)WRITER_DECODE_FRAMES * wavFile->wavFormat.numChannels * sizeof(float));
+    if (!block) {
+        coralDecoderFree(&decoder);
+        coralSetError(CORAL_ERROR_OUT_OF_MEMORY, "Memory allocation failed");
+        return false;
+    }
+    for (frame = 0; ok && frame < frames; frame += take) {
+        take = frames - frame < WRITER_DECODE_FRAMES ? (size_t)(frames - frame) : WRITER_DECODE_FRAMES;
+        coralDecoderRead(&decoder, frame, block, take);
+        ok = coralWriterAppend(writer, block, take);
+    }
+    free(block);
+    coralDecoderFree(&decoder);
+    return ok;
+}
+
+// Writes compressed data as it is, behind a plain fmt chunk with the
+// cbSize (and wSamplesPerBlock for IMA ADPCM) and the fact chunk that
+// compressed formats carry
+static bool saveCompressed(const WavFile* wavFile, const char* path) {
+    const WavFormat* format = &wavFile->wavFormat;
+    uint8_t header[COMPRESSED_HEADER_BYTES];
+    uint8_t pad = 0;
+    uint64_t dataBytes = coralWavDataSize(wavFile);
+    uint32_t formatBytes = coralCodecOf(format) == CORAL_CODEC_IMA_ADPCM ? 20 : 18;
+    uint32_t size = 12 + 8 + formatBytes + 12 + 8;
+    uint8_t* pos = header;
+    WriterSlice slices[3];
+    WriterFile file;
+    bool ok;
+
+    if (size - 8 + dataBytes + (dataBytes & 1) > RIFF_LIMIT) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Compressed data past 4 GiB; save it converted with saveWavFileAs");
+        return false;
+    }
+
+    memcpy(pos, "RIFF", 4);
+    put32(pos + 4, (uint32_t)(size - 8 + dataBytes + (dataBytes & 1)));
+    memcpy(pos + 8, "WAVE", 4);
+    pos += 12;
+
+    memcpy(pos, "fmt ", 4);
+    put32(pos + 4, formatBytes);
+    put16(pos + 8, format->audioFormat);
+    put16(pos + 10, format->numChannels);
+    put32(pos + 12, format->sampleRate);
+    put32(pos + 16, format->byteRate);
+    put16(pos + 20, format->blockAlign);
+    put16(pos + 22, format->bitsPerSample);
+    put16(pos + 24, (uint16_t)(formatBytes - 18));
+    if (formatBytes == 20) {
+        put16(pos + 26, (uint16_t)coralFrameCount(format, format->blockAlign));
+    }
+    pos += 8 + formatBytes;
+
+    memcpy(pos, "fact", 4);
+    put32(pos + 4, 4);
+    put32(pos + 8, (uint32_t)coralFrameCount(format, dataBytes));
+    pos += 12;
+
+    memcpy(pos, "data", 4);
+    put32(pos + 4, (uint32_t)dataBytes);
+
+    if (!openFile(&file, path)) {
+        coralSetError(CORAL_ERROR_FILE_OPEN, "Failed to open file: %s", path);
+        return false;
+    }
+    slices[0].data = header;
+    slices[0].size = size;
+    slices[1].data = wavFile->data;
+    slices[1].size = (size_t)dataBytes;
+    slices[2].data = &pad;
+    slices[2].size = dataBytes & 1;
+    ok = writeSlices(file, slices, 3);
+    closeFile(file);
+    if (!ok) {
+        coralSetError(CORAL_ERROR_FILE_WRITE, "Failed to write to %s", path);
+    }
+    return ok;
+}
+
+bool saveWavFileAs(const WavFile* wavFile, const char* path, CoralSampleFormat format) {
+    CoralSampleFormat current;
+    CoralWriter* writer;
+    WavFormat playback;
+    uint64_t frames;
+    uint64_t bytes;
+    bool compressed;
+    bool ok;
+
+    if (!wavFile || !wavFile->data || !path) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null WAV file or path");
+        return false;
+    }
+    if (!coralPlaybackFormat(&wavFile->wavFormat, &playback, &current)) {
+        return false;
+    }
+
+    // Frames are counted by blockAlign but copied by channel count
+    if (!coralCheckFormat(&wavFile->wavFormat, NULL, 0)) {
+        return false;
+    }
+
+    // Compressed files reach the writer as float, decoded a block at a time
+    compressed = coralCodecOf(&wavFile->wavFormat) != CORAL_CODEC_NONE;
+    if (compressed) {
+        current = CORAL_SAMPLE_F32;
+    }
+
+    // The size is known, so only big files need room for ds64
+    frames = coralFrameCount(&wavFile->wavFormat, coralWavDataSize(wavFile));
+    bytes = frames * wavFile->wavFormat.numChannels * coralSampleSize(format);
+    writer = openWriter(path, wavFile->wavFormat.sampleRate, wavFile->wavFormat.numChannels, current, format,
+        wavFile->channelMask, format == current && !compressed ? wavFile->validBitsPerSample : 0,
+        bytes > RIFF_LIMIT - WRITER_HEADER_BYTES);
+    if (!writer) {
+        return false;
+    }
+    ok = compressed ? appendDecoded(writer, wavFile, frames) : coralWriterAppend(writer, wavFile->data, (size_t)frames);
+    return coralWriterClose(writer) && ok;
+}
+
+bool saveWavFile(const WavFile* wavFile, const char* path) {
+    CoralSampleFormat format;
+
+    if (!wavFile || !wavFile->data || !path) {
+        coralSetError(CORAL_ERROR_INVALID_ARGUMENT, "Null WAV file or path");
+        return false;
+    }
+    if (coralCodecOf(&wavFile->wavFormat) != CORAL_CODEC_NONE) {
+        return coralCheckFormat(&wavFile->wavFormat, NULL, 0) && saveCompressed(wavFile, path);
+    }
+    if (!coralSampleFormatOf(&wavFile->wavFormat, &format)) {
+        coralSetError(CORAL_ERROR_UNSUPPORTED, "Unsupported sample format: %d-bit, format tag %d",
+            wavFile->wavFormat.bitsPerSample, wavFile->wavFormat.audioFormat);
+        return false;
+    }
+    return saveWavFileAs(wavFile, path, format);
+}
@@ -53,6 +53,7 @@ typedef void (*FreeWavFunc)(WavFile*);
 typedef const char* (*GetErrorFunc)();
 typedef bool (*AdjustVolumeFunc)(WavFile*, float);
 typedef WavMetadata (*GetMetadataFunc)(const WavFile*);
+typedef void (*ShutdownFunc)();
 
 int main() {
     HMODULE dllHandle = LoadLibraryA("coral.dll");
@@ -67,8 +68,9 @@ int main() {
     GetErrorFunc getError = (GetErrorFunc)GetProcAddress(dllHandle, "getAudioError");
     AdjustVolumeFunc adjustVol = (AdjustVolumeFunc)GetProcAddress(dllHandle, "adjustVolume");
     GetMetadataFunc getMetadata = (GetMetadataFunc)GetProcAddress(dllHandle, "getWavMetadata");
+    ShutdownFunc shutdown = (ShutdownFunc)GetProcAddress(dllHandle, "coralShutdown");
 
-    if (!loadWav || !playWav || !freeWav || !getError || !adjustVol || !getMetadata) {
+    if (!loadWav || !playWav || !freeWav || !getError || !adjustVol || !getMetadata || !shutdown) {
         std::cerr << "Error loading functions from DLL" << std::endl;
         FreeLibrary(dllHandle);
         return 1;
@@ -94,6 +96,8 @@ int main() {
     }
 
     freeWav(wav);
+    // Joins the library's threads and closes pooled devices before unloading
+    shutdown();
     FreeLibrary(dllHandle);
     return 0;
 }
\ No newline at end of file